@@ -0,0 +1,133 @@
+#ifndef DATASET_HPP
+#define DATASET_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <memory>
+
+#include <opencv2/opencv.hpp>
+
+#include "toolkit.hpp"
+#include "threadPool.hpp"
+#include "numa.hpp"
+
+
+/**
+ * @brief A dataset of images decoded once and kept in memory.
+ *
+ * The pixels of all the images are stored in a single contiguous buffer, one row of
+ * `sampleSize` 8-bit grayscale values per image, and the labels in a parallel array. Training
+ * and testing address the samples by their 32-bit index, so a shuffle or a batch never copies
+ * an image or a path, and an image is decoded only once instead of once per epoch.
+ *
+ * When the threads of the pool are pinned to more than one NUMA node, every other node gets its
+ * own read-only copy of the pixels, written by one of its threads so that the kernel places it in
+ * the memory of that node. `sample` returns the copy of the node of the calling thread.
+ *
+ * @param sampleSize The number of pixels of each image.
+ * @param pixels The pixels of all the images (size() x sampleSize).
+ * @param labels The label of each image.
+ * @param replicas The copy of `pixels` of each NUMA node (see `numaTopology`), null for the nodes reading `pixels`.
+ */
+struct Dataset
+{
+    int sampleSize = 0;
+    std::vector<uint8_t> pixels;
+    std::vector<int> labels;
+    std::vector<std::unique_ptr<uint8_t[]>> replicas;
+
+    /**
+     * @brief Returns the number of images in the dataset.
+     */
+    size_t size() const { return labels.size(); }
+
+    /**
+     * @brief Returns the pixels of an image, from the copy of the NUMA node of the calling thread.
+     *
+     * @param index The index of the image.
+     */
+    const uint8_t* sample(size_t index) const
+    {
+        const uint8_t* base = pixels.data();
+
+        if (!replicas.empty())
+        {
+            size_t node = currentNumaNode();
+            if (node < replicas.size() && replicas[node])
+                base = replicas[node].get();
+        }
+
+        return base + index * (size_t)sampleSize;
+    }
+};
+
+
+/**
+ * @brief Decodes a list of images into an in-memory dataset.
+ *
+ * The images are decoded in parallel on the thread pool. The label of every image is
+ * extracted from its file name (see `labelExtractor`). All the images must have the same size.
+ *
+ * @param dataset The dataset to fill. Its previous content is discarded.
+ * @param images The paths of the images.
+ * @return true if every image was decoded, false otherwise.
+ */
+bool loadDataset(Dataset& dataset, const std::vector<std::string>& images);
+
+
+/**
+ * @brief Gives every NUMA node used by the pinned threads of the pool its own copy of the pixels.
+ *
+ * The copy of a node is written by a task submitted to a thread pinned on that node, so its pages
+ * are allocated in the local memory of the node (first-touch policy). The node of the calling
+ * thread keeps reading `pixels`. Does nothing on a single node or if the threads are not pinned.
+ *
+ * @param dataset The dataset to replicate.
+ */
+void replicateDataset(Dataset& dataset);
+
+
+/**
+ * @brief Normalises 8-bit pixels to [0, 1] in a single pass.
+ *
+ * The loop has no branch, so the compiler vectorises the conversion.
+ *
+ * @param pixels Pointer to the pixels.
+ * @param count The number of pixels.
+ * @param output Pointer to the normalised values (count values).
+ */
+void normalizePixels(const uint8_t* pixels, size_t count, double* output);
+
+
+/**
+ * @brief Decodes a single image into a buffer owned by the caller.
+ *
+ * The image is decoded as grayscale and normalised straight into `pixels`, which is only
+ * resized if its size differs from the number of pixels of the image. Reusing the same buffer
+ * for every image therefore costs the decoding alone: no intermediate floating-point image and
+ * no copy. The label stays an integer, the one-hot vector is only built by the loss if needed.
+ *
+ * @param imagePath The path of the image. The label is extracted from its file name (see `labelExtractor`).
+ * @param pixels The buffer receiving the normalised pixels.
+ * @param label The label of the image.
+ * @return true if the image was decoded, false otherwise.
+ */
+bool loadSample(const std::string& imagePath, std::vector<double>& pixels, int& label);
+
+
+/**
+ * @brief Copies some samples of a dataset into a batch of network inputs.
+ *
+ * The pixels are normalised to [0, 1] exactly as in `loadSample`.
+ *
+ * @param dataset The dataset.
+ * @param indices Pointer to the indices of the samples.
+ * @param count The number of samples.
+ * @param inputs The batch of inputs (count x sampleSize), resized if needed.
+ */
+void fillBatch(const Dataset& dataset, const uint32_t* indices, size_t count, std::vector<double>& inputs);
+
+
+#endif // DATASET_HPP
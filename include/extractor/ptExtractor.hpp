@@ -0,0 +1,112 @@
+#ifndef PTEXTRACTOR_HPP
+#define PTEXTRACTOR_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+
+/**
+ * @brief The element types of the tensors that can be read from a `.pt` file.
+ */
+enum class PtScalarType {
+    FLOAT32,    ///< torch.float32 (FloatStorage).
+    FLOAT64,    ///< torch.float64 (DoubleStorage).
+    FLOAT16,    ///< torch.float16 (HalfStorage).
+    BFLOAT16,   ///< torch.bfloat16 (BFloat16Storage).
+    INVALID
+};
+
+
+/**
+ * @brief A tensor of a PyTorch state_dict, pointing into the mapped `.pt` file.
+ *
+ * @param name The key of the tensor in the state_dict (e.g. "fc1.weight").
+ * @param type The type of the elements.
+ * @param shape The size of every dimension.
+ * @param data Pointer to the first element of the tensor in the file (row-major, contiguous).
+ * @param elements The number of elements.
+ */
+struct PtTensor
+{
+    std::string name;
+    PtScalarType type = PtScalarType::INVALID;
+    std::vector<int64_t> shape;
+    const uint8_t* data = nullptr;
+    size_t elements = 0;
+};
+
+
+/**
+ * @brief A PyTorch state_dict read from a `.pt` file, without Python.
+ *
+ * The file written by `torch.save(model.state_dict(), path)` is a zip archive (stored, not
+ * compressed) holding a pickle of the dictionary and one entry per tensor storage. The archive
+ * is mapped in memory and only the pickle is parsed: the tensors point straight into the
+ * mapping, so their values are converted once, when they are copied into the layers.
+ *
+ * Only the subset written for a state_dict is supported: an (Ordered)dict of floating-point
+ * tensors, little-endian, contiguous, in an archive without zip64 records.
+ */
+class PtStateDict
+{
+    public:
+
+        PtStateDict() = default;
+        ~PtStateDict();
+        PtStateDict(const PtStateDict&) = delete;
+        PtStateDict& operator=(const PtStateDict&) = delete;
+
+
+        /**
+         * @brief Reads a `.pt` file. The previous content is discarded.
+         *
+         * @param path The path of the file.
+         * @param error Receives the reason of a failure instead of the standard output (optional).
+         * @return true if the file was read, false otherwise (the reason is printed or stored in `error`).
+         */
+        bool load(const std::string& path, std::string* error = nullptr);
+
+
+        /**
+         * @brief Returns the tensor with the given key, or nullptr.
+         *
+         * @param name The key of the tensor (e.g. "fc1.weight").
+         */
+        const PtTensor* find(const std::string& name) const;
+
+
+        /**
+         * @brief Returns the tensors, in the order of the state_dict.
+         */
+        const std::vector<PtTensor>& tensors() const { return entries; }
+
+    private:
+
+        void release();
+
+        void* mapping = nullptr;
+        size_t mappedSize = 0;
+        std::vector<PtTensor> entries;
+};
+
+
+/**
+ * @brief Converts the elements of a tensor to double.
+ *
+ * @param tensor The tensor.
+ * @param output Pointer to `tensor.elements` values.
+ */
+void ptTensorToDouble(const PtTensor& tensor, double* output);
+
+
+/**
+ * @brief Returns true if a weights file is a PyTorch `.pt` (or `.pth`) file rather than a JSON file.
+ *
+ * @param path The path of the weights file.
+ */
+bool isPtCheckpoint(const std::string& path);
+
+
+#endif // PTEXTRACTOR_HPP
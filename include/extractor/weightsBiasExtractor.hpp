@@ -33,14 +33,17 @@ struct BiasesWeights
  * This function reads a JSON file containing the biases and weights for a neural network's 
  * layers and stores them in a vector of `BiasesWeights` structures. The file is expected to 
  * contain bias and weight data for fully connected (fc) layers in a neural network, with keys 
- * in the format "fcN.bias" and "fcN.weight" where N is the layer index.
+ * in the format "fcN.bias" and "fcN.weight" where N is the layer index, and for the convolution 
+ * layers, if any, with keys "convN.bias" and "convN.weight". A filter is one row of values, or 
+ * the nested (channels x kernel x kernel) arrays of PyTorch.
  * 
  * @param jsonString The path to the JSON file containing the neural network parameters.
+ * @param error Receives the reason of a failure instead of the standard error (optional).
  * @return std::vector<BiasesWeights> A vector containing the biases and weights for each layer. 
  *                                    Returns an empty vector if the file cannot be opened or if 
  *                                    any required keys are missing.
  */
-std::vector<BiasesWeights> parseJSON(const std::string& jsonString);
+std::vector<BiasesWeights> parseJSON(const std::string& jsonString, std::string* error = nullptr);
 
 
 /**
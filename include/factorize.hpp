@@ -0,0 +1,45 @@
+#ifndef FACTORIZE_HPP
+#define FACTORIZE_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "network.hpp"
+#include "toolkit.hpp"
+#include "dataset.hpp"
+#include "lowRank.hpp"
+
+
+// Largest number of validation images used to time the networks
+static constexpr size_t TIMING_SAMPLES = 1024;
+
+// A layer is only factorised if it keeps at most this fraction of its multiply-adds
+static constexpr double MAX_FACTORISED_COST = 0.75;
+
+
+/**
+ * @brief Replaces the fully connected layers by low-rank factorisations within an accuracy budget.
+ *
+ * The ranks are chosen on the validation images, held out of the training dataset with
+ * `splitValidationSet`, so the testing dataset stays unbiased. The weights W of every standard layer,
+ * from the first one, are decomposed with `jacobiSVD` and the smallest rank r whose
+ * approximation U_r S_r V_rᵀ keeps the validation accuracy of the whole network within
+ * `inputParams.factorizeBudget` percentage points of the original one is found by bisection.
+ * A layer is only factorised when r x (inputs + outputs) is at most `MAX_FACTORISED_COST` of
+ * inputs x outputs, otherwise it stays dense. The layers that were factorised are then split
+ * in two with `factorizeLayer`.
+ *
+ * The rank, the multiply-adds and the validation accuracy of every layer, then the validation
+ * accuracy, the testing accuracy and loss, and the time per image of the original and of the
+ * factorised network are printed. The factorised
+ * network is saved with `WeightsBiasesToJSON` and loads again with `-Ranks`.
+ *
+ * @param net The network, with its weights already imported. It holds the factorised network on return.
+ * @param inputParams The input parameters, including the accuracy budget, the training dataset with its validation split and the testing dataset.
+ * @return int Returns 0 upon success, 1 if the dataset cannot be read or a layer cannot be factorised.
+ */
+int networkFactorize(Network &net, Arguments &inputParams);
+
+
+#endif // FACTORIZE_HPP
@@ -5,6 +5,7 @@
 #include <vector>
 #include <cmath>
 #include <cassert>
+#include <algorithm>
 
 
 // https://mccormickml.com/2014/03/04/gradient-descent-derivation/
@@ -39,173 +40,92 @@ enum class LossFunction {
 
 
 /**
- * @brief Enum class representing the derivatives (primes) of different loss functions.
+ * @brief Computes the Mean Squared Error (MSE) loss of a sample whose target is a class index.
  * 
- * This enum class defines the derivatives corresponding to each loss function 
- * defined in the `LossFunction` enum. The derivatives are essential for 
- * calculating gradients during the backpropagation phase of neural network training.
- * 
- * - **MEAN_SQUARED_ERROR_PRIME**: Derivative of the mean squared error loss function.
- * 
- * - **SQUARED_ERROR_PRIME**: Derivative of the sum of squared error loss function.
- * 
- * - **CROSS_ENTROPY_PRIME**: Derivative of the cross-entropy loss function.
- * 
- * - **INVALID**: Indicates an unsupported or unrecognized loss function derivative. 
- *   This can be used for error handling and validation.
- */
-enum class LossFunctionPrime {
-    MEAN_SQUARED_ERROR_PRIME,  ///< Derivative of the mean squared error loss function.
-    SQUARED_ERROR_PRIME,       ///< Derivative of the sum of squared error loss function.
-    CROSS_ENTROPY_PRIME,       ///< Derivative of the cross-entropy loss function.
-    INVALID                    ///< Indicates an unsupported loss function prime.
-};
-
-
-/**
- * @brief Computes the Mean Squared Error (MSE) loss between two vectors.
- * 
- * The Mean Squared Error (MSE) is a common loss function used in regression tasks.
- * It measures the average of the squares of the differences between the true values 
- * (yTrue) and the predicted values (yPredicted). A lower MSE indicates that the predicted
- * values are closer to the true values.
+ * yTrue is the one-hot vector of `label`, which is never built.
  * 
  ** Formula: MSE = (1/n) * Σ (yTrue[i] - yPredicted[i])^2
  * 
- * @param yTrue A vector of true/target values. This represents the actual values from the dataset.
- * @param yPredicted A vector of predicted values. These are the values predicted by the model.
+ * @param label The index of the true class.
+ * @param yPredicted Pointer to the predicted values.
+ * @param classes The number of predicted values.
  * 
  * @return The Mean Squared Error (MSE) as a double value.
- * 
- * @note Both vectors should have the same length. If they differ in size, this function may lead to 
- *       undefined behavior or errors.
  */
-double mse_loss(const std::vector<double>& yTrue, const std::vector<double>& yPredicted);
+double sparse_mse_loss(int label, const double* yPredicted, size_t classes);
 
 
 /**
- * @brief Computes the gradient of the Mean Squared Error (MSE) loss function.
- * 
- * The gradient of the Mean Squared Error (MSE) loss function is used in backpropagation to update the 
- * weights and biases of the neural network. It represents the rate of change of the loss with respect 
- * to the predicted values. The gradient is used to adjust the model parameters to minimize the loss.
+ * @brief Computes the gradient of the MSE loss of a sample whose target is a class index.
  * 
- ** Formula: ∂MSE/∂yPredicted[i] = (2/n) * (yPredicted[i] - yTrue[i])
+ ** Formula: ∂MSE/∂yPredicted[i] = (2/n) * (yPredicted[i] - yTrue[i]), yTrue being the one-hot vector of `label`
  * 
- * @param yTrue A vector of true/target values. This represents the actual values from the dataset.
- * @param yPredicted A vector of predicted values. These are the values predicted by the model.
- * 
- * @return A vector containing the gradient of the Mean Squared Error (MSE) loss function with respect to 
- *         each predicted value.
- * 
- * @note Both vectors should have the same length. If they differ in size, this function may lead to 
- *       undefined behavior or errors.
+ * @param label The index of the true class.
+ * @param yPredicted Pointer to the predicted values.
+ * @param classes The number of predicted values.
+ * @param gradient Pointer to the buffer receiving the gradient (classes values).
  */
-std::vector<double> mse_loss_prime(const std::vector<double>& yTrue, const std::vector<double>& yPredicted);
+void sparse_mse_loss_prime(int label, const double* yPredicted, size_t classes, double* gradient);
 
 
 /**
- * @brief Computes the Squared Error Loss between two vectors.
- * 
- * The Squared Error Loss measures the average of the squares of the differences between 
- * the true values (yTrue) and the predicted values (yPredicted). It is similar to 
- * Mean Squared Error but does not divide by the number of samples. A lower loss indicates 
- * that the predictions are closer to the true values.
+ * @brief Computes the Squared Error loss of a sample whose target is a class index.
  * 
- ** Formula: Squared Error Loss = Σ (yTrue[i] - yPredicted[i])^2
+ ** Formula: Squared Error Loss = Σ (yTrue[i] - yPredicted[i])^2, yTrue being the one-hot vector of `label`
  * 
- * @param yTrue A vector of true/target values. This represents the actual values from the dataset.
- * @param yPredicted A vector of predicted values. These are the values predicted by the model.
+ * @param label The index of the true class.
+ * @param yPredicted Pointer to the predicted values.
+ * @param classes The number of predicted values.
  * 
- * @return The Squared Error Loss as a double value.
- * 
- * @note Both vectors should have the same length. If they differ in size, this function may lead to 
- *       undefined behavior or errors.
+ * @return The Squared Error as a double value.
  */
-double squared_error_loss(const std::vector<double>& yTrue, const std::vector<double>& yPredicted);
+double sparse_squared_error_loss(int label, const double* yPredicted, size_t classes);
 
 
 /**
- * @brief Computes the gradient of the Squared Error Loss function.
- * 
- * The gradient of the Squared Error Loss function is used in backpropagation to update the 
- * weights and biases of the neural network. It indicates how the loss changes with respect 
- * to the predicted values. This information is essential for adjusting model parameters to minimize the loss.
- * 
- ** Formula: ∂SquaredError/∂yPredicted[i] = 2 * (yPredicted[i] - yTrue[i])
- * 
- * @param yTrue A vector of true/target values. This represents the actual values from the dataset.
- * @param yPredicted A vector of predicted values. These are the values predicted by the model.
+ * @brief Computes the gradient of the Squared Error loss of a sample whose target is a class index.
  * 
- * @return A vector containing the gradient of the Squared Error Loss function with respect to 
- *         each predicted value.
+ ** Formula: ∂SquaredError/∂yPredicted[i] = 2 * (yPredicted[i] - yTrue[i]), yTrue being the one-hot vector of `label`
  * 
- * @note Both vectors should have the same length. If they differ in size, this function may lead to 
- *       undefined behavior or errors.
+ * @param label The index of the true class.
+ * @param yPredicted Pointer to the predicted values.
+ * @param classes The number of predicted values.
+ * @param gradient Pointer to the buffer receiving the gradient (classes values).
  */
-std::vector<double> squared_error_loss_prime(const std::vector<double>& yTrue, const std::vector<double>& yPredicted);
+void sparse_squared_error_loss_prime(int label, const double* yPredicted, size_t classes, double* gradient);
 
 
 /**
- * @brief Computes the Binary Cross-Entropy Loss between two vectors.
+ * @brief Computes the Binary Cross-Entropy loss of a sample whose target is a class index.
  * 
- * The Binary Cross-Entropy Loss measures the performance of a classification model whose output 
- * is a probability value between 0 and 1. It quantifies the difference between two probability distributions 
- * – the true distribution (yTrue) and the predicted distribution (yPredicted). A lower loss indicates better 
- * performance.
+ * The true class contributes log(yPredicted) and every other output log(1 - yPredicted), so no
+ * term multiplied by zero is computed. The predictions are clamped to [1e-12, 1 - 1e-12].
  * 
- ** Formula: Binary Cross-Entropy Loss = - (1/n) * Σ [yTrue[i] * log(yPredicted[i]) + (1 - yTrue[i]) * log(1 - yPredicted[i])]
+ ** Formula: Binary Cross-Entropy Loss = - Σ [yTrue[i] * log(yPredicted[i]) + (1 - yTrue[i]) * log(1 - yPredicted[i])]
  * 
- * @param yTrue A vector of true binary target values (0 or 1). These represent the actual values from the dataset.
- * @param yPredicted A vector of predicted probabilities (between 0 and 1). These are the values predicted by the model.
+ * @param label The index of the true class.
+ * @param yPredicted Pointer to the predicted probabilities.
+ * @param classes The number of predicted probabilities.
  * 
  * @return The Binary Cross-Entropy Loss as a double value.
- * 
- * @note Both vectors should have the same length. If they differ in size, this function may lead to 
- *       undefined behavior or errors. Additionally, yPredicted values should be between 0 and 1.
  */
-double binary_cross_entropy_loss(const std::vector<double>& yTrue, const std::vector<double>& yPredicted);
+double sparse_binary_cross_entropy_loss(int label, const double* yPredicted, size_t classes);
 
 
 /**
- * @brief Computes the gradient of the Binary Cross-Entropy Loss function.
- * 
- * The gradient of the Binary Cross-Entropy Loss function is used in backpropagation to adjust 
- * the weights and biases of the neural network. It indicates how the loss changes with respect 
- * to the predicted probabilities. This information is crucial for minimizing the loss during training.
- * 
- ** Formula: ∂BinaryCrossEntropy/∂yPredicted[i] = (yPredicted[i] - yTrue[i]) / [yPredicted[i] * (1 - yPredicted[i])]
- * 
- * @param yTrue A vector of true binary target values (0 or 1). These represent the actual values from the dataset.
- * @param yPredicted A vector of predicted probabilities (between 0 and 1). These are the values predicted by the model.
- * 
- * @return A vector containing the gradient of the Binary Cross-Entropy Loss function with respect to 
- *         each predicted probability.
- * 
- * @note Both vectors should have the same length. If they differ in size, this function may lead to 
- *       undefined behavior or errors. Additionally, yPredicted values should be between 0 and 1 to avoid 
- *       division by zero.
- */
-std::vector<double> binary_cross_entropy_loss_prime(const std::vector<double>& yTrue, const std::vector<double>& yPredicted);
-
-
-/**
- * @brief Maps a loss function to its corresponding derivative (prime) function.
- * 
- * This function takes a specified loss function and returns the corresponding 
- * derivative (gradient) function, which will be used during backpropagation.
+ * @brief Computes the gradient of the Binary Cross-Entropy loss of a sample whose target is a class index.
  * 
- * - For each loss function (e.g., `MEAN_SQUARED_ERROR`, `SQUARED_ERROR`, `CROSS_ENTROPY`), 
- *   there is an associated derivative (e.g., `MEAN_SQUARED_ERROR_PRIME`).
+ * This is the derivative with respect to the input of a final Softmax layer, whose own
+ * derivative is skipped by the backward pass.
  * 
- * @param lossFunction The loss function for which the derivative is required.
- * @return The corresponding loss function derivative (as `LossFunctionPrime`), or 
- *         `INVALID` if the loss function is not supported.
+ ** Formula: ∂L/∂yPredicted[i] = yPredicted[i] - yTrue[i], yTrue being the one-hot vector of `label`
  * 
- * @warning If the loss function is not recognized, a warning message is printed, 
- * and the function returns `LossFunctionPrime::INVALID`.
+ * @param label The index of the true class.
+ * @param yPredicted Pointer to the predicted probabilities.
+ * @param classes The number of predicted probabilities.
+ * @param gradient Pointer to the buffer receiving the gradient (classes values).
  */
-LossFunctionPrime select_LossFunction_prime(LossFunction lossFunction);
+void sparse_binary_cross_entropy_loss_prime(int label, const double* yPredicted, size_t classes, double* gradient);
 
 
 /**
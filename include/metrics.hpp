@@ -0,0 +1,83 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include "lossFunctions.hpp"
+
+
+/**
+ * @brief Structure accumulating the classification metrics of one or more batches.
+ *
+ * @param classes The number of classes.
+ * @param samples The number of samples.
+ * @param correct The number of samples whose predicted class is the true one.
+ * @param lossSum The sum of the loss of every sample.
+ * @param confusion The confusion matrix (classes x classes, row = true class, column = predicted class),
+ *                  empty if it is not tracked.
+ */
+struct ClassificationMetrics
+{
+    int classes = 0;
+    int samples = 0;
+    int correct = 0;
+    double lossSum = 0.0;
+    std::vector<int> confusion;
+
+    /**
+     * @brief Clears the metrics.
+     *
+     * @param classes The number of classes.
+     * @param trackConfusion Whether to fill the confusion matrix (allocates classes x classes counters).
+     */
+    void reset(int classes, bool trackConfusion);
+
+    /**
+     * @brief Adds the metrics of other samples (e.g. of another thread).
+     *
+     * The counters are exact whatever the order of the merges, the loss sum is not.
+     *
+     * @param other The metrics to add. Must have the same number of classes.
+     */
+    void merge(const ClassificationMetrics& other);
+
+    /**
+     * @brief Returns the percentage of correctly classified samples.
+     */
+    double accuracy() const;
+
+    /**
+     * @brief Returns the percentage of the samples of a class that were predicted as that class (recall).
+     *
+     * @param label The class.
+     */
+    double classAccuracy(int label) const;
+};
+
+
+/**
+ * @brief Computes the loss, the gradient, the predictions and the metrics of a batch in a single pass.
+ *
+ * Every row of the output block goes through the sparse loss functions, which take the class
+ * index of each sample (see `sparse_binary_cross_entropy_loss`), while the row is still in the
+ * cache, then the metrics are updated with the predicted class. Every output except `metrics` is
+ * optional: testing passes no gradient buffer and then does no gradient work at all.
+ *
+ * @param lossFunction The loss function.
+ * @param outputs Pointer to the outputs of the network (batchSize x classes).
+ * @param labels Pointer to the index of the true class of every sample.
+ * @param batchSize The number of samples.
+ * @param classes The number of outputs of every sample.
+ * @param metrics The metrics updated with the samples of the batch.
+ * @param losses Pointer to the buffer receiving the loss of every sample, or nullptr.
+ * @param predictions Pointer to the buffer receiving the predicted class of every sample, or nullptr.
+ * @param gradients Pointer to the buffer receiving the derivative of the loss (batchSize x classes), or nullptr.
+ */
+void evaluateBatch(LossFunction lossFunction, const double* outputs, const int* labels, size_t batchSize, size_t classes,
+                   ClassificationMetrics& metrics, double* losses, int* predictions, double* gradients);
+
+
+#endif // METRICS_HPP
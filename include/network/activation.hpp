@@ -75,6 +75,20 @@ enum class ActivationType {
 std::vector<double> Activation(ActivationType activationFunction, std::vector<double> inputs);
 
 
+/**
+ * @brief Applies the specified activation function to a buffer of inputs.
+ * 
+ * Same as the vector version, but reads `size` values from `inputs` and writes the result to
+ * `outputs` without any allocation. `inputs` and `outputs` may point to the same buffer.
+ * 
+ * @param activationFunction The type of activation function to apply.
+ * @param inputs Pointer to the input values.
+ * @param outputs Pointer to the buffer receiving the activated values.
+ * @param size The number of values.
+ */
+void Activation(ActivationType activationFunction, const double* inputs, double* outputs, size_t size);
+
+
 /**
  * @brief Converts the ActivationType enum to its corresponding string representation.
  * 
@@ -0,0 +1,70 @@
+#ifndef ARCHITECTURE_HPP
+#define ARCHITECTURE_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "initializer.hpp"
+
+class Network; // Forward declaration of Network class
+
+
+/**
+ * @brief Enum class representing the networks that can be built for the 28x28 grayscale datasets.
+ *
+ * - **MLP**: 784 -> fc128 -> ReLU -> fc10 -> Softmax, about 100k parameters. The hidden layer
+ *   can be made smaller, e.g. to load a network shrunk by neuron pruning.
+ *
+ * - **CNN**: conv 4 filters 3x3 -> ReLU -> max pool 2x2 -> conv 8 filters 3x3 -> ReLU ->
+ *   max pool 2x2 -> fc10 -> Softmax (both convolutions padded to keep the size), about 4k
+ *   parameters and fewer multiply-adds than the MLP.
+ *
+ * - **INVALID**: Indicates an unsupported or unrecognized architecture.
+ */
+enum class NetworkArchitecture {
+    MLP,        ///< Fully connected network.
+    CNN,        ///< Small convolutional network.
+    INVALID     ///< Indicates an unsupported architecture.
+};
+
+
+/**
+ * @brief Adds the layers of an architecture to an empty network.
+ *
+ * Every layer with parameters draws its initial weights from the random stream of its position
+ * among the layers with parameters, so they only depend on the seed and on the architecture.
+ *
+ * @param net The network.
+ * @param architecture The architecture to build.
+ * @param initialization The scheme used to initialize the weights.
+ * @param hiddenSize The number of neurons of the hidden layer of the MLP. Defaults to 128.
+ * @param ranks The rank of every fully connected layer, in order: a layer with a rank r > 0 is built
+ *              as two layers, inputs -> r -> outputs, to load a network factorised by `-Factorize`.
+ *              0 or missing for a plain layer.
+ */
+void buildNetwork(Network& net, NetworkArchitecture architecture, InitializationType initialization, int hiddenSize = 128,
+                  const std::vector<int>& ranks = {});
+
+
+/**
+ * @brief Converts a NetworkArchitecture to its string representation.
+ *
+ * @param architecture The architecture.
+ * @return std::string The name of the architecture, or "None" if it is not supported.
+ */
+std::string NetworkArchitectureToString(NetworkArchitecture architecture);
+
+
+/**
+ * @brief Converts the name of an architecture, as given on the command line, to a NetworkArchitecture.
+ *
+ * The comparison is case-insensitive and accepts "mlp" (or "fc") and "cnn" (or "conv").
+ *
+ * @param name The name of the architecture.
+ * @return NetworkArchitecture The architecture, or NetworkArchitecture::INVALID if the name is not recognised.
+ */
+NetworkArchitecture stringToNetworkArchitecture(const std::string& name);
+
+
+#endif // ARCHITECTURE_HPP
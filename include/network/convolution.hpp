@@ -0,0 +1,240 @@
+#ifndef CONVOLUTION_HPP
+#define CONVOLUTION_HPP
+
+#include <iostream>
+#include <vector>
+
+#include "layer.hpp"
+
+
+/**
+ * @brief The shape of the samples of an image layer.
+ *
+ * A sample is stored channel by channel, each channel row-major (the CHW layout of PyTorch),
+ * so flattening it before a fully connected layer gives the same order as `torch.flatten`.
+ *
+ * @param channels The number of channels (1 for a grayscale image).
+ * @param height The number of rows of each channel.
+ * @param width The number of columns of each channel.
+ */
+struct ImageShape
+{
+    int channels = 0;
+    int height = 0;
+    int width = 0;
+
+    int size() const { return channels * height * width; }
+};
+
+
+/**
+ * @brief Class representing a 2D convolution layer.
+ *
+ * The layer slides `outputSize` filters of `kernelSize x kernelSize` over every channel of its
+ * input. The convolution is lowered to a matrix product (im2col): the input patches of a batch
+ * are copied one per row into a `(batchSize x positions) x (channels x kernelSize²)` matrix, so
+ * the filters are exactly the weights of a fully connected layer with `inputSize = channels x
+ * kernelSize²` inputs and the forward and backward passes run through the same GEMM kernel as
+ * `Layer` (see `forwardBatch` and `backwardBatch`).
+ *
+ * The weights are stored row-major, one filter per row, in the layout of PyTorch's
+ * `conv.weight` (filters x channels x kernelSize x kernelSize). They are saved and loaded as
+ * `conv<k>.weight` and `conv<k>.bias`.
+ */
+class Conv2DLayer : public Layer {
+
+    public:
+
+        ImageShape inputShape;      ///< The shape of each input sample.
+        ImageShape outputShape;     ///< The shape of each output sample (one channel per filter).
+        int kernelSize;             ///< The height and width of the filters.
+        int stride;                 ///< The step between two positions of the filters.
+        int padding;                ///< The number of rows and columns of zeros added around the input.
+
+
+        /**
+         * @brief Constructs a Conv2DLayer object.
+         *
+         * The program exits if the filters do not fit in the padded input.
+         *
+         * @param inputShape The shape of each input sample.
+         * @param filters The number of filters (the channels of the output).
+         * @param kernelSize The height and width of the filters.
+         * @param stride The step between two positions of the filters. Defaults to 1.
+         * @param padding The number of rows and columns of zeros around the input. Defaults to 0.
+         * @param initialization The scheme used to initialize the weights. Defaults to Glorot.
+         * @param stream The random stream of the weights (see `Layer::Layer`). Defaults to 0.
+         */
+        Conv2DLayer(ImageShape inputShape, int filters, int kernelSize, int stride = 1, int padding = 0,
+                    InitializationType initialization = InitializationType::GLOROT, uint64_t stream = 0);
+
+
+        /**
+         * @brief Returns the type of the layer as LayerType::ConvolutionLayer.
+         */
+        virtual LayerType getType() const override { return LayerType::ConvolutionLayer; }
+
+
+        /**
+         * @brief Returns the number of values of each input sample (channels x height x width).
+         */
+        int expectedInputWidth() const override { return inputShape.size(); }
+
+
+        /**
+         * @brief Returns the number of values of each output sample (filters x output height x output width).
+         */
+        int outputWidth(int inputWidth) const override { (void)inputWidth; return outputShape.size(); }
+
+
+        /**
+         * @brief Computes the output of the layer for a batch held in buffers owned by the caller.
+         *
+         * outputs = im2col(inputs) x Wᵀ + biases, then every sample is stored back in the CHW layout.
+         *
+         * @param inputs Pointer to the input batch (batchSize x inputShape.size()).
+         * @param inputWidth The number of values of each input sample.
+         * @param outputs Pointer to the output batch (batchSize x outputShape.size()).
+         * @param batchSize The number of samples in the batch.
+         */
+        void forwardBatch(const double* inputs, int inputWidth, double* outputs, int batchSize) const override;
+        using Layer::forwardBatch;
+
+
+        /**
+         * @brief Performs the backward pass for a whole batch of samples.
+         *
+         * The patches of the inputs are lowered again with im2col and the dense backward pass
+         * gives gradients.weights = errorᵀ x patches and the error of every patch, which col2im
+         * adds back to the input pixels it was copied from.
+         *
+         * @param inputs The input batch given to `forwardBatch`.
+         * @param outputs Not used in this layer.
+         * @param error The error of the output batch.
+         * @param inputError The error propagated to the previous layer (batchSize x inputShape.size()), resized if needed.
+         * @param gradients The gradients of the filters and biases, summed over the batch, resized if needed.
+         * @param batchSize The number of samples in the batch.
+         * @param computeInputError Whether the error for the previous layer is needed (false for the first layer).
+         */
+        void backwardBatch(const std::vector<double>& inputs, const std::vector<double>& outputs, const std::vector<double>& error,
+                           std::vector<double>& inputError, LayerGradients& gradients, int batchSize, bool computeInputError) const override;
+
+
+        /**
+         * @brief Destructor for the Conv2DLayer class.
+         */
+        virtual ~Conv2DLayer() { }
+
+    private:
+
+        /**
+         * @brief Copies the patches of a batch, one per row: row (n x positions + p) holds the
+         *        channels x kernelSize² input values seen by the filters at position p of sample n
+         *        (0 for the padding).
+         */
+        void im2col(const double* inputs, int batchSize, double* patches) const;
+
+
+        /**
+         * @brief Adds every value of the patch matrix back to the input value it was copied from.
+         */
+        void col2im(const double* patches, int batchSize, double* inputs) const;
+
+};
+
+
+/**
+ * @brief Class representing a 2D max pooling layer.
+ *
+ * Every channel is cut in `poolSize x poolSize` windows, `stride` apart, and each window is
+ * replaced by its largest value. The layer has no parameters.
+ */
+class MaxPool2DLayer : public Layer {
+
+    public:
+
+        ImageShape inputShape;      ///< The shape of each input sample.
+        ImageShape outputShape;     ///< The shape of each output sample (same channels).
+        int poolSize;               ///< The height and width of the windows.
+        int stride;                 ///< The step between two windows.
+
+
+        /**
+         * @brief Constructs a MaxPool2DLayer object.
+         *
+         * The program exits if the window does not fit in the input.
+         *
+         * @param inputShape The shape of each input sample.
+         * @param poolSize The height and width of the windows.
+         * @param stride The step between two windows. Defaults to 0, meaning the size of the windows.
+         */
+        MaxPool2DLayer(ImageShape inputShape, int poolSize, int stride = 0);
+
+
+        /**
+         * @brief Returns the type of the layer as LayerType::PoolingLayer.
+         */
+        virtual LayerType getType() const override { return LayerType::PoolingLayer; }
+
+
+        /**
+         * @brief A pooling layer has no parameters.
+         */
+        bool hasParameters() const override { return false; }
+
+
+        /**
+         * @brief Returns the number of values of each input sample (channels x height x width).
+         */
+        int expectedInputWidth() const override { return inputShape.size(); }
+
+
+        /**
+         * @brief Returns the number of values of each output sample.
+         */
+        int outputWidth(int inputWidth) const override { (void)inputWidth; return outputShape.size(); }
+
+
+        /**
+         * @brief Replaces every window of every sample of a batch by its largest value.
+         *
+         * @param inputs Pointer to the input batch (batchSize x inputShape.size()).
+         * @param inputWidth The number of values of each input sample.
+         * @param outputs Pointer to the output batch (batchSize x outputShape.size()).
+         * @param batchSize The number of samples in the batch.
+         */
+        void forwardBatch(const double* inputs, int inputWidth, double* outputs, int batchSize) const override;
+        using Layer::forwardBatch;
+
+
+        /**
+         * @brief Routes the error of every window to the input that held its largest value.
+         *
+         * @param inputs The input batch given to `forwardBatch`.
+         * @param outputs Not used in this layer, the largest values are found again in the inputs.
+         * @param error The error of the output batch.
+         * @param inputError The error propagated to the previous layer, resized if needed.
+         * @param gradients Not used in this layer, it has no parameters.
+         * @param batchSize The number of samples in the batch.
+         * @param computeInputError Whether the error for the previous layer is needed.
+         */
+        void backwardBatch(const std::vector<double>& inputs, const std::vector<double>& outputs, const std::vector<double>& error,
+                           std::vector<double>& inputError, LayerGradients& gradients, int batchSize, bool computeInputError) const override;
+
+
+        /**
+         * @brief Destructor for the MaxPool2DLayer class.
+         */
+        virtual ~MaxPool2DLayer() { }
+
+    private:
+
+        /**
+         * @brief Returns the index, in its sample, of the largest input of a window (the first one on ties).
+         */
+        int windowMaximum(const double* sample, int channel, int y, int x) const;
+
+};
+
+
+#endif // CONVOLUTION_HPP
@@ -0,0 +1,304 @@
+#ifndef FIXEDNETWORK_HPP
+#define FIXEDNETWORK_HPP
+
+#include <iostream>
+#include <array>
+#include <tuple>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include "activation.hpp"
+#include "layer.hpp"
+#include "network.hpp"
+
+
+/**
+ * @brief Fully connected layer with a fused activation whose shape is known at compile time.
+ *
+ * This is the compile-time counterpart of a `Layer` followed by an `ActivationLayer`. Both the
+ * input and output sizes and the activation function are template parameters, so every loop
+ * has a constant trip count and the compiler is free to unroll and vectorise it.
+ *
+ * The weights are stored transposed (input-major, `InputSize x OutputSize`) so the inner loop
+ * of the forward pass walks contiguous memory across the outputs. That loop is a plain
+ * element-wise multiply-add and vectorises without reassociating any floating point sums.
+ *
+ * @tparam InputSize The number of inputs of the layer.
+ * @tparam OutputSize The number of neurons of the layer.
+ * @tparam Act The activation applied to the output (ActivationType::INVALID means no activation).
+ */
+template <int InputSize, int OutputSize, ActivationType Act>
+class FixedDenseLayer {
+
+    static_assert(InputSize > 0 && OutputSize > 0, "FixedDenseLayer sizes must be positive.");
+
+    public:
+
+        static constexpr int inputSize = InputSize;          ///< The number of inputs of the layer.
+        static constexpr int outputSize = OutputSize;        ///< The number of neurons of the layer.
+        static constexpr ActivationType activation = Act;    ///< The activation fused into the layer.
+
+        alignas(64) std::array<double, InputSize * OutputSize> weights {};  ///< Transposed weights (input-major).
+        alignas(64) std::array<double, OutputSize> biases {};               ///< The biases of the layer.
+
+
+        /**
+         * @brief Copies the weights and biases of a runtime layer into the fixed layer.
+         *
+         * The runtime layer stores one row of weights per neuron, so the values are transposed
+         * while they are copied.
+         *
+         * @param weights A 2D vector containing the weights for each neuron (OutputSize x InputSize).
+         * @param biases A vector containing the biases for each neuron.
+         * @return true if the shapes match and the values were imported, false otherwise.
+         */
+        bool importWeightsBiases(const std::vector<std::vector<double>>& weights, const std::vector<double>& biases)
+        {
+            if (static_cast<int>(weights.size()) != OutputSize || static_cast<int>(biases.size()) != OutputSize)
+            {
+                printf("Error: Weights vector size: %ld or Biases size: %ld does not match the number of neurons: %d\n", weights.size(), biases.size(), OutputSize);
+                return false;
+            }
+
+            for (int o = 0; o < OutputSize; o++)
+            {
+                if (static_cast<int>(weights[o].size()) != InputSize)
+                {
+                    printf("Error: Weights size: %ld does not match the number of inputs: %d\n", weights[o].size(), InputSize);
+                    return false;
+                }
+
+                for (int i = 0; i < InputSize; i++)
+                    this->weights[i * OutputSize + o] = weights[o][i];
+
+                this->biases[o] = biases[o];
+            }
+
+            return true;
+        }
+
+
+        /**
+         * @brief Computes the output of the layer, activation included.
+         *
+         * @param inputs Pointer to InputSize input values.
+         * @param outputs Pointer to OutputSize values that receive the result.
+         */
+        void forward(const double* inputs, double* outputs) const
+        {
+            for (int o = 0; o < OutputSize; o++)
+                outputs[o] = biases[o];
+
+            for (int i = 0; i < InputSize; i++)
+            {
+                const double x = inputs[i];
+                const double* row = &weights[i * OutputSize];
+
+                for (int o = 0; o < OutputSize; o++)
+                    outputs[o] += row[o] * x;
+            }
+
+            activate(outputs);
+        }
+
+
+    private:
+
+        /**
+         * @brief Applies the compile-time activation function in place.
+         *
+         * Mirrors `Activation()` for the forward activations, including the numerically
+         * stable softmax.
+         *
+         * @param values Pointer to OutputSize values.
+         */
+        static void activate(double* values)
+        {
+            if constexpr (Act == ActivationType::RELU)
+            {
+                for (int o = 0; o < OutputSize; o++)
+                    values[o] = std::max(0.0, values[o]);
+            }
+            else if constexpr (Act == ActivationType::SIGMOID)
+            {
+                for (int o = 0; o < OutputSize; o++)
+                    values[o] = 1 / (1 + std::exp(-values[o]));
+            }
+            else if constexpr (Act == ActivationType::TANH)
+            {
+                for (int o = 0; o < OutputSize; o++)
+                    values[o] = std::tanh(values[o]);
+            }
+            else if constexpr (Act == ActivationType::SOFTMAX)
+            {
+                double D = -*std::max_element(values, values + OutputSize);
+                double Z = 0.0;
+
+                for (int o = 0; o < OutputSize; o++)
+                {
+                    values[o] = std::exp(values[o] + D);
+                    Z += values[o];
+                }
+
+                for (int o = 0; o < OutputSize; o++)
+                    values[o] /= Z;
+            }
+            else
+            {
+                static_assert(Act == ActivationType::INVALID, "Only forward activations can be fused into a FixedDenseLayer.");
+            }
+        }
+
+};
+
+
+/**
+ * @brief Neural network whose topology is fixed at compile time.
+ *
+ * The FixedNetwork is an inference-only alternative to `Network` for a topology that is
+ * known when the program is built. The layers are held by value, there is no virtual
+ * dispatch, and every intermediate activation lives in a fixed-size buffer on the stack.
+ *
+ * Example, the model built in `main.cpp`:
+ * @code
+ * using DeployedNetwork = FixedNetwork<FixedDenseLayer<784, 128, ActivationType::RELU>,
+ *                                      FixedDenseLayer<128, 10, ActivationType::SOFTMAX>>;
+ * @endcode
+ *
+ * The weights are trained with the runtime `Network` and copied in with `importFromNetwork`.
+ *
+ * @tparam FixedLayers The sequence of FixedDenseLayer types, from input to output.
+ */
+template <typename... FixedLayers>
+class FixedNetwork {
+
+    static_assert(sizeof...(FixedLayers) > 0, "FixedNetwork needs at least one layer.");
+
+    using LayerTuple = std::tuple<FixedLayers...>;
+
+    template <std::size_t I>
+    using LayerAt = std::tuple_element_t<I, LayerTuple>;
+
+    public:
+
+        static constexpr int layerCount = sizeof...(FixedLayers);                           ///< The number of fixed layers.
+        static constexpr int inputSize = LayerAt<0>::inputSize;                             ///< The number of inputs of the network.
+        static constexpr int outputSize = LayerAt<sizeof...(FixedLayers) - 1>::outputSize;  ///< The number of outputs of the network.
+
+        LayerTuple layers;  ///< The layers of the network, held by value.
+
+
+        /**
+         * @brief Imports the weights and biases of a runtime network.
+         *
+         * The runtime network must have the same sequence of layers: every FixedDenseLayer
+         * matches a standard layer of the same size, followed by an activation layer with the
+         * same activation function (unless the fixed layer has no activation).
+         *
+         * @param net The runtime network to copy the parameters from.
+         * @return true if the topology matches and all the parameters were imported, false otherwise.
+         */
+        bool importFromNetwork(Network& net)
+        {
+            size_t position = 0;
+            return importLayer<0>(net, position);
+        }
+
+
+        /**
+         * @brief Performs forward propagation through the network.
+         *
+         * @param inputs Pointer to inputSize input values.
+         * @param outputs Pointer to outputSize values that receive the output of the network.
+         */
+        void forwardPropagation(const double* inputs, double* outputs) const
+        {
+            forwardFrom<0>(inputs, outputs);
+        }
+
+
+        /**
+         * @brief Performs forward propagation through the network.
+         *
+         * @param inputs Pointer to inputSize input values.
+         * @return The output of the network.
+         */
+        std::array<double, outputSize> forwardPropagation(const double* inputs) const
+        {
+            std::array<double, outputSize> outputs;
+            forwardFrom<0>(inputs, outputs.data());
+            return outputs;
+        }
+
+
+    private:
+
+        template <std::size_t I>
+        void forwardFrom(const double* inputs, double* outputs) const
+        {
+            if constexpr (I + 1 == sizeof...(FixedLayers))
+            {
+                std::get<I>(layers).forward(inputs, outputs);
+            }
+            else
+            {
+                static_assert(LayerAt<I>::outputSize == LayerAt<I + 1>::inputSize, "Consecutive FixedNetwork layers must have matching sizes.");
+
+                alignas(64) double hidden[LayerAt<I>::outputSize];
+                std::get<I>(layers).forward(inputs, hidden);
+                forwardFrom<I + 1>(hidden, outputs);
+            }
+        }
+
+
+        template <std::size_t I>
+        bool importLayer(Network& net, size_t& position)
+        {
+            if constexpr (I == sizeof...(FixedLayers))
+            {
+                if (position != net.Layers.size())
+                {
+                    printf("Error: The network has more layers than the fixed network.\n");
+                    return false;
+                }
+                return true;
+            }
+            else
+            {
+                if (position >= net.Layers.size() || net.Layers[position]->getType() != LayerType::StandardLayer)
+                {
+                    printf("Error: Expected a standard layer at position %zu of the network.\n", position);
+                    return false;
+                }
+
+                std::vector<std::vector<double>> weights;
+                std::vector<double> biases;
+                net.Layers[position]->saveWeightsBiases(weights, biases);
+                position++;
+
+                if (!std::get<I>(layers).importWeightsBiases(weights, biases))
+                    return false;
+
+                if constexpr (LayerAt<I>::activation != ActivationType::INVALID)
+                {
+                    ActivationLayer* activationLayer = nullptr;
+                    if (position < net.Layers.size())
+                        activationLayer = dynamic_cast<ActivationLayer*>(net.Layers[position].get());
+
+                    if (activationLayer == nullptr || activationLayer->activationFunction != LayerAt<I>::activation)
+                    {
+                        printf("Error: Expected a %s activation layer at position %zu of the network.\n", ActivationTypeToString(LayerAt<I>::activation).c_str(), position);
+                        return false;
+                    }
+                    position++;
+                }
+
+                return importLayer<I + 1>(net, position);
+            }
+        }
+
+};
+
+
+#endif // FIXEDNETWORK_HPP
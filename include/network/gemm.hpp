@@ -0,0 +1,134 @@
+#ifndef GEMM_HPP
+#define GEMM_HPP
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+/**
+ * @brief Block sizes used by the cache-blocked GEMM kernel.
+ *
+ * The kernel follows the classic Goto/BLIS loop structure. The K dimension is cut in panels
+ * of `kc` values, a `kc x nc` panel of B is packed so it stays in the L2/L3 cache, and a
+ * `mc x kc` block of A is packed so it stays in the L2 cache while the register-tiled
+ * micro-kernel streams through the packed B panel from L1.
+ *
+ * @param mc The number of rows of A packed at a time.
+ * @param kc The depth of the packed panels.
+ * @param nc The number of columns of B packed at a time.
+ */
+struct GemmTiling
+{
+    int mc = 64;
+    int kc = 256;
+    int nc = 512;
+};
+
+
+/**
+ * @brief Computes the general matrix product C = alpha * op(A) * op(B) + beta * C.
+ *
+ * All the matrices are stored row-major. op(A) is an `M x K` matrix and op(B) a `K x N`
+ * matrix, where op(X) is X itself or its transpose as selected by `transA` and `transB`.
+ * These are the three products needed by a dense layer working on a batch:
+ *
+ * - Forward pass:   outputs = inputs x Wᵀ        (transB)
+ * - Weight update:  gradW   = errorᵀ x inputs    (transA)
+ * - Error to input: dInputs = error x W
+ *
+ * Large products go through the cache-blocked, packed and register-tiled kernel using the
+ * tiling returned by `gemmTiling()`. Products too small to amortise the packing (e.g. a
+ * single sample) use a direct loop instead.
+ * 
+ * When the project is configured with `-DVANILLANET_BLAS=ON` and a CBLAS library is found,
+ * every product is forwarded to `cblas_dgemm` instead (see `gemmBackendName()`).
+ *
+ * @param transA Whether A is transposed.
+ * @param transB Whether B is transposed.
+ * @param M The number of rows of op(A) and C.
+ * @param N The number of columns of op(B) and C.
+ * @param K The number of columns of op(A) and rows of op(B).
+ * @param alpha The scaling factor of the product.
+ * @param A Pointer to the first element of A.
+ * @param lda The distance between two rows of A.
+ * @param B Pointer to the first element of B.
+ * @param ldb The distance between two rows of B.
+ * @param beta The scaling factor of C. When it is 0 the previous content of C is ignored.
+ * @param C Pointer to the first element of C.
+ * @param ldc The distance between two rows of C.
+ */
+void gemm(bool transA, bool transB, int M, int N, int K,
+          double alpha, const double* A, int lda, const double* B, int ldb,
+          double beta, double* C, int ldc);
+
+
+/**
+ * @brief Writes the transpose of a row-major matrix: B = Aᵀ.
+ *
+ * The matrix is copied in small square tiles, so the strided side of the copy stays in the cache.
+ *
+ * @param A Pointer to the matrix (rows x cols).
+ * @param rows The number of rows of A.
+ * @param cols The number of columns of A.
+ * @param B Pointer to the transpose (cols x rows), overwritten. It must not overlap A.
+ */
+void transpose(const double* A, int rows, int cols, double* B);
+
+
+/**
+ * @brief Returns the name of the backend computing the matrix products.
+ *
+ * @return "CBLAS (<vendor>)" when the products are forwarded to a CBLAS library, or
+ *         "In-tree blocked GEMM" otherwise.
+ */
+std::string gemmBackendName();
+
+
+/**
+ * @brief Returns the block sizes used by the GEMM kernel.
+ *
+ * These are the default block sizes of `GemmTiling` until `loadGemmTiling` is called, so the
+ * library never tunes, reads or writes files, nor prints anything on its own.
+ *
+ * @return A reference to the tiling in use.
+ */
+GemmTiling& gemmTiling();
+
+
+/**
+ * @brief Uses the block sizes tuned for this machine from then on, tuning them if needed.
+ *
+ * The tiling is read from the cache file returned by `gemmTilingCachePath()`. If this machine
+ * has no entry yet, `tuneGemmTiling()` is run (a few seconds) and the result is saved in the
+ * cache, so the tuning only happens once per machine. Only the first call does anything: the
+ * command line tool calls it at startup, before any product.
+ *
+ * @param log The stream receiving the message printed after a tuning.
+ */
+void loadGemmTiling(FILE* log);
+
+
+/**
+ * @brief Finds the fastest block sizes for the GEMM kernel on this machine.
+ *
+ * Times the forward and the weight gradient products of a 784x128 layer on a batch of 64
+ * samples for every candidate tiling and returns the fastest one.
+ *
+ * @return The fastest tiling among the candidates.
+ */
+GemmTiling tuneGemmTiling();
+
+
+/**
+ * @brief Returns the path of the file caching the tuned GEMM block sizes.
+ *
+ * The file is a JSON object with an entry per machine (host name).
+ *
+ * @return The path of the cache file.
+ */
+std::string gemmTilingCachePath();
+
+
+#endif // GEMM_HPP
@@ -0,0 +1,79 @@
+#ifndef INITIALIZER_HPP
+#define INITIALIZER_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cmath>
+
+
+/**
+ * @brief Enum class representing the schemes used to initialize the weights of a layer.
+ *
+ * All the schemes draw the weights from a uniform distribution in [-limit, limit]:
+ *
+ * - **GLOROT**: Glorot (Xavier), limit = √(6 / (inputSize + outputSize)). Suited to tanh and sigmoid.
+ *
+ * - **HE**: He (Kaiming), limit = √(6 / inputSize). Suited to ReLU.
+ *
+ * - **LECUN**: LeCun, limit = √(3 / inputSize). Suited to SELU and linear layers.
+ *
+ * - **INVALID**: Indicates an unsupported or unrecognized scheme.
+ */
+enum class InitializationType {
+    GLOROT,     ///< Glorot (Xavier) uniform initialization.
+    HE,         ///< He (Kaiming) uniform initialization.
+    LECUN,      ///< LeCun uniform initialization.
+    INVALID     ///< Indicates an unsupported scheme.
+};
+
+
+/**
+ * @brief Returns the bound of the uniform distribution of an initialization scheme.
+ *
+ * @param type The initialization scheme.
+ * @param inputSize The number of inputs of the layer (fan-in).
+ * @param outputSize The number of neurons of the layer (fan-out).
+ * @return double The limit of the distribution [-limit, limit].
+ */
+double initializationLimit(InitializationType type, int inputSize, int outputSize);
+
+
+/**
+ * @brief Fills the weights of a layer with random values, in parallel.
+ *
+ * The weights are generated with a counter-based generator: weight `i` is a hash of the global
+ * seed (see `setGlobalSeed`), of `stream` and of `i`, so the rows can be filled by any number of
+ * threads in any order and the result only depends on the seed and on the stream.
+ *
+ * @param type The initialization scheme.
+ * @param inputSize The number of inputs of the layer.
+ * @param outputSize The number of neurons of the layer.
+ * @param stream The number of the random stream of the layer (one per layer).
+ * @param weights The weights to fill (row-major, outputSize x inputSize), resized if needed.
+ */
+void initializeWeights(InitializationType type, int inputSize, int outputSize, uint64_t stream, std::vector<double>& weights);
+
+
+/**
+ * @brief Converts an InitializationType to its string representation.
+ *
+ * @param type The initialization scheme.
+ * @return std::string The name of the scheme, or "None" if it is not supported.
+ */
+std::string InitializationTypeToString(InitializationType type);
+
+
+/**
+ * @brief Converts the name of an initialization scheme, as given on the command line, to an InitializationType.
+ *
+ * The comparison is case-insensitive and accepts "glorot" (or "xavier"), "he" (or "kaiming") and "lecun".
+ *
+ * @param name The name of the scheme.
+ * @return InitializationType The scheme, or InitializationType::INVALID if the name is not recognised.
+ */
+InitializationType stringToInitializationType(const std::string& name);
+
+
+#endif // INITIALIZER_HPP
@@ -4,19 +4,43 @@
 #include <iostream>
 #include <vector>
 
-#include "neuron.hpp"
+#include "initializer.hpp"
 #include "activation.hpp"
+#include "gemm.hpp"
+#include "optimizer.hpp"
+#include "sparse.hpp"
+#include "quantization.hpp"
+
+
+// Above this fraction of non-zero inputs in a batch the dense products are faster than gathering them
+static constexpr double MAX_INPUT_DENSITY = 0.4;
 
 
 /**
  * @brief Enum representing the type of a layer in a neural network.
  * 
- * The LayerType enum is used to specify the type of a layer in a neural network.
- * The two possible types are StandardLayer and ActivationLayer.
+ * The LayerType enum is used to specify the type of a layer in a neural network:
+ * a fully connected StandardLayer, an ActivationLayer, a ConvolutionLayer (`Conv2DLayer`)
+ * or a PoolingLayer (`MaxPool2DLayer`).
  */
 enum class LayerType {
     StandardLayer,
-    ActivationLayer
+    ActivationLayer,
+    ConvolutionLayer,
+    PoolingLayer
+};
+
+
+/**
+ * @brief Structure holding the gradients of the weights and biases of a layer for a batch.
+ * 
+ * The gradients use the same contiguous layout as the layer parameters: `weights` is a
+ * row-major `outputSize x inputSize` matrix and `biases` has one value per neuron.
+ */
+struct LayerGradients
+{
+    std::vector<double> weights;   ///< The gradients of the weights (outputSize x inputSize).
+    std::vector<double> biases;    ///< The gradients of the biases (outputSize).
 };
 
 
@@ -27,14 +51,24 @@ enum class LayerType {
  * neurons, the number of inputs to each neuron, and the weights and biases of each neuron.
  * It provides methods for computing the output of the layer based on its neurons and for
  * importing weights and biases into the layer.
+ * 
+ * The weights of all the neurons are stored in a single contiguous row-major matrix
+ * (`outputSize x inputSize`), one row per neuron, so a whole batch can be processed with
+ * a single matrix product (see `forwardBatch` and `backwardBatch`).
  */
 class Layer {
 
     public:
 
-        std::vector<Neuron> neurons;                ///< A vector containing the neurons in the layer.
         int inputSize;                              ///< The number of inputs to each neuron in the layer.
         int outputSize;                             ///< The number of neurons in the layer.
+        std::vector<double> weights;                ///< The weights of the neurons (row-major, outputSize x inputSize).
+        std::vector<double> biases;                 ///< The biases of the neurons.
+        SparseMatrix sparseWeights;                 ///< The non-zero weights in the CSR format once the layer is pruned (empty for a dense layer).
+        PackedWeights packedWeights;                ///< The binary or ternary weights packed into bit-planes once the layer is quantized (empty otherwise).
+        std::vector<double> quantizedWeights;       ///< The binary or ternary weights as a dense matrix, used to propagate the error of a quantized layer.
+        std::vector<double> transposedWeights;      ///< The weights transposed (inputSize x outputSize) once the layer skips its zero inputs (empty otherwise).
+        OptimizerState optimizerState;              ///< The state of the optimiser, in the same layout as the weights and biases.
         std::vector<double> inputs;                 ///< The input of the layer.
         std::vector<double> outputs;                ///< The output of the layer.
 
@@ -47,8 +81,11 @@ class Layer {
          * 
          * @param inputSize The number of inputs to each neuron in the layer.
          * @param outputSize The number of neurons to be created in the layer.
+         * @param initialization The scheme used to initialize the weights. Defaults to Glorot.
+         * @param stream The random stream of the weights, the position of the layer among the layers
+         *               with parameters of its network (see `buildNetwork`). Defaults to 0.
          */
-        Layer(int inputSize, int outputSize);
+        Layer(int inputSize, int outputSize, InitializationType initialization = InitializationType::GLOROT, uint64_t stream = 0);
 
 
         /**
@@ -61,6 +98,20 @@ class Layer {
         virtual LayerType getType() const { return LayerType::StandardLayer; }
 
 
+        /**
+         * @brief Returns true if the layer has weights and biases to train, save and load.
+         */
+        virtual bool hasParameters() const { return true; }
+
+
+        /**
+         * @brief Returns the number of values of each input sample the layer expects.
+         * 
+         * @return int The number of inputs of each neuron, or 0 for a layer taking any width.
+         */
+        virtual int expectedInputWidth() const { return inputSize; }
+
+
         /**
          * @brief Returns the number of neurons in the layer.
          * 
@@ -76,7 +127,8 @@ class Layer {
          * provided vectors. It checks for size compatibility between the input weights, biases,
          * and the number of neurons in the layer before proceeding with the updates. If any
          * mismatches are found, appropriate error messages are printed, and the method returns 
-         * early without modifying the neurons.
+         * early without modifying the neurons. A pruned layer keeps its sparsity pattern (the new
+         * weights outside it are set to 0) and a quantized layer quantizes the new weights.
          * 
          * @param weights A 2D vector containing the weights for each neuron.
          * @param biases A vector containing the biases for each neuron.
@@ -110,24 +162,202 @@ class Layer {
 
 
         /**
-         * @brief Performs the backward pass for a single layer, computing the gradients for the weights, biases, 
-         *        and propagating the error back to the previous layer.
+         * @brief Computes the output of the layer for a whole batch of samples.
+         * 
+         * The samples are stored row-major, one sample per row. The output of the batch is
+         * computed with a single matrix product: outputs = inputs x Wᵀ + biases (by `spmm`
+         * once the layer is pruned, see `prune`, and by `packedGemm` once it is quantized, see `quantize`).
+         * A layer skipping its zero inputs (see `exploitInputSparsity`) gathers the rows of Wᵀ
+         * selected by the non-zero inputs of every sample with `gatherRows` instead, as long as the
+         * batch has few enough of them.
+         * Unlike `forwardPass`, this method does not store anything in the layer, so the same
+         * layer can be evaluated on several batches at the same time.
          * 
-         * @param error The error from the output layer or the next layer (depending on the position of the current layer).
-         * @param weights A reference to the weights of the current layer, which will be updated with the computed gradients.
-         * @param biases A reference to the biases of the current layer, which will be updated with the computed gradients.
-         * @return std::vector<double> The error propagated back to the previous layer.
+         * @param inputs The input batch (batchSize x inputSize).
+         * @param outputs The output batch (batchSize x outputSize), resized if needed.
+         * @param batchSize The number of samples in the batch.
          */
-        virtual std::vector<double> backwardPass(std::vector<double>& error, std::vector<std::vector<double>>& weights, std::vector<double>& biases);
+        void forwardBatch(const std::vector<double>& inputs, std::vector<double>& outputs, int batchSize) const;
+
 
         /**
-         * @brief Updates the weights and biases of the neurons in the layer using the calculated gradients and the learning rate.
+         * @brief Computes the output of the layer for a batch held in buffers owned by the caller.
+         * 
+         * Same computation as the other overload, without any allocation: `outputs` must hold
+         * batchSize x `outputWidth(inputWidth)` values.
          * 
-         * @param learningRate The step size used for updating the weights and biases.
-         * @param gradientsWeights The gradients for the weights of each neuron in the layer.
-         * @param gradientsBiases The gradients for the biases of each neuron in the layer.
+         * @param inputs Pointer to the input batch (batchSize x inputWidth).
+         * @param inputWidth The number of values of each input sample.
+         * @param outputs Pointer to the output batch.
+         * @param batchSize The number of samples in the batch.
          */
-        void updateWeightsBiases(double learningRate, std::vector<std::vector<double>> weights, std::vector<double> biases);
+        virtual void forwardBatch(const double* inputs, int inputWidth, double* outputs, int batchSize) const;
+
+
+        /**
+         * @brief Returns the number of values of each output sample for a given input width.
+         * 
+         * @param inputWidth The number of values of each input sample.
+         * @return int The number of neurons of the layer.
+         */
+        virtual int outputWidth(int inputWidth) const { (void)inputWidth; return outputSize; }
+
+
+        /**
+         * @brief Performs the backward pass for a whole batch of samples.
+         * 
+         * Computes the gradients of the weights and biases summed over the batch:
+         * gradients.weights = errorᵀ x inputs and gradients.biases = Σ error, and the error
+         * propagated to the previous layer: inputError = error x W. For a quantized layer W is the
+         * quantized matrix and the gradients go unchanged to the real-valued weights (straight-through estimator).
+         * A layer skipping its zero inputs scatters the error of every sample into the rows of its
+         * non-zero inputs with `scatterRows` instead of the dense product for the weights.
+         * 
+         * @param inputs The input batch given to `forwardBatch` (batchSize x inputSize).
+         * @param outputs The output batch computed by `forwardBatch` (batchSize x outputSize).
+         * @param error The error of the output batch (batchSize x outputSize).
+         * @param inputError The error propagated to the previous layer (batchSize x inputSize), resized if needed.
+         * @param gradients The gradients of the layer, summed over the batch, resized if needed.
+         * @param batchSize The number of samples in the batch.
+         * @param computeInputError Whether the error for the previous layer is needed (false for the first layer).
+         */
+        virtual void backwardBatch(const std::vector<double>& inputs, const std::vector<double>& outputs, const std::vector<double>& error,
+                                   std::vector<double>& inputError, LayerGradients& gradients, int batchSize, bool computeInputError) const;
+
+
+        /**
+         * @brief Applies one step of the selected optimiser with gradients in the contiguous layout.
+         * 
+         * The state buffers of the optimiser are allocated on the first call, or when the
+         * optimiser changes, and then updated in place together with the weights and biases by
+         * a single fused pass (see `optimizerStep`). The decoupled weight decay of AdamW only
+         * applies to the weights. The weights of a pruned layer are then set back to its sparsity mask
+         * and the weights of a quantized layer are quantized again.
+         * 
+         * @param gradients The gradients of the weights and biases.
+         * @param optimizer The optimiser and its hyper-parameters.
+         * @param learningRate The step size.
+         * @param gradientScale The factor applied to the gradients (1 / batchSize if the gradients are summed over a batch).
+         * @param step The step of the update, counted from 1, used by the bias correction of Adam.
+         *             0 (default) takes the step after the previous update of the layer. The
+         *             layer only records the step in that case, so concurrent updates given their
+         *             own step do not write to the shared state.
+         */
+        void applyOptimizer(const LayerGradients& gradients, const OptimizerSettings& optimizer, double learningRate, double gradientScale, long step = 0);
+
+
+        /**
+         * @brief Allocates the state buffers of the optimiser if the layer does not have them yet.
+         * 
+         * Called by `applyOptimizer`, and before updates run concurrently so that none of them
+         * reallocates the buffers the others are writing to.
+         * 
+         * @param optimizer The optimiser and its hyper-parameters.
+         */
+        void prepareOptimizer(const OptimizerSettings& optimizer);
+
+
+        /**
+         * @brief Keeps only some neurons of the layer, removing the rows of the others.
+         * 
+         * The layer becomes a smaller dense layer: the optimiser state and the CSR form of the
+         * weights are dropped.
+         * 
+         * @param neurons The indices of the neurons to keep, in increasing order.
+         */
+        void keepNeurons(const std::vector<int>& neurons);
+
+
+        /**
+         * @brief Keeps only some inputs of the layer, removing the columns of the others.
+         * 
+         * Called on the layer following one whose neurons were removed with `keepNeurons`.
+         * 
+         * @param inputs The indices of the inputs to keep, in increasing order.
+         */
+        void keepInputs(const std::vector<int>& inputs);
+
+
+        /**
+         * @brief Prunes the weights with the smallest magnitude and stores the rest in the CSR format.
+         * 
+         * The `sparsity x weights.size()` weights closest to 0 are set to 0 (weights that are already
+         * 0 count among them) and `compressWeights` keeps the others. From then on the forward pass
+         * uses the sparse kernel `spmm` and every update keeps the pruned weights at 0, so the
+         * layer can be fine-tuned with its sparsity mask.
+         * 
+         * @param sparsity The fraction of the weights to prune, between 0 and 1.
+         */
+        void prune(double sparsity);
+
+
+        /**
+         * @brief Builds the CSR form of the weights from their current non-zero values.
+         * 
+         * The non-zero pattern becomes the sparsity mask of the layer.
+         */
+        void compressWeights();
+
+
+        /**
+         * @brief Returns true if the weights are stored in the CSR format.
+         */
+        bool isSparse() const { return !sparseWeights.empty(); }
+
+
+        /**
+         * @brief Returns the fraction of the weights that are exactly 0.
+         */
+        double sparsity() const;
+
+
+        /**
+         * @brief Restricts the weights of the layer to binary or ternary values.
+         * 
+         * The real-valued `weights` are kept as latent weights: they are the ones trained and
+         * saved, while the forward pass uses their quantized form packed into bit-planes (see
+         * `packedGemm`). Every update quantizes them again, so the layer can be trained with the
+         * straight-through estimator.
+         * 
+         * @param type The quantization, WeightQuantization::NONE to go back to the full precision weights.
+         */
+        void quantize(WeightQuantization type);
+
+
+        /**
+         * @brief Returns true if the forward pass uses binary or ternary weights.
+         */
+        bool isQuantized() const { return !packedWeights.empty(); }
+
+
+        /**
+         * @brief Lets the layer skip the inputs that are exactly 0.
+         * 
+         * Meant for the first layer of a network reading images, most of their pixels being
+         * background at 0. The layer keeps a transposed copy of its weights so that every non-zero
+         * input of a sample reads one contiguous row of Wᵀ. For each batch the non-zero inputs are
+         * listed in the CSR format and, unless more than `MAX_INPUT_DENSITY` of them are non-zero,
+         * the forward pass and the gradients of the weights only go through them. Otherwise
+         * the batch uses the dense products.
+         * 
+         * @param enable Whether the layer skips its zero inputs.
+         */
+        void exploitInputSparsity(bool enable);
+
+
+        /**
+         * @brief Returns true if the layer skips its zero inputs.
+         */
+        bool exploitsInputSparsity() const { return !transposedWeights.empty(); }
+
+
+        /**
+         * @brief Copies the weights into `transposedWeights` once they changed.
+         * 
+         * Called by every update and import of the layer, it must also be called after writing
+         * to `weights` directly. It does nothing if the layer does not skip its zero inputs.
+         */
+        void transposeWeights();
 
 
         /**
@@ -139,17 +369,17 @@ class Layer {
     private:
 
         /**
-         * @brief Initializes the neurons in the layer.
+         * @brief Initializes the weights and biases of the layer.
          * 
-         * This method creates a vector of Neuron objects of size outputSize where each neuron
-         * is initialized with inputSize. The weights and bias of each neuron are initialized
-         * randomly.
+         * The weight matrix is filled in parallel by `initializeWeights`, from the random stream
+         * of the layer, and the biases are set to 0.
          * 
          * @param inputSize The number of inputs to each neuron.
          * @param outputSize The number of neurons to initialize.
-         * @return A vector containing the initialized neurons.
+         * @param initialization The scheme used to initialize the weights.
+         * @param stream The random stream of the weights.
          */
-        std::vector<Neuron> initializeNeurons(int inputSize, int outputSize);
+        void initializeNeurons(int inputSize, int outputSize, InitializationType initialization, uint64_t stream);
 
 };
 
@@ -190,6 +420,18 @@ class ActivationLayer : public Layer {
         virtual LayerType getType() const override { return LayerType::ActivationLayer; }
 
 
+        /**
+         * @brief An activation layer has no parameters.
+         */
+        bool hasParameters() const override { return false; }
+
+
+        /**
+         * @brief An activation layer takes samples of any width.
+         */
+        int expectedInputWidth() const override { return 0; }
+
+
         /**
          * @brief Applies the activation function to the layer's outputs.
          * 
@@ -200,15 +442,36 @@ class ActivationLayer : public Layer {
 
 
         /**
-         * @brief Performs the backward pass through the activation layer, applying the derivative of the activation function 
-         *        to the error from the next layer.
+         * @brief Applies the activation function to every sample of a batch.
+         * 
+         * @param inputs Pointer to the input batch, one sample per row.
+         * @param inputWidth The number of values of each sample.
+         * @param outputs Pointer to the output batch (same size as the input batch, may be the same buffer).
+         * @param batchSize The number of samples in the batch.
+         */
+        void forwardBatch(const double* inputs, int inputWidth, double* outputs, int batchSize) const override;
+        using Layer::forwardBatch;
+
+
+        /**
+         * @brief Returns the number of values of each output sample: the activation keeps the width of its input.
+         */
+        int outputWidth(int inputWidth) const override { return inputWidth; }
+
+
+        /**
+         * @brief Applies the derivative of the activation function to the error of a batch.
          * 
-         * @param error The error from the next layer that needs to be adjusted based on the activation function.
-         * @param weights Not used in this layer, but passed for compatibility with other layers.
-         * @param biases Not used in this layer, but passed for compatibility with other layers.
-         * @return std::vector<double> The modified error after applying the derivative of the activation function.
+         * @param inputs Not used in this layer.
+         * @param outputs The output batch computed by `forwardBatch`.
+         * @param error The error of the output batch.
+         * @param inputError The error multiplied by the derivative of the activation function.
+         * @param gradients Not used in this layer, it has no parameters.
+         * @param batchSize The number of samples in the batch.
+         * @param computeInputError Not used in this layer.
          */
-        std::vector<double> backwardPass(std::vector<double>& error, std::vector<std::vector<double>>& weights, std::vector<double>& biases) override;
+        void backwardBatch(const std::vector<double>& inputs, const std::vector<double>& outputs, const std::vector<double>& error,
+                           std::vector<double>& inputError, LayerGradients& gradients, int batchSize, bool computeInputError) const override;
 
         /**
          * @brief Destructor for the ActivationLayer class.
@@ -0,0 +1,87 @@
+#ifndef LOW_RANK_HPP
+#define LOW_RANK_HPP
+
+#include <iostream>
+#include <vector>
+
+class Network; // Forward declaration of Network class
+
+
+/**
+ * @brief The thin singular value decomposition A = U diag(S) Vᵀ of a `rows x cols` matrix.
+ *
+ * With k = min(rows, cols), the singular values are sorted from the largest and the columns of
+ * U and V are the matching left and right singular vectors.
+ *
+ * @param rows The number of rows of A.
+ * @param cols The number of columns of A.
+ * @param U The left singular vectors (row-major, rows x k).
+ * @param S The singular values (k), in decreasing order.
+ * @param V The right singular vectors (row-major, cols x k).
+ */
+struct SingularValueDecomposition
+{
+    int rows = 0;
+    int cols = 0;
+    std::vector<double> U;
+    std::vector<double> S;
+    std::vector<double> V;
+
+    int rank() const { return (int)S.size(); }
+};
+
+
+/**
+ * @brief Computes the singular value decomposition of a matrix with the one-sided Jacobi method.
+ *
+ * The columns of the matrix (of its transpose if it has more columns than rows) are rotated in
+ * pairs until they are all orthogonal (Hestenes). The norms of the columns are then the singular
+ * values and the accumulated rotations the right singular vectors. Each sweep over the pairs
+ * costs O(k² x max(rows, cols)) and a few sweeps reach double precision.
+ *
+ * @param A Pointer to the matrix (row-major, rows x cols).
+ * @param rows The number of rows.
+ * @param cols The number of columns.
+ * @return SingularValueDecomposition The decomposition of A.
+ */
+SingularValueDecomposition jacobiSVD(const double* A, int rows, int cols);
+
+
+/**
+ * @brief Writes the best approximation of rank `rank` of a matrix: U_r diag(S_r) V_rᵀ.
+ *
+ * @param svd The decomposition of the matrix.
+ * @param rank The number of singular values kept (at most svd.rank()).
+ * @param dense Pointer to the approximation (row-major, svd.rows x svd.cols), overwritten.
+ */
+void lowRankApproximation(const SingularValueDecomposition& svd, int rank, double* dense);
+
+
+/**
+ * @brief Returns the number of multiply-adds of a standard layer, factorised or not.
+ *
+ * @param inputSize The number of inputs of the layer.
+ * @param outputSize The number of neurons of the layer.
+ * @param rank The rank of the factorisation, 0 for the unfactorised layer.
+ * @return size_t inputSize x outputSize, or rank x (inputSize + outputSize).
+ */
+size_t layerMultiplyAdds(int inputSize, int outputSize, int rank = 0);
+
+
+/**
+ * @brief Replaces a standard layer by two thinner layers of rank `rank`.
+ *
+ * The `outputSize x inputSize` weights W ≈ U_r diag(S_r) V_rᵀ become a first layer of `rank`
+ * neurons with the weights diag(√S_r) V_rᵀ and no biases, followed, without activation, by a
+ * layer of `outputSize` neurons with the weights U_r diag(√S_r) and the original biases.
+ *
+ * @param net The network.
+ * @param index The position of the standard layer in `net.Layers`.
+ * @param svd The decomposition of the weights of the layer.
+ * @param rank The rank of the factorisation (at most svd.rank()).
+ * @return bool Returns false, without changing anything, if the layer does not match the decomposition.
+ */
+bool factorizeLayer(Network& net, size_t index, const SingularValueDecomposition& svd, int rank);
+
+
+#endif // LOW_RANK_HPP
@@ -2,11 +2,50 @@
 #define NETWORK_HPP
 
 #include <vector>
+#include <cstdint>
+#include <algorithm>
 
 #include "layer.hpp"
+#include "convolution.hpp"
 #include "weightsBiasExtractor.hpp"
+#include "ptExtractor.hpp"
 #include "activation.hpp"
 #include "lossFunctions.hpp"
+#include "optimizer.hpp"
+
+
+/**
+ * @brief Buffers used to run a batch of samples through the network.
+ * 
+ * All the matrices are stored row-major with one sample per row. The workspace keeps the
+ * activations of every layer between the forward and the backward pass, so the layers
+ * themselves stay untouched and several workspaces can be used with the same network.
+ * The buffers are reused from batch to batch, so after the first batch no allocation occurs.
+ * 
+ * @param batchSize The number of samples in the batch.
+ * @param inputs The input batch (batchSize x input size), filled by the caller.
+ * @param activations The output of each layer (activations[i] is the output of Layers[i]).
+ * @param lossPrime The derivative of the loss for each output (batchSize x output size), filled by the caller.
+ * @param labels The index of the true class of every sample, filled by the caller.
+ * @param losses The loss of every sample, filled by the caller.
+ * @param error The error flowing backwards through the layers.
+ * @param inputError The error propagated to the previous layer.
+ * @param gradients The gradients of each layer, summed over the batch (empty for activation layers).
+ * @param shards The workspaces of the parts of the batch when it is split over several threads.
+ */
+struct BatchWorkspace
+{
+    int batchSize = 0;
+    std::vector<double> inputs;
+    std::vector<std::vector<double>> activations;
+    std::vector<double> lossPrime;
+    std::vector<int> labels;
+    std::vector<double> losses;
+    std::vector<double> error;
+    std::vector<double> inputError;
+    std::vector<LayerGradients> gradients;
+    std::vector<BatchWorkspace> shards;
+};
 
 
 /**
@@ -21,21 +60,20 @@ class Network {
     public:
 
         std::vector<std::shared_ptr<Layer>> Layers;  ///< A vector containing the layers in the network.
-        double lossValue;                            ///< The loss value for the network.
-        std::vector<double> lossPrimeValue;          ///< The derivative of the loss function.
         int standardLayerCount = 0;                  ///< The number of standard layers in the network.
         int activationLayerCount = 0;                ///< The number of activation layers in the network.
+        int convolutionLayerCount = 0;               ///< The number of convolution layers in the network.
+        int poolingLayerCount = 0;                   ///< The number of pooling layers in the network.
         std::vector<double> inputs;                  ///< The input to the network.
         std::vector<double> output;                  ///< The output of the network.
         LossFunction lossFunction;                   ///< The loss function used by the network.
-        LossFunctionPrime lossFunctionPrime;         ///< The derivative of the loss function used by the network.
+        OptimizerSettings optimizer;                 ///< The optimiser used to update the weights and biases (SGD by default).
 
 
         /**
          * @brief Constructs a new Network instance.
          * 
-         * This constructor initializes the loss and lossPrime to zero and 
-         * sets up an empty vector of layers. It prepares the network for 
+         * This constructor sets up an empty vector of layers. It prepares the network for 
          * subsequent layer addition and training.
          */
         Network();
@@ -63,6 +101,73 @@ class Network {
         void addLayer(const ActivationLayer& activationLayer);
 
 
+        /**
+         * @brief Adds a 2D convolution layer to the network.
+         * 
+         * @param convolutionLayer The Conv2DLayer object to be added to the network.
+         */
+        void addLayer(const Conv2DLayer& convolutionLayer);
+
+
+        /**
+         * @brief Adds a 2D max pooling layer to the network.
+         * 
+         * @param poolingLayer The MaxPool2DLayer object to be added to the network.
+         */
+        void addLayer(const MaxPool2DLayer& poolingLayer);
+
+
+        /**
+         * @brief Returns the name of the parameters of a layer in the checkpoints.
+         * 
+         * The layers with parameters are numbered by type in the order of the network, as in a
+         * PyTorch model: "conv1", "conv2", ... for the convolution layers and "fc1", "fc2", ...
+         * for the standard layers. Their tensors are "<name>.weight" and "<name>.bias".
+         * 
+         * @param index The position of the layer in `Layers`.
+         * @return std::string The name, empty for a layer without parameters.
+         */
+        std::string parameterName(size_t index) const;
+
+
+        /**
+         * @brief Returns the hidden layers of the network, whose neurons can be removed.
+         * 
+         * A hidden layer is a standard layer whose outputs go, through activation layers only,
+         * to another standard layer.
+         * 
+         * @return std::vector<size_t> The positions of the hidden layers in `Layers`.
+         */
+        std::vector<size_t> hiddenLayers() const;
+
+
+        /**
+         * @brief Keeps only some neurons of a hidden layer and shrinks the next standard layer to match.
+         * 
+         * The rows of the removed neurons are deleted from the hidden layer and the matching
+         * columns from the next standard layer, so the network stays a dense network, only smaller.
+         * 
+         * @param index The position of the hidden layer in `Layers` (see `hiddenLayers`).
+         * @param neurons The indices of the neurons to keep, in increasing order.
+         * @return bool Returns false, without changing anything, if the layer is not a hidden layer.
+         */
+        bool keepNeurons(size_t index, const std::vector<int>& neurons);
+
+
+        /**
+         * @brief Replaces a standard layer by two standard layers applied one after the other.
+         * 
+         * The first layer takes the inputs of the replaced layer and the second one gives its
+         * outputs, so the rest of the network is unchanged (e.g. a low-rank factorisation).
+         * 
+         * @param index The position of the standard layer in `Layers`.
+         * @param first The layer reading the inputs of the replaced layer.
+         * @param second The layer producing the outputs of the replaced layer.
+         * @return bool Returns false, without changing anything, if the shapes do not match.
+         */
+        bool splitLayer(size_t index, const Layer& first, const Layer& second);
+
+
         /**
          * @brief Verifies the correct placement of the Softmax activation layer.
          * 
@@ -90,42 +195,68 @@ class Network {
 
 
         /**
-         * @brief Sets the loss function for the network and its corresponding derivative.
+         * @brief Sets the loss function for the network.
          * 
-         * This function allows you to assign a specific loss function to the neural network.
-         * In addition to setting the loss function, it also automatically selects and assigns 
-         * the derivative (gradient) of the loss function, which will be used during backpropagation 
-         * to compute gradients for weight updates.
-         * 
-         * - The loss function (`lossFunction`) is set to the one provided as an argument.
-         * - The corresponding derivative (`lossFunctionPrime`) is selected using a helper 
-         *   function `select_LossFunction_prime()`, which maps the chosen loss function 
-         *   to its gradient calculation function.
-         * 
-         * This design ensures that both the loss function and its gradient are consistently 
-         * paired, reducing the chance of errors during training.
+         * The loss and its derivative are computed for a whole batch by `evaluateBatch`, which
+         * selects the matching sparse loss functions (see `sparse_binary_cross_entropy_loss`).
          * 
          * @param lossFunction The loss function to be used by the network (e.g., MSE, CrossEntropy).
-         * 
-         * @note The `lossFunctionPrime` is essential for backpropagation, as it calculates the 
-         * gradient of the loss with respect to the output of the network.
          */
         void addLossFunction(LossFunction lossFunction);
 
 
+        /**
+         * @brief Sets the optimiser used by `updateWeightsBiases` to train the network.
+         * 
+         * The hyper-parameters keep their default values (see `OptimizerSettings`) and the state
+         * of the previous optimiser is discarded on the next update.
+         * 
+         * @param optimizerType The optimiser to use (e.g., SGD, Adam).
+         */
+        void addOptimizer(OptimizerType optimizerType);
+
+
         /**
          * @brief Imports weights and biases into the network.
          * 
          * This function populates the weights and biases of the layers in the 
          * network from the provided vector of BiasesWeights. It ensures that 
          * the number of layers matches the number of weight and bias sets 
-         * provided.
+         * provided, and gives every layer the set named after it (see `parameterName`).
          * 
          * @param weightsBiases A vector containing the weights and biases for each layer.
          */
         void importWeightsBiases(std::vector<BiasesWeights> weignthsBiases);
 
 
+        /**
+         * @brief Imports the weights and biases of a PyTorch state_dict into the network.
+         *
+         * The tensors `fc<k>.weight` (outputSize x inputSize) and `fc<k>.bias` of the k-th
+         * standard layer, and `conv<k>.weight` (filters x channels x kernel x kernel) and
+         * `conv<k>.bias` of the k-th convolution layer, are converted straight into the
+         * parameters of the layer, without any intermediate copy. Nothing is imported unless
+         * every layer has tensors of its shape.
+         *
+         * @param stateDict The state_dict, read with `PtStateDict::load`.
+         * @param error Receives the reason of a failure instead of the standard output (optional).
+         * @return true if the parameters were imported, false otherwise (the reason is printed or stored in `error`).
+         */
+        bool importStateDict(const PtStateDict& stateDict, std::string* error = nullptr);
+
+
+        /**
+         * @brief Imports the weights and biases of a checkpoint file into the network.
+         *
+         * A `.pt`/`.pth` file is read natively with `PtStateDict`, any other file is parsed as
+         * the JSON written by VanillaNet-cpp.
+         *
+         * @param path The path of the checkpoint.
+         * @return true if the parameters were imported, false otherwise.
+         */
+        bool importCheckpoint(const std::string& path);
+
+
         /**
          * @brief Saves the current weights and biases of the network.
          * 
@@ -139,118 +270,125 @@ class Network {
 
 
         /**
-         * @brief Computes the loss value based on the chosen loss function.
-         * 
-         * This function calculates the loss value for the given true labels (`yTrue`) and 
-         * predicted values (`yPredicted`) using the specified loss function. 
-         * 
-         * - The function supports multiple loss functions such as:
-         *     - **SQUARED_ERROR**: Computes the sum of squared errors.
-         *     - **MEAN_SQUARED_ERROR**: Computes the mean of squared errors.
-         *     - **CROSS_ENTROPY**: Computes the binary cross-entropy loss.
-         * 
-         * After computing the loss, it also calculates and stores the derivative of the loss 
-         * function (by calling `lossPrime`) for use during backpropagation.
+         * @brief Performs forward propagation through the network.
          * 
-         * @param yTrue A vector containing the true labels.
-         * @param yPredicted A vector containing the predicted output values from the network.
-         * @return The computed loss value as a double.
+         * This function takes an input vector, processes it through each layer 
+         * in the network, and returns the final output vector. It updates the 
+         * inputs and outputs of the network.
          * 
-         * @note The function stores the computed loss value (`this->lossValue`) and also 
-         * prepares the loss gradient (`this->lossPrimeValue`) for use in backpropagation.
+         * @param inputs A vector containing the input values for the network.
+         * @return A vector containing the output values after forward propagation.
          */
-        double loss(const std::vector<double>& yTrue, const std::vector<double>& yPredicted);
+        std::vector<double> forwardPropagation(const std::vector<double>& inputs);
 
 
         /**
-         * @brief Computes the derivative (gradient) of the loss function for backpropagation.
-         * 
-         * This function calculates the gradient of the loss function with respect to 
-         * the predicted values (`yPredicted`), which is essential for updating the 
-         * network's weights during backpropagation.
+         * @brief Performs forward propagation of a whole batch through the network.
          * 
-         * - The function supports computing the gradient for multiple loss functions such as:
-         *     - **SQUARED_ERROR_PRIME**: Derivative of the sum of squared errors.
-         *     - **MEAN_SQUARED_ERROR_PRIME**: Derivative of the mean squared errors.
-         *     - **CROSS_ENTROPY_PRIME**: Derivative of the binary cross-entropy loss.
+         * The batch is read from `workspace.inputs` and `workspace.batchSize`. The output of
+         * every layer is stored in `workspace.activations` for the backward pass.
          * 
-         * @param yTrue A vector containing the true labels.
-         * @param yPredicted A vector containing the predicted output values from the network.
-         * @return A vector containing the gradient of the loss function with respect to each output.
-         * 
-         * @note The computed gradient is stored in `this->lossPrimeValue`, which will be used 
-         * during backpropagation to update the weights in the network.
+         * @param workspace The buffers of the batch.
+         * @return The output of the network for the batch (batchSize x output size).
+         */
+        const std::vector<double>& forwardPropagationBatch(BatchWorkspace& workspace) const;
+
+
+        /**
+         * @brief Performs forward propagation of a batch held in buffers owned by the caller.
+         * 
+         * The first layer reads `inputs` and the last one writes `outputs` directly, so the batch
+         * is never copied. The intermediate layers use `workspace.activations`, which keeps its
+         * capacity from one call to the next. Only the first `layers` layers are evaluated, e.g.
+         * all but a final activation layer to get the logits of a classifier.
+         * 
+         * @param inputs Pointer to the input batch (batchSize x `inputSize()`).
+         * @param batchSize The number of samples in the batch.
+         * @param outputs Pointer to the output batch (batchSize x `outputSize(layers)`).
+         * @param workspace The buffers of the intermediate layers.
+         * @param layers The number of layers to evaluate (all of them by default).
          */
-        std::vector<double> lossPrime(const std::vector<double>& yTrue, const std::vector<double>& yPredicted);
+        void forwardPropagationBatch(const double* inputs, int batchSize, double* outputs, BatchWorkspace& workspace, size_t layers = SIZE_MAX) const;
 
 
         /**
-         * @brief Sets the loss and its derivative for the network.
+         * @brief Returns the number of inputs of the network, the input width expected by its first
+         *        standard, convolution or pooling layer.
          * 
-         * This function updates the loss and lossPrime attributes of the network, 
-         * which are used during training to evaluate performance and guide updates.
+         * @return int The number of inputs (0 if the network only has activation layers).
+         */
+        int inputSize() const;
+
+
+        /**
+         * @brief Returns the number of outputs of the first `layers` layers of the network.
          * 
-         * @param loss The current loss value.
-         * @param lossPrime The derivative of the loss function.
+         * @param layers The number of layers (all of them by default).
+         * @return int The number of outputs of each sample.
          */
-        void setLoss(double loss, const std::vector<double>& lossPrime);
+        int outputSize(size_t layers = SIZE_MAX) const;
 
 
         /**
-         * @brief Performs forward propagation through the network.
+         * @brief Performs backward propagation of a whole batch through the network.
          * 
-         * This function takes an input vector, processes it through each layer 
-         * in the network, and returns the final output vector. It updates the 
-         * inputs and outputs of the network.
+         * Starts from the derivative of the loss in `workspace.lossPrime` and stores the
+         * gradients of each layer, summed over the batch, in `workspace.gradients`. A final
+         * Softmax layer is skipped because its derivative is already part of the cross-entropy
+         * derivative.
          * 
-         * @param inputs A vector containing the input values for the network.
-         * @return A vector containing the output values after forward propagation.
+         * @param workspace The buffers of the batch, after `forwardPropagationBatch`.
          */
-        std::vector<double> forwardPropagation(const std::vector<double>& inputs);
+        void backwardPropagationBatch(BatchWorkspace& workspace) const;
 
 
         /**
-         * @brief Performs backward propagation through the network.
+         * @brief Updates the weights and biases of the network with the gradients of a batch.
          * 
-         * This function calculates the gradients for each layer based on the 
-         * output error and returns them in a vector of BiasesWeights. This is 
-         * used to adjust the weights and biases during training.
+         * The gradients in the workspace are summed over the batch, so they are divided by the
+         * batch size to apply the average gradient. Each layer is updated in place by the
+         * optimiser selected with `addOptimizer`. The pruned weights of a sparse layer stay at 0
+         * (see `prune`).
          * 
-         * @param outputError A vector containing the error at the output layer.
-         * @return A vector of BiasesWeights containing the gradients for each layer.
+         * @param workspace The buffers of the batch, after `backwardPropagationBatch`.
+         * @param learningRate The rate at which to update the weights and biases.
+         * @param step The step of the update, counted from 1, for concurrent updates (see
+         *             `Layer::applyOptimizer`). 0 (default) takes the step after the previous update.
+         */
+        void updateWeightsBiases(const BatchWorkspace& workspace, double learningRate, long step = 0);
+
+
+        /**
+         * @brief Allocates the state of the optimiser of every layer with parameters.
          * 
-         * @note: https://mattmazur.com/2015/03/17/a-step-by-step-backpropagation-example/
+         * Must be called before several threads update the network at the same time (Hogwild),
+         * so that no update reallocates the buffers the others are writing to.
          */
-        std::vector<BiasesWeights> backwardPropagation(const std::vector<double>& outputError);
+        void prepareOptimizer();
 
 
         /**
-         * @brief Updates the weights and biases of the network.
+         * @brief Prunes the weights with the smallest magnitude of every layer with parameters.
          * 
-         * This function applies the calculated gradients to the weights and biases 
-         * of each layer using the specified learning rate. It utilizes the 
-         * average gradients calculated from the accumulated gradients over 
-         * multiple batches.
+         * Each layer keeps its `1 - sparsity` largest weights, stored in the CSR format and
+         * multiplied by the sparse kernels from then on (see `Layer::prune`). A training that
+         * follows fine-tunes the remaining weights with the sparsity mask enforced.
          * 
-         * @param accumulatedGrad A vector of accumulated gradients from multiple batches.
-         * @param learningRate The rate at which to update the weights and biases.
+         * @param sparsity The fraction of the weights of every layer to set to 0, between 0 and 1.
          */
-        void updateWeightsBiases(const std::vector<std::vector<BiasesWeights>>& accumulatedGrad, double learningRate);
-    
+        void prune(double sparsity);
 
-    private:
 
         /**
-         * @brief Calculates the average gradients from the accumulated gradients.
+         * @brief Restricts the weights of every standard layer to binary or ternary values.
          * 
-         * This function takes a vector of accumulated gradients and computes 
-         * the average for each layer's weights and biases. This is used to 
-         * ensure stable updates during training.
+         * The layers keep their real-valued weights and run the forward pass with the quantized
+         * ones packed into bit-planes (see `Layer::quantize`). A training that follows updates the
+         * real-valued weights with the straight-through estimator.
          * 
-         * @param accumulatedGrad A vector of vectors containing accumulated gradients.
-         * @return A vector of BiasesWeights containing the average gradients.
+         * @param type The quantization, WeightQuantization::NONE to go back to the full precision weights.
          */
-        std::vector<BiasesWeights> calculateAverageGradients(const std::vector<std::vector<BiasesWeights>>& accumulatedGrad);
+        void quantize(WeightQuantization type);
 };
 
 
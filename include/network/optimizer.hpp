@@ -0,0 +1,138 @@
+#ifndef OPTIMIZER_HPP
+#define OPTIMIZER_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cmath>
+
+
+/**
+ * @brief Enum class representing the optimisers used to update the weights and biases.
+ *
+ * - **SGD**: Plain stochastic gradient descent.
+ *
+ * - **MOMENTUM**: Gradient descent with (heavy-ball) momentum.
+ *
+ * - **NESTEROV**: Gradient descent with Nesterov momentum.
+ *
+ * - **ADAM**: Adaptive moment estimation, with bias correction.
+ *
+ * - **ADAMW**: Adam with weight decay decoupled from the gradient.
+ *
+ * - **INVALID**: Indicates an unsupported or unrecognized optimiser.
+ */
+enum class OptimizerType {
+    SGD,        ///< Stochastic gradient descent.
+    MOMENTUM,   ///< Gradient descent with momentum.
+    NESTEROV,   ///< Gradient descent with Nesterov momentum.
+    ADAM,       ///< Adaptive moment estimation.
+    ADAMW,      ///< Adam with decoupled weight decay.
+    INVALID     ///< Indicates an unsupported optimiser.
+};
+
+
+/**
+ * @brief Structure holding the optimiser used by a network and its hyper-parameters.
+ *
+ * @param type The optimiser.
+ * @param momentum The momentum factor (MOMENTUM and NESTEROV).
+ * @param beta1 The decay rate of the first moment estimate (ADAM and ADAMW).
+ * @param beta2 The decay rate of the second moment estimate (ADAM and ADAMW).
+ * @param epsilon The term added to the denominator for numerical stability (ADAM and ADAMW).
+ * @param weightDecay The decoupled weight decay factor, applied to the weights only (ADAMW).
+ */
+struct OptimizerSettings
+{
+    OptimizerType type = OptimizerType::SGD;
+    double momentum = 0.9;
+    double beta1 = 0.9;
+    double beta2 = 0.999;
+    double epsilon = 1e-8;
+    double weightDecay = 0.01;
+};
+
+
+/**
+ * @brief Structure holding the state of the optimiser for a layer.
+ *
+ * The buffers use the same contiguous layout as the parameters of the layer and are only
+ * allocated by the optimisers that need them: `firstMoment` holds the velocity of MOMENTUM and
+ * NESTEROV or the first moment of ADAM(W), `secondMoment` the second moment of ADAM(W).
+ *
+ * @param weightsFirstMoment The first state buffer of the weights.
+ * @param weightsSecondMoment The second state buffer of the weights.
+ * @param biasesFirstMoment The first state buffer of the biases.
+ * @param biasesSecondMoment The second state buffer of the biases.
+ * @param step The number of updates applied so far (used for the bias correction of ADAM).
+ */
+struct OptimizerState
+{
+    std::vector<double> weightsFirstMoment;
+    std::vector<double> weightsSecondMoment;
+    std::vector<double> biasesFirstMoment;
+    std::vector<double> biasesSecondMoment;
+    long step = 0;
+};
+
+
+/**
+ * @brief Applies one optimiser step to a contiguous block of parameters.
+ *
+ * The update of each optimiser is a single fused pass over the parameters, the gradients and
+ * the state buffers, without branches in the loop, so the compiler can vectorise it:
+ *
+ * - SGD:       p -= lr * g
+ * - MOMENTUM:  v = μ * v + g;  p -= lr * v
+ * - NESTEROV:  v = μ * v + g;  p -= lr * (g + μ * v)
+ * - ADAM:      m = β1 * m + (1 - β1) * g;  v = β2 * v + (1 - β2) * g²;  p -= lr * m̂ / (√v̂ + ε)
+ * - ADAMW:     p -= lr * λ * p, then the ADAM step
+ *
+ * where g is the gradient multiplied by `gradientScale` (e.g. 1 / batchSize for gradients summed
+ * over a batch) and m̂, v̂ are the bias-corrected moments.
+ *
+ * @param settings The optimiser and its hyper-parameters.
+ * @param learningRate The step size.
+ * @param gradientScale The factor applied to the gradients before the update.
+ * @param step The index of the update, starting from 1 (used for the bias correction of ADAM).
+ * @param decay Whether the decoupled weight decay of ADAMW applies to these parameters.
+ * @param gradients Pointer to the gradients.
+ * @param parameters Pointer to the parameters, updated in place.
+ * @param firstMoment Pointer to the first state buffer (unused by SGD).
+ * @param secondMoment Pointer to the second state buffer (used by ADAM and ADAMW only).
+ * @param size The number of parameters.
+ */
+void optimizerStep(const OptimizerSettings& settings, double learningRate, double gradientScale, long step, bool decay,
+                   const double* gradients, double* parameters, double* firstMoment, double* secondMoment, size_t size);
+
+
+/**
+ * @brief Returns the number of state buffers an optimiser needs per parameter.
+ *
+ * @param type The optimiser.
+ * @return 0 for SGD, 1 for MOMENTUM and NESTEROV, 2 for ADAM and ADAMW.
+ */
+int optimizerStateBuffers(OptimizerType type);
+
+
+/**
+ * @brief Converts an OptimizerType to its string representation.
+ *
+ * @param type The optimiser.
+ * @return std::string The name of the optimiser, or "None" if it is not supported.
+ */
+std::string OptimizerTypeToString(OptimizerType type);
+
+
+/**
+ * @brief Converts the name of an optimiser, as given on the command line, to an OptimizerType.
+ *
+ * The comparison is case-insensitive and accepts "sgd", "momentum", "nesterov", "adam" and "adamw".
+ *
+ * @param name The name of the optimiser.
+ * @return OptimizerType The optimiser, or OptimizerType::INVALID if the name is not recognised.
+ */
+OptimizerType stringToOptimizerType(const std::string& name);
+
+
+#endif // OPTIMIZER_HPP
@@ -0,0 +1,72 @@
+#ifndef PRUNING_HPP
+#define PRUNING_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+class Network; // Forward declaration of Network class
+
+
+/**
+ * @brief Enum representing how the neurons of a hidden layer are ranked before removing some.
+ */
+enum class NeuronRanking {
+    NORM,           ///< L2 norm of the row of incoming weights of the neuron.
+    ACTIVATION,     ///< Mean absolute activation of the neuron over a calibration set.
+    INVALID         ///< Indicates an unsupported ranking.
+};
+
+
+/**
+ * @brief Scores the neurons of a hidden layer, the least useful neurons getting the lowest scores.
+ *
+ * With NeuronRanking::ACTIVATION the calibration samples are run through the network up to the
+ * hidden layer and the activation layers following it, and each neuron is scored by the mean
+ * absolute value of its output.
+ *
+ * @param net The network.
+ * @param layer The position of the hidden layer in `net.Layers`.
+ * @param ranking The score of the neurons.
+ * @param calibration The calibration samples, one per row (samples x net.inputSize()), only used by NeuronRanking::ACTIVATION.
+ * @param samples The number of calibration samples.
+ * @return std::vector<double> One score per neuron of the layer.
+ */
+std::vector<double> neuronScores(const Network& net, size_t layer, NeuronRanking ranking, const std::vector<double>& calibration, int samples);
+
+
+/**
+ * @brief Shrinks every hidden layer of a network to a number of neurons, keeping the best ranked ones.
+ *
+ * The hidden layers are shrunk one after the other, from the first one, so the scores of a
+ * layer are computed after the previous layers were shrunk (see `Network::keepNeurons`).
+ *
+ * @param net The network, shrunk in place.
+ * @param sizes The number of neurons to keep in every hidden layer, in the order of `Network::hiddenLayers`.
+ * @param ranking The score of the neurons.
+ * @param calibration The calibration samples, one per row, only used by NeuronRanking::ACTIVATION.
+ * @param samples The number of calibration samples.
+ * @return bool Returns false if the sizes do not match the hidden layers of the network.
+ */
+bool shrinkHiddenLayers(Network& net, const std::vector<int>& sizes, NeuronRanking ranking, const std::vector<double>& calibration, int samples);
+
+
+/**
+ * @brief Converts a NeuronRanking enum value to its corresponding string representation.
+ *
+ * @param ranking The NeuronRanking enum value to convert.
+ * @return std::string The name of the ranking.
+ */
+std::string NeuronRankingToString(NeuronRanking ranking);
+
+
+/**
+ * @brief Converts a string to the corresponding NeuronRanking enum value (case insensitive).
+ *
+ * @param name The name of the ranking: "Norm" or "Activation".
+ * @return NeuronRanking The ranking, or NeuronRanking::INVALID if the name is not recognised.
+ */
+NeuronRanking stringToNeuronRanking(const std::string& name);
+
+
+#endif // PRUNING_HPP
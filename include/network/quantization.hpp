@@ -0,0 +1,117 @@
+#ifndef QUANTIZATION_HPP
+#define QUANTIZATION_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+
+/**
+ * @brief Enum representing the values the weights of a layer are restricted to.
+ *
+ * - **NONE**: The weights are plain doubles.
+ *
+ * - **BINARY**: Every weight of neuron i is +αᵢ or -αᵢ, its sign, with αᵢ the mean magnitude of
+ *   the weights of the neuron (BinaryConnect / XNOR-Net scaling).
+ *
+ * - **TERNARY**: Every weight of neuron i is +αᵢ, 0 or -αᵢ: the weights smaller in magnitude than
+ *   Δᵢ = 0.7 x mean |w| are 0 and αᵢ is the mean magnitude of the others (ternary weight networks).
+ *
+ * - **INVALID**: Indicates an unsupported quantization.
+ */
+enum class WeightQuantization {
+    NONE,           ///< Full precision weights.
+    BINARY,         ///< Weights in {-α, +α}.
+    TERNARY,        ///< Weights in {-α, 0, +α}.
+    INVALID         ///< Indicates an unsupported quantization.
+};
+
+
+/**
+ * @brief The weights of a binary or ternary layer packed into bit-planes.
+ *
+ * Every row of the weight matrix is stored as one bit per weight in 64-bit words: bit c of
+ * `positive` is set when weight c is +α and, for a ternary layer, bit c of `negative` is set
+ * when it is -α (for a binary layer every weight that is not +α is -α, `negative` stays empty).
+ * A `rows x cols` matrix takes 1 or 2 bits per weight plus one scale per row, instead of 64 bits
+ * per weight.
+ *
+ * @param type The quantization of the weights (BINARY or TERNARY).
+ * @param rows The number of rows of the matrix (neurons).
+ * @param cols The number of columns of the matrix (inputs).
+ * @param words The number of 64-bit words of every row.
+ * @param positive The bit-plane of the +α weights (rows x words).
+ * @param negative The bit-plane of the -α weights (rows x words), ternary layers only.
+ * @param scales The scale α of every row.
+ */
+struct PackedWeights
+{
+    WeightQuantization type = WeightQuantization::NONE;
+    int rows = 0;
+    int cols = 0;
+    int words = 0;
+    std::vector<uint64_t> positive;
+    std::vector<uint64_t> negative;
+    std::vector<double> scales;
+
+    bool empty() const { return type == WeightQuantization::NONE; }
+    size_t storageBytes() const { return (positive.size() + negative.size()) * sizeof(uint64_t) + scales.size() * sizeof(double); }
+};
+
+
+/**
+ * @brief Quantizes the real-valued (latent) weights of a layer and packs them into bit-planes.
+ *
+ * The buffers are resized only when the shape changes, so the weights can be quantized again
+ * after every update without allocating.
+ *
+ * @param latent Pointer to the real-valued weights (row-major, rows x cols).
+ * @param rows The number of rows.
+ * @param cols The number of columns.
+ * @param type The quantization, BINARY or TERNARY.
+ * @param packed The packed weights, overwritten.
+ * @param dense The quantized weights as a dense matrix (rows x cols), overwritten and resized if
+ *              needed. They are used to propagate the error during the training.
+ */
+void quantizeWeights(const double* latent, int rows, int cols, WeightQuantization type, PackedWeights& packed, std::vector<double>& dense);
+
+
+/**
+ * @brief Computes Y = X x Wᵀ with packed binary or ternary weights, without any multiplication.
+ *
+ * The inputs of every sample are split in groups of 4 and, for each group, the sums of the 16
+ * subsets of its inputs are tabulated (one addition each). The product of a row of weights with
+ * the sample then takes one table lookup and one addition per group and bit-plane, read from the
+ * bits of the row: 4 weights per addition instead of one multiply-add per weight. The sum of the
+ * +α inputs minus the sum of the -α inputs is finally scaled by α (binary rows use
+ * Σ₋ = Σ - Σ₊). Batches are processed in blocks of samples whose tables are interleaved, so every
+ * lookup adds a whole block at once with contiguous accesses.
+ *
+ * @param W The packed weights (outputs x inputs).
+ * @param X Pointer to the input batch (batchSize x W.cols).
+ * @param batchSize The number of samples.
+ * @param Y Pointer to the output batch (batchSize x W.rows), overwritten.
+ */
+void packedGemm(const PackedWeights& W, const double* X, int batchSize, double* Y);
+
+
+/**
+ * @brief Converts a WeightQuantization enum value to its corresponding string representation.
+ *
+ * @param type The WeightQuantization enum value to convert.
+ * @return std::string The name of the quantization.
+ */
+std::string WeightQuantizationToString(WeightQuantization type);
+
+
+/**
+ * @brief Converts a string to the corresponding WeightQuantization enum value (case insensitive).
+ *
+ * @param name The name of the quantization: "Binary" or "Ternary".
+ * @return WeightQuantization The quantization, or WeightQuantization::INVALID if the name is not recognised.
+ */
+WeightQuantization stringToWeightQuantization(const std::string& name);
+
+
+#endif // QUANTIZATION_HPP
@@ -0,0 +1,131 @@
+#ifndef SPARSE_HPP
+#define SPARSE_HPP
+
+#include <iostream>
+#include <vector>
+
+
+/**
+ * @brief A matrix stored in the compressed sparse row (CSR) format.
+ *
+ * Only the non-zero values are kept, row after row: the values of row r are
+ * `values[rowStart[r]]` to `values[rowStart[r + 1] - 1]` and `columns` holds the column of
+ * each of them, in increasing order. A `rows x cols` matrix with `nnz` non-zero values takes
+ * `nnz x (8 + 4) + (rows + 1) x 4` bytes instead of `rows x cols x 8`.
+ *
+ * @param rows The number of rows of the matrix.
+ * @param cols The number of columns of the matrix.
+ * @param rowStart The index of the first value of every row, followed by the number of values (rows + 1).
+ * @param columns The column of every value.
+ * @param values The non-zero values.
+ */
+struct SparseMatrix
+{
+    int rows = 0;
+    int cols = 0;
+    std::vector<int> rowStart;
+    std::vector<int> columns;
+    std::vector<double> values;
+
+    bool empty() const { return rowStart.empty(); }
+    size_t nonZeros() const { return values.size(); }
+    size_t storageBytes() const { return values.size() * (sizeof(double) + sizeof(int)) + rowStart.size() * sizeof(int); }
+};
+
+
+/**
+ * @brief Builds the CSR form of a row-major dense matrix, keeping its non-zero values.
+ *
+ * @param dense Pointer to the dense matrix (rows x cols).
+ * @param rows The number of rows.
+ * @param cols The number of columns.
+ * @return SparseMatrix The matrix in the CSR format.
+ */
+SparseMatrix denseToSparse(const double* dense, int rows, int cols);
+
+
+/**
+ * @brief Builds the CSR form of a row-major dense matrix into an existing matrix.
+ *
+ * Same as the other overload, but the buffers of `sparse` are reused: once they are large
+ * enough, compressing another matrix (e.g. the next batch of inputs) does not allocate.
+ *
+ * @param dense Pointer to the dense matrix (rows x cols).
+ * @param rows The number of rows.
+ * @param cols The number of columns.
+ * @param sparse The matrix in the CSR format, overwritten.
+ */
+void denseToSparse(const double* dense, int rows, int cols, SparseMatrix& sparse);
+
+
+/**
+ * @brief Restricts a dense matrix to the non-zero pattern of its CSR form.
+ *
+ * The values of `dense` outside the pattern are set to 0 and the values inside it are copied
+ * into `sparse.values`, so both forms hold the same matrix again after a dense update.
+ *
+ * @param sparse The CSR form, whose pattern is kept and whose values are refreshed.
+ * @param dense Pointer to the dense matrix (sparse.rows x sparse.cols), updated in place.
+ */
+void applySparsityPattern(SparseMatrix& sparse, double* dense);
+
+
+/**
+ * @brief Computes the sparse matrix-vector product y = A x.
+ *
+ * @param A The matrix in the CSR format.
+ * @param x Pointer to A.cols values.
+ * @param y Pointer to A.rows values, overwritten.
+ */
+void spmv(const SparseMatrix& A, const double* x, double* y);
+
+
+/**
+ * @brief Computes the sparse-dense matrix product Y = X x Aᵀ, the forward pass of a sparse layer.
+ *
+ * X holds `batchSize` samples of A.cols values, one per row, and Y receives `batchSize` rows of
+ * A.rows values. The samples are processed in blocks: each block is transposed so that every
+ * non-zero value of A is loaded once per block and multiplies the whole block with contiguous
+ * (vectorisable) accesses. A single sample goes through `spmv`.
+ *
+ * @param A The matrix in the CSR format (outputs x inputs).
+ * @param X Pointer to the input batch (batchSize x A.cols).
+ * @param batchSize The number of samples.
+ * @param Y Pointer to the output batch (batchSize x A.rows), overwritten.
+ */
+void spmm(const SparseMatrix& A, const double* X, int batchSize, double* Y);
+
+
+/**
+ * @brief Computes the product Y = X x B of a sparse matrix by a dense one, gathering the rows of B.
+ *
+ * Every non-zero value x of row r of X adds x times row c of B to row r of Y, c being its
+ * column: only the rows of B selected by the non-zero values are read, each one contiguous
+ * (vectorisable). With the inputs of a batch as X and the transposed weights of a layer as B,
+ * this is the forward pass of a layer whose inputs are mostly zeros.
+ *
+ * @param X The sparse matrix in the CSR format (rows x X.cols).
+ * @param B Pointer to the dense matrix, row-major (X.cols x cols).
+ * @param cols The number of columns of B and Y.
+ * @param Y Pointer to the result, row-major (X.rows x cols), overwritten.
+ */
+void gatherRows(const SparseMatrix& X, const double* B, int cols, double* Y);
+
+
+/**
+ * @brief Computes the product Y = Xᵀ x E of a transposed sparse matrix by a dense one, scattering into the rows of Y.
+ *
+ * Every non-zero value x of row r of X adds x times row r of E to row c of Y, c being its
+ * column, so the rows of Y matching the columns of X without any non-zero value stay 0. With
+ * the inputs of a batch as X and the error of its outputs as E, this is the gradient of the
+ * weights of the layer, transposed (inputs x outputs).
+ *
+ * @param X The sparse matrix in the CSR format (X.rows x X.cols).
+ * @param E Pointer to the dense matrix, row-major (X.rows x cols).
+ * @param cols The number of columns of E and Y.
+ * @param Y Pointer to the result, row-major (X.cols x cols), overwritten.
+ */
+void scatterRows(const SparseMatrix& X, const double* E, int cols, double* Y);
+
+
+#endif // SPARSE_HPP
@@ -0,0 +1,40 @@
+#ifndef PRUNE_HPP
+#define PRUNE_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "network.hpp"
+#include "toolkit.hpp"
+#include "dataset.hpp"
+#include "pruning.hpp"
+
+
+// Largest number of training images used to rank the neurons, and of testing images used to time the networks
+static constexpr size_t CALIBRATION_SAMPLES = 1024;
+
+
+/**
+ * @brief Removes hidden neurons at several pruning levels and reports the accuracy/latency trade-off.
+ *
+ * For every level of `inputParams.pruneNeuronLevels`, from the smallest, every hidden layer
+ * keeps the `1 - level` best ranked of its original neurons (`inputParams.neuronRanking`) and
+ * the network is rebuilt as a smaller dense network (see `shrinkHiddenLayers`). Each network is
+ * tested on the testing dataset, timed on one image and on batches of `TEST_BATCH_SIZE` images,
+ * and saved with `WeightsBiasesToJSON`. A table with one row per level, the unpruned network
+ * first, is printed at the end.
+ *
+ * The first `CALIBRATION_SAMPLES` training images rank the neurons by mean activation, so the
+ * testing images only report the levels. The first `CALIBRATION_SAMPLES` testing images are used
+ * for the timings.
+ *
+ * @param net The network, with its weights already imported. It holds the smallest network on return.
+ * @param inputParams The input parameters, including the pruning levels, the testing dataset and, to rank by activation, the training dataset.
+ * @return int Returns 0 upon success, 1 if the network has no hidden layer or the dataset cannot be read.
+ */
+int networkPruneNeurons(Network &net, Arguments &inputParams);
+
+
+#endif // PRUNE_HPP
@@ -0,0 +1,173 @@
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <limits>
+
+
+/**
+ * @brief Enum class representing the learning-rate schedules used during training.
+ *
+ * - **CONSTANT**: The learning rate never changes.
+ *
+ * - **STEP**: The learning rate is multiplied by `gamma` every `stepSize` epochs.
+ *
+ * - **COSINE**: The learning rate follows half a cosine from its initial value down to zero
+ *   over the epochs of the training.
+ *
+ * - **PLATEAU**: The learning rate is multiplied by `gamma` when the monitored loss has not
+ *   improved for `plateauPatience` epochs.
+ *
+ * - **INVALID**: Indicates an unsupported or unrecognized schedule.
+ */
+enum class LearningRateSchedule {
+    CONSTANT,   ///< Constant learning rate.
+    STEP,       ///< Step decay.
+    COSINE,     ///< Cosine annealing.
+    PLATEAU,    ///< Reduce on plateau.
+    INVALID     ///< Indicates an unsupported schedule.
+};
+
+
+/**
+ * @brief Structure holding the learning-rate schedule and its parameters.
+ *
+ * @param schedule The schedule.
+ * @param warmupEpochs The number of epochs over which the learning rate grows linearly from
+ *                     almost zero to its scheduled value, batch by batch (0 disables the warmup).
+ * @param stepSize The number of epochs between two decays of the STEP schedule.
+ * @param gamma The factor applied to the learning rate by the STEP and PLATEAU schedules.
+ * @param plateauPatience The number of epochs without improvement before the PLATEAU schedule decays.
+ */
+struct ScheduleSettings
+{
+    LearningRateSchedule schedule = LearningRateSchedule::CONSTANT;
+    int warmupEpochs = 0;
+    int stepSize = 10;
+    double gamma = 0.1;
+    int plateauPatience = 2;
+};
+
+
+/**
+ * @brief Computes the learning rate of every batch from a schedule.
+ *
+ * The learning rate depends on the position in the training (epoch and batch) and, for the
+ * PLATEAU schedule, on the monitored loss reported at the end of each epoch with `endOfEpoch`.
+ */
+class LearningRateScheduler {
+
+    public:
+
+        /**
+         * @brief Constructs a new LearningRateScheduler.
+         *
+         * @param settings The schedule and its parameters.
+         * @param baseLearningRate The initial (peak) learning rate.
+         * @param epochs The number of epochs of the training.
+         */
+        LearningRateScheduler(const ScheduleSettings& settings, double baseLearningRate, int epochs);
+
+
+        /**
+         * @brief Returns the learning rate of a batch.
+         *
+         * @param epoch The index of the epoch, starting from 0.
+         * @param batch The index of the batch in the epoch, starting from 0.
+         * @param batchesPerEpoch The number of batches of an epoch.
+         * @return double The learning rate to use for the batch.
+         */
+        double learningRate(int epoch, int batch, int batchesPerEpoch) const;
+
+
+        /**
+         * @brief Reports the monitored loss at the end of an epoch.
+         *
+         * Only the PLATEAU schedule uses it, to decide when to decay the learning rate.
+         *
+         * @param monitoredLoss The validation loss, or the training loss without a validation split.
+         */
+        void endOfEpoch(double monitoredLoss);
+
+
+    private:
+
+        ScheduleSettings settings;
+        double baseLearningRate;
+        int epochs;
+        double plateauScale = 1.0;
+        double bestLoss = std::numeric_limits<double>::infinity();
+        int epochsWithoutImprovement = 0;
+};
+
+
+/**
+ * @brief Stops the training when the monitored loss stops improving.
+ *
+ * The loss must improve at least once every `patience` epochs, otherwise `shouldStop` becomes true.
+ */
+class EarlyStopping {
+
+    public:
+
+        /**
+         * @brief Constructs a new EarlyStopping.
+         *
+         * @param patience The number of epochs without improvement after which the training stops (0 disables it).
+         */
+        EarlyStopping(int patience);
+
+
+        /**
+         * @brief Reports the monitored loss at the end of an epoch.
+         *
+         * @param monitoredLoss The validation loss, or the training loss without a validation split.
+         * @return true if the loss is the best seen so far, false otherwise.
+         */
+        bool update(double monitoredLoss);
+
+
+        /**
+         * @brief Returns whether the training should stop.
+         */
+        bool shouldStop() const;
+
+
+        /**
+         * @brief Returns the best monitored loss seen so far.
+         */
+        double bestLoss() const;
+
+
+    private:
+
+        int patience;
+        double best = std::numeric_limits<double>::infinity();
+        int epochsWithoutImprovement = 0;
+};
+
+
+/**
+ * @brief Converts a LearningRateSchedule to its string representation.
+ *
+ * @param schedule The schedule.
+ * @return std::string The name of the schedule, or "None" if it is not supported.
+ */
+std::string LearningRateScheduleToString(LearningRateSchedule schedule);
+
+
+/**
+ * @brief Converts the name of a schedule, as given on the command line, to a LearningRateSchedule.
+ *
+ * The comparison is case-insensitive and accepts "constant", "step", "cosine" and "plateau".
+ *
+ * @param name The name of the schedule.
+ * @return LearningRateSchedule The schedule, or LearningRateSchedule::INVALID if the name is not recognised.
+ */
+LearningRateSchedule stringToLearningRateSchedule(const std::string& name);
+
+
+#endif // SCHEDULER_HPP
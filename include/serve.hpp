@@ -0,0 +1,53 @@
+#ifndef SERVE_HPP
+#define SERVE_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "network.hpp"
+#include "toolkit.hpp"
+#include "dataset.hpp"
+
+
+// Largest accepted request, in bytes (an encoded image or the raw pixels)
+static constexpr uint32_t SERVE_MAX_REQUEST_BYTES = 16u << 20;
+
+// Seconds between two latency reports while the server is busy
+static constexpr int SERVE_REPORT_SECONDS = 10;
+
+
+/**
+ * @brief Runs the network as a long-lived inference server.
+ *
+ * The network and its weights are loaded once, then the server answers requests until it is
+ * stopped (SIGINT/SIGTERM, or the end of the standard input). The requests are read from the
+ * clients of the Unix domain socket `inputParams.servePath`, or from the standard input if the
+ * path is "-" (the responses then go to the standard output and every message to the standard
+ * error). Every client can send several requests without waiting for their responses, which
+ * come back in the same order.
+ *
+ * Protocol (native byte order):
+ * - Request: a `uint32` length, then that many bytes. A payload of exactly the input size of
+ *   the network is taken as raw 8-bit grayscale pixels, any other payload is decoded as an
+ *   encoded image (PNG, JPEG, ...) with OpenCV.
+ * - Response: an `int32` predicted class (-1 if the request could not be decoded), a `uint32`
+ *   number of outputs, then the outputs of the network as `double` (none on error).
+ *
+ * Requests are decoded by the thread of their client and queued. A single batching thread
+ * waits for the first request, then collects up to `inputParams.serveBatch` requests for at
+ * most `inputParams.serveWaitUs` microseconds after the arrival of the oldest one, and runs the
+ * micro-batch through `forwardPropagationBatch` (itself parallel on the thread pool). The
+ * latency of every request is measured from the end of its reading to the end of the writing
+ * of its response: the median, the 99th percentile, the throughput and the mean batch size are
+ * reported every `SERVE_REPORT_SECONDS` seconds and when the server stops.
+ *
+ * @param net The neural network, with its weights already imported.
+ * @param inputParams The input parameters, including the path and the batching limits of the server.
+ * @return int Returns 0 when the server stopped normally, 1 if it could not start.
+ */
+int networkServe(Network &net, Arguments &inputParams);
+
+
+#endif // SERVE_HPP
@@ -6,6 +6,13 @@
 #include "lossFunctions.hpp"
 #include "printer.hpp"
 #include "tester.hpp"
+#include "threadPool.hpp"
+#include "dataset.hpp"
+#include "metrics.hpp"
+
+
+// Number of samples run through the network at once by each thread while testing
+static constexpr size_t TEST_BATCH_SIZE = 64;
 
 /**
  * @brief Holds the result of a single test sample, 
@@ -24,6 +31,10 @@ struct TestResult
  * @brief Tests the neural network on a given test dataset, performing forward propagation, calculating loss, 
  *        and determining the accuracy and average loss across the test set.
  * 
+ * The samples go through `evaluateImages`, which splits them over the thread pool. The results are
+ * gathered in order, so the printed progress and the final results do not depend on the number
+ * of threads.
+ * 
  * @param net The neural network to be tested.
  * @param inputParams The testing parameters, including the test dataset.
  * @return int Returns 0 upon successful testing completion.
@@ -31,6 +42,38 @@ struct TestResult
 int networkTest(Network &net, Arguments &inputParams);
 
 
+/**
+ * @brief Runs a list of images through the network and returns the result of every image.
+ * 
+ * The images are decoded into an in-memory `Dataset` and evaluated with `evaluateDataset`.
+ * The results are in the order of `images`.
+ * 
+ * @param net The neural network to be evaluated.
+ * @param images The paths of the images.
+ * @param metrics If not null, receives the accuracy and the confusion matrix of the images.
+ * @return std::vector<TestResult> The label, prediction, loss and path of every image (empty if an image could not be read).
+ */
+std::vector<TestResult> evaluateImages(Network &net, const std::vector<std::string>& images, ClassificationMetrics* metrics = nullptr);
+
+
+/**
+ * @brief Runs every sample of a dataset through the network and returns the result of every sample.
+ * 
+ * This is the fast inference path shared by testing and validation. The samples are split over
+ * the thread pool and each thread runs its samples through the network in batches of
+ * `TEST_BATCH_SIZE`, without changing the network. The results are in the order of the dataset.
+ * 
+ * The loss, the prediction and the metrics of each batch come from a single pass of `evaluateBatch`
+ * over its outputs, and no derivative of the loss is computed.
+ * 
+ * @param net The neural network to be evaluated.
+ * @param dataset The samples to evaluate.
+ * @param metrics If not null, receives the accuracy and the confusion matrix of the dataset.
+ * @return std::vector<TestResult> The label, prediction and loss of every sample.
+ */
+std::vector<TestResult> evaluateDataset(Network &net, const Dataset& dataset, ClassificationMetrics* metrics = nullptr);
+
+
 /**
  * @brief Tests multiple sets of weights and biases on the neural network and evaluates the performance.
  * 
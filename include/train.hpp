@@ -3,18 +3,78 @@
 
 #include <algorithm>
 #include <random>
+#include <atomic>
+#include <cmath>
+#include <numeric>
+#include <cstdint>
 
 #include "toolkit.hpp"
 #include "network.hpp"
 #include "lossFunctions.hpp"
+#include "metrics.hpp"
 #include "saveToJson.hpp"
 #include "printer.hpp"
+#include "threadPool.hpp"
+#include "scheduler.hpp"
+#include "test.hpp"
+#include "dataset.hpp"
+#include "random.hpp"
+#include "processGroup.hpp"
+
+
+// Minimum number of samples of a batch given to each thread
+static constexpr size_t MIN_SHARD_SAMPLES = 8;
+
+// Random stream used to shuffle the training dataset
+static constexpr uint64_t SHUFFLE_STREAM = 1;
+
+// Number of batch statistics exchanged with the gradients between training processes
+static constexpr size_t REDUCED_STATS = 4;
+
+
+/**
+ * @brief Statistics gathered while training on one or more batches.
+ * 
+ * @param lossSum The sum of the loss of every sample.
+ * @param geometricMeanLoss The geometric mean of the loss of the samples of a single batch.
+ * @param correct The number of correctly classified samples.
+ * @param samples The number of samples.
+ * @param batches The number of batches.
+ */
+struct TrainingStats
+{
+    double lossSum = 0.0;
+    double geometricMeanLoss = 1.0;
+    int correct = 0;
+    int samples = 0;
+    int batches = 0;
+};
 
 
 /**
  * @brief Trains the neural network using the training dataset, performing forward and backward passes, 
  *        calculating loss, and updating weights and biases.
  * 
+ * The images are decoded once into an in-memory `Dataset`. Every epoch shuffles a permutation of
+ * the 32-bit sample indices with a random stream derived from `inputParams.seed` and the batches are
+ * consecutive slices of it, so no path or image is copied.
+ * 
+ * Apart from the Hogwild mode, the training is deterministic: with the same seed and the same number
+ * of threads two runs give bit-identical weights, since the batches are split into the same shards
+ * and the shard gradients are always summed in the same order.
+ * 
+ * The learning rate of every batch comes from the schedule in `inputParams.schedule`. At the end of
+ * each epoch the network is evaluated on `inputParams.ValidationDatasetImages` (if a validation split
+ * was requested) and the validation loss, or the training loss otherwise, drives the reduce-on-plateau
+ * schedule and the early stopping: after `inputParams.patience` epochs without improvement the
+ * training stops and the weights of the best epoch are restored.
+ * 
+ * With several training processes (see `startTrainingProcesses`) every process trains on its own
+ * shard of the images (one image every `processes`) and, after the backward pass of each batch, the
+ * gradients and the statistics of the batch are summed over the processes with `allReduce`. Every
+ * process then applies the same update, so the weights stay identical. Only process 0 validates the
+ * network and saves the weights.
+ * 
  * @param net The neural network to be trained.
  * @param inputParams The training parameters, including the dataset, epochs, batch size, and learning rate.
  * @return int Returns 0 upon successful training completion.
@@ -23,13 +83,72 @@ int networkTrain(Network &net, Arguments &inputParams);
 
 
 /**
- * @brief Splits the input vector into batches of a specified size.
+ * @brief Starts the training processes requested with `-Processes` and synchronises them.
+ * 
+ * Process 0 launches the others (see `ProcessGroup`), then sends them its seed and its initial
+ * weights, so that all the processes start from the same network. Does nothing with a single process.
+ * 
+ * @param net The neural network to be trained.
+ * @param inputParams The training parameters, including the number of processes and the rank of this one.
+ * @param argc The number of command-line arguments, forwarded to the other processes.
+ * @param argv The command-line arguments, forwarded to the other processes.
+ * @return int Returns 0 if every process joined the group, 1 otherwise.
+ */
+int startTrainingProcesses(Network &net, Arguments &inputParams, int argc, char **argv);
+
+
+/**
+ * @brief Evaluates the network on the validation images.
+ * 
+ * Uses the batched, multi-threaded inference path of `evaluateDataset`, so it adds little to
+ * the time of an epoch. The network is not changed.
+ * 
+ * @param net The neural network to be evaluated.
+ * @param dataset The validation dataset.
+ * @return TrainingStats The summed loss, the number of correct predictions and the number of samples.
+ */
+TrainingStats validateNetwork(Network &net, const Dataset& dataset);
+
+
+/**
+ * @brief Runs the forward and backward pass of a single batch.
+ * 
+ * Copies the samples of the batch into the workspace, runs them through the network, computes
+ * the loss and its derivative for every sample and leaves the gradients of the batch in
+ * `workspace.gradients`. The weights are not updated. The network is only read, so several
+ * threads can call this function on the same network with their own workspace.
+ * 
+ * When the batch is large enough it is split into shards of at least `MIN_SHARD_SAMPLES`
+ * samples that run in parallel on the thread pool, each in its own workspace in
+ * `workspace.shards`. The gradients of the shards are then summed into `workspace.gradients`.
+ * 
+ * @param net The neural network to be trained.
+ * @param dataset The training dataset.
+ * @param indices Pointer to the indices of the samples of the batch.
+ * @param count The number of samples of the batch.
+ * @param workspace The buffers used for the batch.
+ * @return TrainingStats The loss and accuracy of the batch.
+ */
+TrainingStats trainBatch(Network &net, const Dataset& dataset, const uint32_t* indices, size_t count, BatchWorkspace& workspace);
+
+
+/**
+ * @brief Trains the network for one epoch with lock-free asynchronous SGD (Hogwild).
  * 
- * @param inputVec The vector containing the input data (e.g., image paths).
- * @param batchSize The size of each batch.
- * @return std::vector<std::vector<std::string>> A 2D vector where each inner vector is a batch of input data.
+ * `inputParams.asyncWorkers` tasks of the thread pool draw the batches of the epoch from a shared counter. Each
+ * worker computes the gradients of its batch and immediately applies them to the shared
+ * weights of the network, without locks and without waiting for the other workers. The
+ * statistics of each worker are printed and merged into the returned epoch statistics.
+ * 
+ * @param net The neural network to be trained.
+ * @param inputParams The training parameters, including the number of workers and the batch size.
+ * @param dataset The training dataset.
+ * @param permutation The shuffled indices of the samples of the epoch, sliced into consecutive batches.
+ * @param epoch The index of the epoch.
+ * @param scheduler The learning-rate schedule, queried for every batch.
+ * @return TrainingStats The merged statistics of all the workers.
  */
-std::vector<std::vector<std::string>> splitIntoBatches(const std::vector<std::string>& inputVec, int batchSize);
+TrainingStats trainEpochHogwild(Network &net, Arguments &inputParams, const Dataset& dataset, const std::vector<uint32_t>& permutation, int epoch, const LearningRateScheduler& scheduler);
 
 
 #endif // TRAIN_HPP
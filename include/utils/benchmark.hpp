@@ -0,0 +1,85 @@
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <memory>
+
+#include "network.hpp"
+#include "fixedNetwork.hpp"
+#include "toolkit.hpp"
+#include "printer.hpp"
+
+
+// Passes over the samples when timing the forward pass of a network
+static constexpr int LATENCY_RUNS = 3;
+
+
+/**
+ * @brief The compile-time version of the network built in `main.cpp`.
+ *
+ * Layer(784, 128) -> ReLU -> Layer(128, 10) -> Softmax.
+ */
+using DeployedNetwork = FixedNetwork<FixedDenseLayer<784, 128, ActivationType::RELU>,
+                                     FixedDenseLayer<128, 10, ActivationType::SOFTMAX>>;
+
+
+/**
+ * @brief Benchmarks the runtime network against its compile-time counterpart.
+ *
+ * The weights of the runtime network are copied into a `DeployedNetwork`. The images of the
+ * testing dataset are decoded once, then both inference paths are timed over the same samples
+ * for `inputParams.benchmarkRuns` passes. The function prints the time per image and the
+ * throughput of both paths, the speedup of the fixed network and the largest absolute
+ * difference between the outputs of the two paths.
+ *
+ * @param net The runtime network, with its weights already imported.
+ * @param inputParams The input parameters, including the testing dataset.
+ * @return int Returns 0 upon success, 1 if the network topology does not match `DeployedNetwork`.
+ */
+int inferenceBenchmark(Network &net, Arguments &inputParams);
+
+
+/**
+ * @brief Returns the width of the input and of the standard layers of a network, e.g. "784-48-10".
+ *
+ * @param net The network.
+ * @return std::string The widths separated by dashes.
+ */
+std::string networkLayout(const Network& net);
+
+
+/**
+ * @brief Times the batched forward pass of a network.
+ *
+ * The samples are run `LATENCY_RUNS` times through the network in batches of `batchSize`
+ * samples; the samples that do not fill a whole batch are left out.
+ *
+ * @param net The network.
+ * @param inputs The samples, one per row (samples x net.inputSize()).
+ * @param samples The number of samples.
+ * @param batchSize The number of samples run through the network at once.
+ * @return double The time per sample in microseconds, 0 if there are fewer samples than `batchSize`.
+ */
+double forwardLatencyUs(const Network& net, const std::vector<double>& inputs, int samples, int batchSize);
+
+
+/**
+ * @brief Compares a binary or ternary network with the same network in full precision.
+ *
+ * The testing images are run through the network once with its real-valued weights (fp64) and
+ * once with the weights quantized as `inputParams.quantization`. For both the function prints
+ * the accuracy, the loss, the time per image and the number of images per second on one image
+ * and on batches of `TEST_BATCH_SIZE` images, and the storage of the weights. The network is
+ * quantized again on return.
+ *
+ * @param net The network, with its weights already imported.
+ * @param inputParams The input parameters, including the quantization and the testing dataset.
+ * @return int Returns 0 upon success, 1 if the dataset cannot be read.
+ */
+int quantizationReport(Network &net, Arguments &inputParams);
+
+
+#endif // BENCHMARK_HPP
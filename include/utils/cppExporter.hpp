@@ -0,0 +1,36 @@
+#ifndef CPPEXPORTER_HPP
+#define CPPEXPORTER_HPP
+
+#include <iostream>
+#include <string>
+
+#include "network.hpp"
+
+
+/**
+ * @brief Compiles a network ahead of time into a standalone C++ inference source.
+ *
+ * Two files are written next to each other, `<outputPath>.hpp` and `<outputPath>.cpp` (an
+ * extension given in `outputPath` is ignored). The source bakes every weight and bias in as an
+ * `alignas(64) static constexpr double` array, so the parameters live in the read-only data of
+ * the program using it and nothing is parsed at run time, and defines one fixed-shape function
+ * following the exact sequence of `net.Layers`: every size is a compile-time constant and every
+ * activation is emitted inline. The generated code only needs the standard library (no JSON,
+ * OpenCV or VanillaNet-cpp) and computes the same outputs as `Network::forwardPropagation` up
+ * to the rounding of the sums.
+ *
+ * The declarations are placed in a namespace named after the file (e.g. `mnist` for
+ * `./mnist.cpp`):
+ * - `INPUT_SIZE` and `OUTPUT_SIZE`, the sizes of one sample.
+ * - `void forward(const double* input, double* output)`, the outputs of one sample.
+ * - `int predict(const double* input)`, the index of the largest output.
+ *
+ * @param net The network, with its weights already imported.
+ * @param outputPath The path of the files to write, without extension.
+ * @param weightsPath The checkpoint the weights come from, recorded in the generated files.
+ * @return int Returns 0 if the files were written, 1 otherwise (the reason is printed).
+ */
+int exportNetworkToCpp(Network& net, const std::string& outputPath, const std::string& weightsPath);
+
+
+#endif // CPPEXPORTER_HPP
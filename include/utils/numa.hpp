@@ -0,0 +1,79 @@
+#ifndef NUMA_HPP
+#define NUMA_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+/**
+ * @brief Structure describing a NUMA node: a socket (or a part of it) and its local memory.
+ *
+ * @param id The number of the node in `/sys/devices/system/node`.
+ * @param cpus The CPUs of the node the process is allowed to run on.
+ */
+struct NumaNode
+{
+    int id = 0;
+    std::vector<int> cpus;
+};
+
+
+/**
+ * @brief Returns the NUMA topology of the machine, read once from `/sys/devices/system/node`.
+ *
+ * Only the CPUs in the affinity mask of the process are listed and the nodes without any of
+ * them are left out. Without NUMA information (e.g. not on Linux) a single node holds every
+ * hardware thread.
+ *
+ * @return const std::vector<NumaNode>& The nodes, in increasing id order.
+ */
+const std::vector<NumaNode>& numaTopology();
+
+
+/**
+ * @brief Returns the CPU a pinned thread of the thread pool runs on.
+ *
+ * The CPUs are taken node after node, so consecutive threads fill a socket before moving to the
+ * next one and a block of consecutive threads (e.g. the threads of one training process) stays
+ * on as few nodes as possible.
+ *
+ * @param index The index of the thread among the pinned threads.
+ * @return int The CPU of the thread.
+ */
+int pinnedCpu(int index);
+
+
+/**
+ * @brief Returns the index, in `numaTopology()`, of the node a CPU belongs to.
+ *
+ * @param cpu The CPU.
+ * @return int The index of its node, 0 if it is unknown.
+ */
+int numaNodeOfCpu(int cpu);
+
+
+/**
+ * @brief Returns the index, in `numaTopology()`, of the node the calling thread runs on.
+ *
+ * The node of a pinned thread never changes. An unpinned thread gets the node it is running
+ * on right now.
+ */
+int currentNumaNode();
+
+
+/**
+ * @brief Records the CPU the calling thread was pinned to, for `currentNumaNode`.
+ *
+ * @param cpu The CPU the thread was pinned to.
+ */
+void setCurrentThreadCpu(int cpu);
+
+
+/**
+ * @brief Returns a short description of the topology for the startup banner (e.g. "2 (node0: 0-15 | node1: 16-31)").
+ */
+std::string numaTopologyToString();
+
+
+#endif // NUMA_HPP
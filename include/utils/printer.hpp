@@ -14,7 +14,15 @@
 
 #include "imageExtractor.hpp"
 #include "network.hpp"
+#include "gemm.hpp"
+#include "threadPool.hpp"
+#include "numa.hpp"
 #include "toolkit.hpp"
+#include "metrics.hpp"
+
+
+// Above this number of classes the confusion matrix is not printed
+static constexpr int MAX_CONFUSION_CLASSES = 20;
 
 
 /**
@@ -90,4 +98,36 @@ void infoPrinter(Arguments& inputParams, Network& net);
 void finalResultPrinter(double accuracy, double loss, int corrects, int total, std::string title);
 
 
+/**
+ * @brief Prints the confusion matrix and the accuracy of every class after testing.
+ * 
+ * The rows are the true classes and the columns the predicted ones. Nothing is printed if the
+ * confusion matrix was not tracked or if there are more than `MAX_CONFUSION_CLASSES` classes.
+ * 
+ * @param metrics The metrics of the test dataset.
+ */
+void confusionMatrixPrinter(const ClassificationMetrics& metrics);
+
+
+/**
+ * @brief Prints the sparsity and the storage of every layer with parameters after pruning.
+ * 
+ * For each layer the number of weights kept and the size of the CSR storage are compared to the
+ * dense weight matrix.
+ * 
+ * @param net The pruned network.
+ */
+void sparsityPrinter(const Network& net);
+
+
+/**
+ * @brief Prints the quantization and the storage of every binary or ternary layer.
+ * 
+ * For each layer the size of the bit-planes is compared to the dense weight matrix.
+ * 
+ * @param net The quantized network.
+ */
+void quantizationPrinter(const Network& net);
+
+
 #endif // PRINTER_HPP
\ No newline at end of file
@@ -0,0 +1,130 @@
+#ifndef PROCESSGROUP_HPP
+#define PROCESSGROUP_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <sys/types.h>
+
+
+/**
+ * @brief Group of training processes on one machine that exchange data through shared memory.
+ *
+ * Process 0 (the one started by the user) creates a POSIX shared-memory segment and launches the
+ * other processes by running the executable again with the same arguments plus `-Rank <rank>`
+ * and `-Group <segment>`. The segment holds a barrier, one slot per process and a result area:
+ *
+ * - `allReduce` sums a vector over all the processes. Every process writes its vector into its
+ *   slot, then each process reduces its own 1/N chunk of the vector over all the slots into the
+ *   result area (reduce-scatter) and finally copies the whole result back (all-gather). The slots
+ *   are always summed in rank order, so every process gets bit-identical sums.
+ *
+ * - `broadcast` copies a vector of process 0 to all the others.
+ *
+ * A group of a single process (the default) does nothing: `allReduce` and `broadcast` return at
+ * once. If a process dies, the others notice it at the next barrier and their calls fail.
+ */
+class ProcessGroup {
+
+    public:
+
+        ProcessGroup() = default;
+        ProcessGroup(const ProcessGroup&) = delete;
+        ProcessGroup& operator=(const ProcessGroup&) = delete;
+
+        /**
+         * @brief Waits for the other processes (see `finish`) and unmaps the shared memory.
+         */
+        ~ProcessGroup();
+
+
+        /**
+         * @brief Creates or joins the shared memory and, on process 0, launches the other processes.
+         *
+         * Returns once every process has joined the group.
+         *
+         * @param processes The number of processes of the group.
+         * @param rank The index of the calling process (0 for the process started by the user).
+         * @param name The name of the shared-memory segment to join (ignored by process 0).
+         * @param capacity The maximum number of values exchanged by a single call.
+         * @param argc The number of command-line arguments, forwarded to the other processes.
+         * @param argv The command-line arguments, forwarded to the other processes.
+         * @return true if every process joined the group, false otherwise.
+         */
+        bool start(int processes, int rank, const std::string& name, size_t capacity, int argc, char** argv);
+
+
+        /**
+         * @brief Returns the number of processes of the group.
+         */
+        int size() const;
+
+
+        /**
+         * @brief Returns the index of the calling process in the group.
+         */
+        int rank() const;
+
+
+        /**
+         * @brief Replaces `values` by its sum over all the processes.
+         *
+         * Every process must call it with a vector of the same size, at most the capacity of the group.
+         *
+         * @param values The values of the calling process, replaced by the sums.
+         * @return true on success, false if a process of the group died.
+         */
+        bool allReduce(std::vector<double>& values);
+
+
+        /**
+         * @brief Replaces `values` by the values of process 0 on every process.
+         *
+         * @param values The values to send (process 0) or to receive (the other processes).
+         * @return true on success, false if a process of the group died.
+         */
+        bool broadcast(std::vector<double>& values);
+
+
+        /**
+         * @brief Waits until every process of the group reaches the barrier.
+         *
+         * @return true on success, false if a process of the group died.
+         */
+        bool barrier();
+
+
+        /**
+         * @brief Waits for the other processes to exit (process 0 only).
+         */
+        void finish();
+
+
+    private:
+
+        struct SharedHeader;
+
+        int processes = 1;
+        int processRank = 0;
+        std::string segmentName;
+        size_t capacity = 0;
+        size_t mappedSize = 0;
+        SharedHeader* header = nullptr;
+        double* slots = nullptr;
+        double* result = nullptr;
+        std::vector<pid_t> children;
+
+        bool childrenAlive();
+        void abort();
+};
+
+
+/**
+ * @brief Returns the process group of the program (a group of one process until it is started).
+ */
+ProcessGroup& processGroup();
+
+
+#endif // PROCESSGROUP_HPP
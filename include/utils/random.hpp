@@ -0,0 +1,48 @@
+#ifndef RANDOM_HPP
+#define RANDOM_HPP
+
+#include <iostream>
+#include <random>
+#include <cstdint>
+
+
+/**
+ * @brief Mixes a 64-bit value into a well distributed 64-bit hash (SplitMix64 finaliser).
+ *
+ * Consecutive inputs give unrelated outputs, so it is used to derive independent seeds
+ * from the global seed and a stream number.
+ *
+ * @param value The value to mix.
+ * @return uint64_t The mixed value.
+ */
+uint64_t splitMix64(uint64_t value);
+
+
+/**
+ * @brief Sets the seed all the random streams of the program derive from.
+ *
+ * @param seed The global seed (`-Seed` on the command line).
+ */
+void setGlobalSeed(uint64_t seed);
+
+
+/**
+ * @brief Returns the global seed set with `setGlobalSeed`.
+ */
+uint64_t globalSeed();
+
+
+/**
+ * @brief Returns a random engine for an independent, reproducible stream.
+ *
+ * The engine only depends on the global seed and on `stream`, not on the thread that uses it.
+ * Parallel code that must give the same result for any schedule should key its streams by
+ * work item (e.g. a sample or a row index) rather than by thread.
+ *
+ * @param stream The number of the stream.
+ * @return std::mt19937_64 An engine seeded for that stream.
+ */
+std::mt19937_64 rngStream(uint64_t stream);
+
+
+#endif // RANDOM_HPP
@@ -0,0 +1,191 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+
+/**
+ * @brief Counts the tasks of a group that are still pending.
+ *
+ * Every task submitted with a group increments the counter, and decrements it when it is done.
+ * `ThreadPool::wait()` returns once the counter is back to zero.
+ */
+struct TaskGroup
+{
+    std::atomic<int> pending{0};
+};
+
+
+/**
+ * @brief Work-stealing task scheduler shared by the whole program.
+ *
+ * Every worker thread owns a deque of tasks. A worker pushes and pops the tasks it creates at
+ * the back of its own deque, and when it runs out of work it steals from the front of the deque
+ * of another worker. Tasks submitted from outside the pool are spread over the deques in a
+ * round-robin fashion.
+ *
+ * A thread waiting for a group of tasks does not block: it keeps running tasks from the pool
+ * until the group is done. Nested parallel loops (e.g. a parallel loop inside a task) therefore
+ * never deadlock and never create more threads than the pool has.
+ *
+ * Training, testing, image decoding and dataset conversion all submit their work to the pool
+ * returned by `threadPool()`, whose size is set from the command line with `-Threads`.
+ */
+class ThreadPool {
+
+    public:
+
+        /**
+         * @brief Starts the worker threads.
+         *
+         * The thread creating the pool counts as one of the threads, since it runs tasks while
+         * it waits for them, so `threads - 1` workers are started.
+         *
+         * @param threads The number of threads (values below 1 use the number of hardware threads).
+         * @param pinThreads Whether to pin every thread to its own core (Linux only).
+         * @param firstCore The core of the first thread when pinning, the others take the next ones.
+         */
+        ThreadPool(int threads, bool pinThreads, int firstCore = 0);
+
+        /**
+         * @brief Stops and joins the worker threads. The pending tasks are run first.
+         */
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+
+        /**
+         * @brief Returns the number of threads running tasks: the workers plus the caller.
+         */
+        int size() const;
+
+
+        /**
+         * @brief Returns the index of the calling thread in [0, size()).
+         *
+         * Workers get their own index and the thread outside the pool (the main thread) gets
+         * `size() - 1`. Use it to index per-thread buffers of `size()` elements.
+         */
+        int currentSlot() const;
+
+
+        /**
+         * @brief Returns the CPU the thread of a slot is pinned to, or -1 if the threads are not pinned.
+         *
+         * @param slot The slot of the thread (see `currentSlot`).
+         */
+        int slotCpu(int slot) const;
+
+
+        /**
+         * @brief Submits a task to the pool.
+         *
+         * @param group The group the task belongs to.
+         * @param task The function to run.
+         */
+        void submit(TaskGroup& group, std::function<void()> task);
+
+
+        /**
+         * @brief Submits a task to the deque of a given thread.
+         *
+         * The thread runs it unless another one runs out of work and steals it first. Submitting
+         * the same piece of work to the same slot every time keeps its buffers in the caches and
+         * on the NUMA node of that thread.
+         *
+         * @param group The group the task belongs to.
+         * @param task The function to run.
+         * @param slot The slot of the thread (see `currentSlot`), taken modulo `size()`.
+         */
+        void submit(TaskGroup& group, std::function<void()> task, int slot);
+
+
+        /**
+         * @brief Runs tasks of the pool until every task of the group is done.
+         *
+         * @param group The group to wait for.
+         */
+        void wait(TaskGroup& group);
+
+
+        /**
+         * @brief Runs `body` over the range [begin, end) split in chunks of at least `grain` indices.
+         *
+         * The range is cut into about four chunks per thread so that the workers that finish
+         * early can steal the remaining chunks. The caller takes part in the work and the
+         * function returns once every chunk is done.
+         *
+         * @param begin The first index of the range.
+         * @param end One past the last index of the range.
+         * @param grain The minimum number of indices per chunk.
+         * @param body The function run on every chunk, with the first and one past the last index of the chunk.
+         */
+        void parallelFor(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& body);
+
+
+    private:
+
+        struct Task
+        {
+            std::function<void()> function;
+            TaskGroup* group;
+        };
+
+        struct WorkerQueue
+        {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        int threadCount;
+        int firstCore;
+        bool pinned;
+        std::vector<std::thread> workers;
+        std::vector<std::unique_ptr<WorkerQueue>> queues;
+
+        std::mutex sleepMutex;
+        std::condition_variable wakeUp;
+        std::atomic<int> queuedTasks{0};
+        std::atomic<size_t> nextQueue{0};
+        bool stopping = false;
+
+        void workerLoop(int index, bool pinThread);
+        bool popTask(int index, Task& task);
+        bool stealTask(int thief, Task& task);
+        bool runOneTask();
+        static void runTask(Task& task);
+};
+
+
+/**
+ * @brief Sets the size of the project-wide thread pool.
+ *
+ * Must be called before the first call to `threadPool()`, usually right after the command
+ * line is parsed. Later calls have no effect.
+ *
+ * @param threads The number of threads (values below 1 use the number of hardware threads).
+ * @param pinThreads Whether to pin every thread to its own core.
+ * @param firstCore The core of the first thread when pinning (e.g. to give each training process its own cores).
+ */
+void configureThreadPool(int threads, bool pinThreads, int firstCore = 0);
+
+
+/**
+ * @brief Returns the project-wide thread pool, creating it on the first call.
+ *
+ * @return A reference to the thread pool.
+ */
+ThreadPool& threadPool();
+
+
+#endif // THREADPOOL_HPP
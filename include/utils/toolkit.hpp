@@ -11,33 +11,41 @@
 #include <sys/ioctl.h>
 #include <unistd.h>
 #include <cstring>
+#include <random>
 #ifdef _WIN32
 #include <windows.h>
 #endif
 
 #include "imageExtractor.hpp"
+#include "threadPool.hpp"
+#include "optimizer.hpp"
+#include "initializer.hpp"
+#include "architecture.hpp"
+#include "pruning.hpp"
+#include "quantization.hpp"
+#include "scheduler.hpp"
+
+
+// Random stream used to hold out the validation images, far from the streams of the layers and of the shuffling
+static constexpr uint64_t VALIDATION_STREAM = 1ull << 32;
 
 
 /**
  * @brief Structure to store image data and its associated label.
  * 
- * This structure is used to hold the pixel data for an image, 
- * the corresponding label (as an integer), and the label represented 
- * as a one-hot encoded vector.
+ * This structure is used to hold the pixel data for an image and the 
+ * corresponding label (as an integer). The buffer can be reused for 
+ * another image without any new allocation (see `loadSample`).
  * 
  * @param imagePixelVector A vector of doubles representing the pixel values of the image.
  *                         This contains the flattened image data (e.g., grayscale values).
  * @param label An integer representing the label or class associated with the image.
  *              For example, in digit classification, this might be the digit (0-9).
- * @param labelVector A one-hot encoded vector of doubles representing the label. 
- *                    This is used in neural network training where the label is represented 
- *                    as a vector with a 1 at the index of the correct class and 0 elsewhere.
  */
 struct VectorLabel
 {
     std::vector<double> imagePixelVector;
-    int label;
-    std::vector<double> labelVector;
+    int label = 0;
 };
 
 
@@ -63,6 +71,35 @@ struct VectorLabel
  * @param bestAccuracy A double value representing the best accuracy achieved during training.
  * @param bestWeightsBiasesPath A string that specifies the path to the file containing the best weights and biases.
  * @param print A boolean flag indicating whether to print additional information during training/testing.
+ * @param benchmark A boolean flag indicating whether to benchmark the runtime network against the fixed network.
+ * @param benchmarkRuns An integer value representing the number of passes over the testing dataset when benchmarking.
+ * @param asyncWorkers An integer value representing the number of Hogwild workers (0 for synchronous training, at most the size of the thread pool).
+ * @param threads An integer value representing the number of threads of the thread pool (0 for one per hardware thread).
+ * @param pinThreads A boolean flag indicating whether to pin every thread of the thread pool to its own core.
+ * @param optimizer The optimiser used to update the weights and biases during training. Defaults to SGD.
+ * @param initialization The scheme used to initialize the weights of the layers. Defaults to Glorot.
+ * @param validationSplit A double value representing the fraction of the training dataset held out for validation.
+ * @param ValidationDatasetImages A vector of strings that stores the paths to the validation images, taken from the training dataset.
+ * @param schedule The learning-rate schedule and its parameters.
+ * @param patience An integer value representing the number of epochs without improvement before stopping (0 disables early stopping).
+ * @param processes An integer value representing the number of training processes exchanging their gradients through shared memory.
+ * @param rank The index of this process among the training processes (0 for the process started by the user).
+ * @param processGroupName The name of the shared memory of the training processes (set by process 0 for the others).
+ * @param seed The seed of every random draw (initial weights, shuffling). Defaults to a random value, so every run differs.
+ * @param deterministic A boolean flag indicating that the seed was given on the command line to reproduce a run.
+ * @param serve A boolean flag indicating whether to run the network as an inference server.
+ * @param servePath The Unix domain socket of the server ("-" for the standard input and output).
+ * @param serveBatch An integer value representing the largest number of requests the server runs through the network at once.
+ * @param serveWaitUs An integer value representing the longest time, in microseconds, a request waits for others to fill its batch.
+ * @param architecture The layers of the network built for the 28x28 datasets. Defaults to the fully connected network.
+ * @param exportCppPath The path (without extension) of the standalone C++ source the network is compiled to, empty to not export it.
+ * @param pruneSparsity A double value representing the fraction of the weights of every layer pruned by magnitude (0 disables the pruning).
+ * @param hiddenSize An integer value representing the number of neurons of the hidden layer of the MLP.
+ * @param pruneNeuronLevels The fractions of the hidden neurons removed by structured pruning, one smaller network per level (empty to not prune).
+ * @param neuronRanking How the hidden neurons are ranked before removing the least useful ones. Defaults to the norm of their weights.
+ * @param factorizeBudget A double value representing the largest drop of accuracy, in percentage points, allowed by the low-rank factorisation of the layers (negative to not factorise).
+ * @param layerRanks The rank of every fully connected layer of the network, in order (0 or missing for a layer that is not factorised).
+ * @param quantization The values the weights of the fully connected layers are restricted to (binary, ternary). Defaults to full precision.
  */
 struct Arguments
 {
@@ -80,6 +117,35 @@ struct Arguments
     double bestAccuracy = 0;
     std::string bestWeightsBiasesPath = "";
     bool print = false;
+    bool benchmark = false;
+    int benchmarkRuns = 10;
+    int asyncWorkers = 0;
+    int threads = 0;
+    bool pinThreads = false;
+    OptimizerType optimizer = OptimizerType::SGD;
+    InitializationType initialization = InitializationType::GLOROT;
+    double validationSplit = 0.0;
+    std::vector<std::string> ValidationDatasetImages;
+    ScheduleSettings schedule;
+    int patience = 0;
+    int processes = 1;
+    int rank = 0;
+    std::string processGroupName = "";
+    unsigned int seed = std::random_device{}();
+    bool deterministic = false;
+    bool serve = false;
+    std::string servePath = "";
+    int serveBatch = 32;
+    int serveWaitUs = 2000;
+    NetworkArchitecture architecture = NetworkArchitecture::MLP;
+    std::string exportCppPath = "";
+    double pruneSparsity = 0.0;
+    int hiddenSize = 128;
+    std::vector<double> pruneNeuronLevels;
+    NeuronRanking neuronRanking = NeuronRanking::NORM;
+    double factorizeBudget = -1.0;
+    std::vector<int> layerRanks;
+    WeightQuantization quantization = WeightQuantization::NONE;
 };
 
 
@@ -119,27 +185,6 @@ std::string makeFolder(const std::string& basePath, const std::string& folderNam
 int labelExtractor(const std::string& imagePath);
 
 
-/**
- * @brief Generates a one-hot encoded vector for a given label.
- * 
- * This function creates a one-hot encoded vector of length 10, where the position 
- * corresponding to the input label is set to 1.0, and all other positions are set 
- * to 0.0. This is typically used in classification tasks where the label corresponds 
- * to a class (e.g., digits 0-9).
- * 
- * Example: If the label is 3, the function will return the vector: 
- * [0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0].
- * 
- * @param label The class label as an integer (expected to be between 0 and 9).
- * 
- * @return A std::vector<double> representing the one-hot encoded label.
- * 
- * @note The input label should be between 0 and 9. If the label is out of this range, 
- *       the function may produce undefined behavior.
- */
-std::vector<double> trueLabel(int label);
-
-
 /**
  * @brief Retrieves a list of image paths from a dataset directory or a single image file.
  * 
@@ -186,23 +231,47 @@ std::vector<std::string> datasetImagesVector(const std::string& datasetPath);
 int parser(Arguments& inputParams, int argc, char** inputToParse);
 
 
+/**
+ * @brief Returns the number of training images held out for validation by `splitValidationSet`.
+ * 
+ * @param inputParams The Arguments structure holding the training dataset and the split.
+ * @return The number of validation images.
+ */
+size_t validationSetSize(const Arguments& inputParams);
+
+
+/**
+ * @brief Holds out part of the training dataset for validation.
+ * 
+ * The training images are sorted and shuffled with the `VALIDATION_STREAM` random stream, then
+ * the last `validationSplit` fraction of them is moved from `TrainDatasetImages` to
+ * `ValidationDatasetImages`. The split only depends on the global seed (see `setGlobalSeed`),
+ * so it must be called once the seed is final: every training process then holds out the same
+ * images, and a run with the same `-Seed` holds them out again. It does nothing without a split
+ * or if the split was already made.
+ * 
+ * @param inputParams Reference to the Arguments structure holding the datasets and the split.
+ */
+void splitValidationSet(Arguments& inputParams);
+
+
 /**
  * @brief Converts an image to a pixel vector and extracts its label.
  * 
  * This function reads an image from the given file path, converts the image to grayscale, 
  * and then stores the pixel values as a vector of doubles in the `VectorLabel` structure. 
- * It also extracts the label from the image file name and generates a one-hot encoded 
- * label vector.
+ * It also extracts the label from the image file name.
  * 
- * The grayscale pixel values are converted to `double` precision and flattened into a 
- * one-dimensional vector, which is stored in `vecLabel.imagePixelVector`. The label 
- * is extracted from the image path and stored in `vecLabel.label`, and a one-hot 
- * encoded vector for the label is generated and stored in `vecLabel.labelVector`.
+ * The grayscale pixel values are normalised to [0, 1] and written straight into 
+ * `vecLabel.imagePixelVector` by `loadSample`, reusing its memory if it already holds an 
+ * image of the same size. The label is extracted from the image path and stored in 
+ * `vecLabel.label`.
  * 
- * @param vecLabel Reference to a `VectorLabel` structure that will store the pixel vector, 
- *        extracted label, and one-hot encoded label vector.
+ * @param vecLabel Reference to a `VectorLabel` structure that will store the pixel vector 
+ *        and the extracted label.
  * @param imagePath The file path to the image as a string. The label is extracted from the 
  *        image file name, assuming the label is a single digit just before the last underscore.
+ * @return true if the image was read, false otherwise.
  * 
  * @note The function assumes the image is in grayscale format and the label is part of the 
  *       image filename (e.g., "image_0_1.png" where 1 is the label).
@@ -210,7 +279,7 @@ int parser(Arguments& inputParams, int argc, char** inputToParse);
  * @warning The function uses OpenCV to load and process the image, so ensure OpenCV is 
  *          properly configured and linked in your project.
  */
-void imageToVectorAndLabel(VectorLabel& vecLabel, std::string imagePath);
+bool imageToVectorAndLabel(VectorLabel& vecLabel, const std::string& imagePath);
 
 
 /**
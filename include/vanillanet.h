@@ -0,0 +1,145 @@
+#ifndef VANILLANET_H
+#define VANILLANET_H
+
+/**
+ * @file vanillanet.h
+ * @brief C API of libvanillanet, to run a trained network inside another program.
+ *
+ * A model is created once from a checkpoint, then evaluated on batches of inputs held in
+ * buffers owned by the caller: the first layer reads the inputs and the last layer writes the
+ * outputs in place, without any copy. A model can be evaluated by several threads at the same
+ * time. The matrix products run on the thread pool of the library (see `vn_configure_threads`).
+ *
+ * Every function returning a `vn_status` reports its errors through it: no function throws or
+ * exits. The buffers are row-major, one sample per row.
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/** Version of the C API, increased whenever a function changes. */
+#define VANILLANET_API_VERSION 1
+
+
+/** A network loaded from a checkpoint. */
+typedef struct vn_model vn_model;
+
+
+/** The result of a call. */
+typedef enum vn_status
+{
+    VN_OK = 0,                  /**< Success. */
+    VN_ERROR_INVALID_ARGUMENT,  /**< A null pointer, an empty batch or an unknown value. */
+    VN_ERROR_CHECKPOINT,        /**< The checkpoint could not be read or does not describe a network. */
+    VN_ERROR_INTERNAL           /**< An unexpected failure (e.g. out of memory). */
+} vn_status;
+
+
+/** The activation applied to the output of the last layer. */
+typedef enum vn_activation
+{
+    VN_ACTIVATION_SOFTMAX = 0,  /**< Probabilities of a classifier (the networks trained by VanillaNet-cpp). */
+    VN_ACTIVATION_SIGMOID,      /**< Element-wise sigmoid. */
+    VN_ACTIVATION_TANH,         /**< Element-wise hyperbolic tangent. */
+    VN_ACTIVATION_RELU,         /**< Element-wise ReLU. */
+    VN_ACTIVATION_NONE          /**< The raw output of the last layer. */
+} vn_activation;
+
+
+/**
+ * @brief Loads a model from a checkpoint.
+ *
+ * The checkpoint is a JSON file of weights and biases as written by VanillaNet-cpp, or a PyTorch
+ * state_dict saved with `torch.save` (`.pt`/`.pth`), with the tensors `fc1.weight`, `fc1.bias`,
+ * `fc2.weight`, ... One fully connected layer is created per pair, with a ReLU between two
+ * consecutive layers and `output_activation` after the last one.
+ *
+ * @param checkpoint_path The path of the JSON or `.pt` checkpoint.
+ * @param output_activation The activation of the last layer.
+ * @param model Receives the model, to release with `vn_model_destroy`. Set to NULL on error.
+ * @return VN_OK, or the reason of the failure.
+ */
+vn_status vn_model_create(const char* checkpoint_path, vn_activation output_activation, vn_model** model);
+
+
+/**
+ * @brief Releases a model. Does nothing if `model` is NULL.
+ */
+void vn_model_destroy(vn_model* model);
+
+
+/**
+ * @brief Returns the number of inputs of each sample (0 if `model` is NULL).
+ */
+int vn_model_input_size(const vn_model* model);
+
+
+/**
+ * @brief Returns the number of outputs of each sample, with or without the output activation (0 if `model` is NULL).
+ */
+int vn_model_output_size(const vn_model* model);
+
+
+/**
+ * @brief Runs a batch through the whole network, output activation included.
+ *
+ * @param model The model.
+ * @param inputs Pointer to the inputs (batch_size x `vn_model_input_size`), e.g. pixels in [0, 1].
+ * @param batch_size The number of samples.
+ * @param outputs Pointer to the outputs (batch_size x `vn_model_output_size`).
+ * @return VN_OK, or the reason of the failure.
+ */
+vn_status vn_model_forward(vn_model* model, const double* inputs, size_t batch_size, double* outputs);
+
+
+/**
+ * @brief Runs a batch through the network without its output activation.
+ *
+ * @param model The model.
+ * @param inputs Pointer to the inputs (batch_size x `vn_model_input_size`).
+ * @param batch_size The number of samples.
+ * @param logits Pointer to the outputs of the last layer (batch_size x `vn_model_output_size`).
+ * @return VN_OK, or the reason of the failure.
+ */
+vn_status vn_model_logits(vn_model* model, const double* inputs, size_t batch_size, double* logits);
+
+
+/**
+ * @brief Runs a batch through the network and returns the index of the largest output of every sample.
+ *
+ * @param model The model.
+ * @param inputs Pointer to the inputs (batch_size x `vn_model_input_size`).
+ * @param batch_size The number of samples.
+ * @param labels Pointer to the predicted classes (batch_size values).
+ * @return VN_OK, or the reason of the failure.
+ */
+vn_status vn_model_predict(vn_model* model, const double* inputs, size_t batch_size, int* labels);
+
+
+/**
+ * @brief Sets the number of threads of the thread pool of the library.
+ *
+ * Only effective before the first model is created. By default the pool has one thread per
+ * hardware thread, 1 runs everything on the calling thread.
+ *
+ * @param threads The number of threads (0 for one per hardware thread).
+ * @return VN_OK, or VN_ERROR_INVALID_ARGUMENT if `threads` is negative.
+ */
+vn_status vn_configure_threads(int threads);
+
+
+/**
+ * @brief Returns a short English description of a status.
+ */
+const char* vn_status_string(vn_status status);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // VANILLANET_H
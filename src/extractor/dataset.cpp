@@ -0,0 +1,138 @@
+#include "dataset.hpp"
+
+#include <atomic>
+
+
+bool loadDataset(Dataset& dataset, const std::vector<std::string>& images)
+{
+    dataset.sampleSize = 0;
+    dataset.pixels.clear();
+    dataset.labels.assign(images.size(), 0);
+
+    if (images.empty())
+        return true;
+
+    // The first image gives the size of all the others
+    cv::Mat firstImage = cv::imread(images[0], cv::IMREAD_GRAYSCALE);
+    if (firstImage.empty())
+    {
+        printf("Error: Could not read the image: %s\n", images[0].c_str());
+        return false;
+    }
+
+    dataset.sampleSize = firstImage.total();
+    dataset.pixels.resize(images.size() * (size_t)dataset.sampleSize);
+
+    std::atomic<bool> failed(false);
+
+    threadPool().parallelFor(0, images.size(), 64, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end && !failed; i++)
+        {
+            cv::Mat inputImage = cv::imread(images[i], cv::IMREAD_GRAYSCALE);
+
+            if (inputImage.empty() || (int)inputImage.total() != dataset.sampleSize)
+            {
+                printf("Error: Could not read the image or its size does not match the dataset: %s\n", images[i].c_str());
+                failed = true;
+                return;
+            }
+
+            uint8_t* row = dataset.pixels.data() + i * (size_t)dataset.sampleSize;
+            std::copy(inputImage.begin<uint8_t>(), inputImage.end<uint8_t>(), row);
+
+            dataset.labels[i] = labelExtractor(images[i]);
+        }
+    });
+
+    if (failed)
+        return false;
+
+    replicateDataset(dataset);
+
+    return true;
+}
+
+
+void replicateDataset(Dataset& dataset)
+{
+    ThreadPool& pool = threadPool();
+    size_t nodes = numaTopology().size();
+
+    dataset.replicas.clear();
+    if (nodes <= 1 || pool.slotCpu(0) < 0 || dataset.pixels.empty())
+        return;
+
+    dataset.replicas.resize(nodes);
+    int localNode = currentNumaNode();
+    TaskGroup group;
+
+    for (size_t node = 0; node < nodes; node++)
+    {
+        if ((int)node == localNode)
+            continue;
+
+        // The first thread of the pool pinned on the node writes its copy
+        for (int slot = 0; slot < pool.size(); slot++)
+        {
+            if (numaNodeOfCpu(pool.slotCpu(slot)) != (int)node)
+                continue;
+
+            pool.submit(group, [&dataset, node]()
+            {
+                // new[] leaves the bytes untouched, so the pages are placed by the copy
+                std::unique_ptr<uint8_t[]> replica(new uint8_t[dataset.pixels.size()]);
+                std::copy(dataset.pixels.begin(), dataset.pixels.end(), replica.get());
+                dataset.replicas[node] = std::move(replica);
+            }, slot);
+            break;
+        }
+    }
+
+    pool.wait(group);
+}
+
+
+void normalizePixels(const uint8_t* pixels, size_t count, double* output)
+{
+    const double scale = 1.0 / 255.0;
+
+    for (size_t p = 0; p < count; p++)
+        output[p] = pixels[p] * scale;
+}
+
+
+bool loadSample(const std::string& imagePath, std::vector<double>& pixels, int& label)
+{
+    cv::Mat inputImage = cv::imread(imagePath, cv::IMREAD_GRAYSCALE);
+    if (inputImage.empty())
+    {
+        printf("Error: Could not read the image: %s\n", imagePath.c_str());
+        return false;
+    }
+
+    pixels.resize(inputImage.total());
+
+    if (inputImage.isContinuous())
+    {
+        normalizePixels(inputImage.ptr<uint8_t>(0), pixels.size(), pixels.data());
+    }
+    else
+    {
+        for (int r = 0; r < inputImage.rows; r++)
+            normalizePixels(inputImage.ptr<uint8_t>(r), inputImage.cols, pixels.data() + (size_t)r * inputImage.cols);
+    }
+
+    label = labelExtractor(imagePath);
+
+    return true;
+}
+
+
+void fillBatch(const Dataset& dataset, const uint32_t* indices, size_t count, std::vector<double>& inputs)
+{
+    inputs.resize(count * (size_t)dataset.sampleSize);
+
+    for (size_t n = 0; n < count; n++)
+        normalizePixels(dataset.sample(indices[n]), dataset.sampleSize, inputs.data() + n * (size_t)dataset.sampleSize);
+}
@@ -1,5 +1,7 @@
 #include "imageExtractor.hpp"
 
+#include <atomic>
+
 
 int datasetExtractor(const std::string& path)
 {
@@ -109,38 +111,46 @@ int importCSVDataset(const std::string& csvFilePath, const std::string& outputDi
 
 int csvToImages(const std::vector<std::vector<int>>& dataset, const std::string& outputDir) 
 {
-    int imageCounter = 0;
+    std::atomic<bool> failed(false);
 
-    // Process the dataset to create images
-    for (const auto& pixels : dataset)
+    // Process the dataset to create images, the image number is its line in the dataset
+    threadPool().parallelFor(0, dataset.size(), 64, [&](size_t begin, size_t end)
     {
-        // The first value is the label
-        int label = pixels[0];
-        
-        // The rest are pixel values (784 values for MNIST)
-        std::vector<int> pixelValues(pixels.begin() + 1, pixels.end());
-
-        // Create a 28x28 image from the pixel values
-        cv::Mat img(28, 28, CV_8UC1);
-        for (int i = 0; i < 28 * 28; ++i)
+        for (size_t imageCounter = begin; imageCounter < end && !failed; imageCounter++)
         {
-            img.at<uchar>(i / 28, i % 28) = static_cast<uchar>(pixelValues[i]);
-        }
+            const std::vector<int>& pixels = dataset[imageCounter];
+
+            // The first value is the label
+            int label = pixels[0];
+            
+            // The rest are pixel values (784 values for MNIST)
+            std::vector<int> pixelValues(pixels.begin() + 1, pixels.end());
+
+            // Create a 28x28 image from the pixel values
+            cv::Mat img(28, 28, CV_8UC1);
+            for (int i = 0; i < 28 * 28; ++i)
+            {
+                img.at<uchar>(i / 28, i % 28) = static_cast<uchar>(pixelValues[i]);
+            }
 
-        std::stringstream filename;
-        filename << outputDir << "/image_" << label << "_" << imageCounter++ << ".png";
-        // std::cout << "Saving image: " << filename.str() << std::endl;
+            std::stringstream filename;
+            filename << outputDir << "/image_" << label << "_" << imageCounter << ".png";
+            // std::cout << "Saving image: " << filename.str() << std::endl;
 
-        if (!cv::imwrite(filename.str(), img)) {
-            std::cerr << "Error: Could not save image: " << filename.str() << std::endl;
-            return -1;
+            if (!cv::imwrite(filename.str(), img)) {
+                std::cerr << "Error: Could not save image: " << filename.str() << std::endl;
+                failed = true;
+            }
         }
-    }
+    });
 
-    if (imageCounter == 0) {
+    if (failed)
+        return -1;
+
+    if (dataset.empty()) {
         std::cerr << "Error: No images were created." << std::endl;
         return -1;
     }
 
-    return imageCounter;
-}
\ No newline at end of file
+    return dataset.size();
+}
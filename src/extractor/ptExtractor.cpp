@@ -0,0 +1,693 @@
+#include "ptExtractor.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+// Signatures of the zip records
+static constexpr uint32_t ZIP_END_OF_CENTRAL_DIRECTORY = 0x06054b50;
+static constexpr uint32_t ZIP_CENTRAL_DIRECTORY_HEADER = 0x02014b50;
+static constexpr uint32_t ZIP_LOCAL_FILE_HEADER = 0x04034b50;
+
+
+static uint16_t read16(const uint8_t* p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+
+static uint32_t read32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+
+static uint64_t read64(const uint8_t* p)
+{
+    return (uint64_t)read32(p) | ((uint64_t)read32(p + 4) << 32);
+}
+
+
+/**
+ * An entry of the zip archive, stored without compression.
+ */
+struct ZipEntry
+{
+    std::string name;
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+};
+
+
+/**
+ * Lists the entries of a zip archive from its central directory.
+ */
+static bool readZipEntries(const uint8_t* file, size_t size, std::vector<ZipEntry>& entries, std::string& reason)
+{
+    // The end of central directory record is at most 64KB (its comment) before the end
+    if (size < 22)
+        return false;
+
+    size_t end = size - 22;
+    size_t lowest = end > 0xFFFF ? end - 0xFFFF : 0;
+    while (read32(file + end) != ZIP_END_OF_CENTRAL_DIRECTORY)
+    {
+        if (end == lowest)
+            return false;
+        end--;
+    }
+
+    uint16_t count = read16(file + end + 10);
+    uint32_t directorySize = read32(file + end + 12);
+    uint32_t directoryOffset = read32(file + end + 16);
+
+    if (count == 0xFFFF || directorySize == 0xFFFFFFFF || directoryOffset == 0xFFFFFFFF)
+    {
+        reason += "Error: Zip64 archives (checkpoints over 4GB) are not supported.\n";
+        return false;
+    }
+    if ((size_t)directoryOffset + directorySize > size)
+        return false;
+
+    const uint8_t* record = file + directoryOffset;
+    const uint8_t* directoryEnd = record + directorySize;
+
+    for (uint16_t i = 0; i < count; i++)
+    {
+        if (record + 46 > directoryEnd || read32(record) != ZIP_CENTRAL_DIRECTORY_HEADER)
+            return false;
+
+        uint16_t method = read16(record + 10);
+        uint32_t compressedSize = read32(record + 20);
+        uint32_t uncompressedSize = read32(record + 24);
+        uint16_t nameLength = read16(record + 28);
+        uint16_t extraLength = read16(record + 30);
+        uint16_t commentLength = read16(record + 32);
+        uint32_t localOffset = read32(record + 42);
+
+        ZipEntry entry;
+        entry.name.assign(reinterpret_cast<const char*>(record + 46), nameLength);
+        record += 46 + nameLength + extraLength + commentLength;
+
+        if (method != 0 || compressedSize != uncompressedSize)
+        {
+            reason += "Error: The entry " + entry.name + " is compressed, only stored entries are supported.\n";
+            return false;
+        }
+
+        // The data follows the local header, whose extra field may differ from the central one
+        const uint8_t* local = file + localOffset;
+        if ((size_t)localOffset + 30 > size || read32(local) != ZIP_LOCAL_FILE_HEADER)
+            return false;
+
+        size_t dataOffset = (size_t)localOffset + 30 + read16(local + 26) + read16(local + 28);
+        if (dataOffset + uncompressedSize > size)
+            return false;
+
+        entry.data = file + dataOffset;
+        entry.size = uncompressedSize;
+        entries.push_back(entry);
+    }
+
+    return true;
+}
+
+
+/**
+ * A value of the pickle of a state_dict. Only the values torch.save writes for a dictionary of
+ * tensors are represented, anything else becomes an opaque OBJECT.
+ */
+struct PickleValue
+{
+    enum class Kind { NONE, BOOL, INT, FLOAT, STRING, TUPLE, LIST, DICT, GLOBAL, STORAGE, TENSOR, OBJECT };
+
+    Kind kind = Kind::NONE;
+    int64_t integer = 0;
+    double number = 0.0;
+    std::string text;                                 // STRING, GLOBAL ("module name"), STORAGE (key)
+    std::vector<std::shared_ptr<PickleValue>> items;  // TUPLE, LIST, DICT (key, value, key, value, ...)
+
+    PtScalarType type = PtScalarType::INVALID;        // STORAGE, TENSOR
+    std::vector<int64_t> shape;                       // TENSOR
+    std::vector<int64_t> stride;                      // TENSOR
+    int64_t offset = 0;                               // TENSOR, in elements
+    std::string storage;                              // TENSOR, key of the storage
+};
+
+using PickleRef = std::shared_ptr<PickleValue>;
+
+
+static PickleRef makeValue(PickleValue::Kind kind)
+{
+    PickleRef value = std::make_shared<PickleValue>();
+    value->kind = kind;
+    return value;
+}
+
+
+static PtScalarType storageType(const std::string& global)
+{
+    if (global == "torch FloatStorage")    return PtScalarType::FLOAT32;
+    if (global == "torch DoubleStorage")   return PtScalarType::FLOAT64;
+    if (global == "torch HalfStorage")     return PtScalarType::FLOAT16;
+    if (global == "torch BFloat16Storage") return PtScalarType::BFLOAT16;
+    return PtScalarType::INVALID;
+}
+
+
+static size_t scalarSize(PtScalarType type)
+{
+    switch (type)
+    {
+        case PtScalarType::FLOAT64: return 8;
+        case PtScalarType::FLOAT32: return 4;
+        case PtScalarType::FLOAT16:
+        case PtScalarType::BFLOAT16: return 2;
+        default: return 0;
+    }
+}
+
+
+/**
+ * The subset of the pickle virtual machine (protocols 2 to 4) used by torch.save.
+ */
+class Unpickler
+{
+    public:
+
+        Unpickler(const uint8_t* data, size_t size) : position(data), end(data + size) {}
+
+        std::string reason;                           // The errors met, one "Error: ..." line each
+
+        PickleRef run()
+        {
+            while (position < end)
+            {
+                uint8_t opcode = *position++;
+
+                switch (opcode)
+                {
+                    case 0x80: skip(1); break;                              // PROTO
+                    case 0x95: skip(8); break;                              // FRAME
+                    case '(': marks.push_back(stack.size()); break;         // MARK
+                    case ')': push(makeValue(PickleValue::Kind::TUPLE)); break;
+                    case ']': push(makeValue(PickleValue::Kind::LIST)); break;
+                    case '}': push(makeValue(PickleValue::Kind::DICT)); break;
+                    case 'N': push(makeValue(PickleValue::Kind::NONE)); break;
+                    case 0x88: push(boolean(true)); break;                  // NEWTRUE
+                    case 0x89: push(boolean(false)); break;                 // NEWFALSE
+                    case 'J': push(integer((int32_t)read32(take(4)))); break;
+                    case 'K': push(integer(*take(1))); break;
+                    case 'M': push(integer(read16(take(2)))); break;
+                    case 0x8a: push(longInteger(*take(1))); break;          // LONG1
+                    case 'G': push(binaryFloat()); break;
+                    case 'X': push(string(read32(take(4)))); break;         // BINUNICODE
+                    case 0x8c: push(string(*take(1))); break;               // SHORT_BINUNICODE
+                    case 0x8d: push(string(read64(take(8)))); break;        // BINUNICODE8
+                    case 'T': push(string(read32(take(4)))); break;         // BINSTRING
+                    case 'U': push(string(*take(1))); break;                // SHORT_BINSTRING
+                    case 'c': push(global()); break;
+                    case 0x93: push(stackGlobal()); break;
+                    case 'q': memo[*take(1)] = top(); break;                // BINPUT
+                    case 'r': memo[read32(take(4))] = top(); break;         // LONG_BINPUT
+                    case 0x94: memo[memo.size()] = top(); break;            // MEMOIZE
+                    case 'h': push(memoGet(*take(1))); break;               // BINGET
+                    case 'j': push(memoGet(read32(take(4)))); break;        // LONG_BINGET
+                    case 't': push(tuple(popMark())); break;
+                    case 0x85: push(tuple(popCount(1))); break;             // TUPLE1
+                    case 0x86: push(tuple(popCount(2))); break;             // TUPLE2
+                    case 0x87: push(tuple(popCount(3))); break;             // TUPLE3
+                    case 'Q': push(persistentLoad(pop())); break;           // BINPERSID
+                    case 'R': { PickleRef args = pop(); push(reduce(pop(), args)); break; }
+                    case 0x81: { pop(); pop(); push(makeValue(PickleValue::Kind::OBJECT)); break; } // NEWOBJ
+                    case 's': { PickleRef value = pop(); PickleRef key = pop(); addItems(top(), { key, value }); break; }
+                    case 'u': { std::vector<PickleRef> items = popMark(); addItems(top(), items); break; }
+                    case 'a': { PickleRef value = pop(); addItems(top(), { value }); break; }
+                    case 'e': { std::vector<PickleRef> items = popMark(); addItems(top(), items); break; }
+                    case 'b': pop(); break;                                 // BUILD: the state of the object is not needed
+                    case '.': return failed ? nullptr : pop();              // STOP
+
+                    default:
+                    {
+                        char message[64];
+                        snprintf(message, sizeof(message), "Error: Unsupported pickle opcode 0x%02x in the checkpoint.\n", opcode);
+                        reason += message;
+                        return nullptr;
+                    }
+                }
+
+                if (failed)
+                    return nullptr;
+            }
+
+            return nullptr;
+        }
+
+    private:
+
+        const uint8_t* take(size_t count)
+        {
+            static const uint8_t zeros[8] = {};
+            if ((size_t)(end - position) < count)
+            {
+                failed = true;
+                position = end;
+                return zeros;
+            }
+
+            const uint8_t* data = position;
+            position += count;
+            return data;
+        }
+
+        void skip(size_t count) { take(count); }
+
+        void push(PickleRef value) { stack.push_back(std::move(value)); }
+
+        PickleRef pop()
+        {
+            if (stack.empty() || (!marks.empty() && stack.size() <= marks.back()))
+            {
+                failed = true;
+                return makeValue(PickleValue::Kind::NONE);
+            }
+
+            PickleRef value = stack.back();
+            stack.pop_back();
+            return value;
+        }
+
+        PickleRef top()
+        {
+            if (stack.empty())
+            {
+                failed = true;
+                stack.push_back(makeValue(PickleValue::Kind::NONE));
+            }
+            return stack.back();
+        }
+
+        std::vector<PickleRef> popMark()
+        {
+            if (marks.empty())
+            {
+                failed = true;
+                return {};
+            }
+
+            size_t mark = marks.back();
+            marks.pop_back();
+            std::vector<PickleRef> items(stack.begin() + mark, stack.end());
+            stack.resize(mark);
+            return items;
+        }
+
+        std::vector<PickleRef> popCount(size_t count)
+        {
+            std::vector<PickleRef> items(count);
+            for (size_t i = count; i > 0; i--)
+                items[i - 1] = pop();
+            return items;
+        }
+
+        PickleRef memoGet(uint32_t index)
+        {
+            auto found = memo.find(index);
+            if (found == memo.end())
+            {
+                failed = true;
+                return makeValue(PickleValue::Kind::NONE);
+            }
+            return found->second;
+        }
+
+        PickleRef boolean(bool value)
+        {
+            PickleRef result = makeValue(PickleValue::Kind::BOOL);
+            result->integer = value;
+            return result;
+        }
+
+        PickleRef integer(int64_t value)
+        {
+            PickleRef result = makeValue(PickleValue::Kind::INT);
+            result->integer = value;
+            return result;
+        }
+
+        PickleRef longInteger(size_t bytes)
+        {
+            const uint8_t* data = take(bytes);
+            int64_t value = 0;
+            for (size_t i = 0; i < bytes && i < 8; i++)
+                value |= (int64_t)data[i] << (8 * i);
+
+            // Sign extension of a little-endian two's complement number
+            if (bytes > 0 && bytes < 8 && (data[bytes - 1] & 0x80))
+                value -= (int64_t)1 << (8 * bytes);
+
+            return integer(value);
+        }
+
+        PickleRef binaryFloat()
+        {
+            // Big-endian IEEE 754 double
+            const uint8_t* data = take(8);
+            uint64_t bits = 0;
+            for (int i = 0; i < 8; i++)
+                bits = (bits << 8) | data[i];
+
+            PickleRef result = makeValue(PickleValue::Kind::FLOAT);
+            memcpy(&result->number, &bits, sizeof(bits));
+            return result;
+        }
+
+        PickleRef string(uint64_t length)
+        {
+            const uint8_t* data = take(length);
+            PickleRef result = makeValue(PickleValue::Kind::STRING);
+            if (!failed)
+                result->text.assign(reinterpret_cast<const char*>(data), length);
+            return result;
+        }
+
+        std::string line()
+        {
+            const uint8_t* start = position;
+            while (position < end && *position != '\n')
+                position++;
+
+            std::string text(reinterpret_cast<const char*>(start), position - start);
+            if (position < end)
+                position++;
+            else
+                failed = true;
+            return text;
+        }
+
+        PickleRef global()
+        {
+            std::string module = line();
+            std::string name = line();
+
+            PickleRef result = makeValue(PickleValue::Kind::GLOBAL);
+            result->text = module + " " + name;
+            return result;
+        }
+
+        PickleRef stackGlobal()
+        {
+            PickleRef name = pop();
+            PickleRef module = pop();
+
+            PickleRef result = makeValue(PickleValue::Kind::GLOBAL);
+            result->text = module->text + " " + name->text;
+            return result;
+        }
+
+        PickleRef tuple(std::vector<PickleRef> items)
+        {
+            PickleRef result = makeValue(PickleValue::Kind::TUPLE);
+            result->items = std::move(items);
+            return result;
+        }
+
+        void addItems(PickleRef container, const std::vector<PickleRef>& items)
+        {
+            if (container->kind == PickleValue::Kind::DICT || container->kind == PickleValue::Kind::LIST)
+                container->items.insert(container->items.end(), items.begin(), items.end());
+        }
+
+        /**
+         * ('storage', storage type, key, location, number of elements)
+         */
+        PickleRef persistentLoad(PickleRef id)
+        {
+            if (id->kind != PickleValue::Kind::TUPLE || id->items.size() < 3 || id->items[0]->text != "storage")
+            {
+                reason += "Error: Unsupported persistent object in the checkpoint.\n";
+                failed = true;
+                return makeValue(PickleValue::Kind::NONE);
+            }
+
+            PickleRef result = makeValue(PickleValue::Kind::STORAGE);
+            result->type = storageType(id->items[1]->text);
+            result->text = id->items[2]->text;
+            return result;
+        }
+
+        PickleRef reduce(PickleRef callable, PickleRef args)
+        {
+            const std::string& name = callable->text;
+            const std::vector<PickleRef>& items = args->items;
+
+            if (name == "collections OrderedDict" || name == "builtins dict")
+                return makeValue(PickleValue::Kind::DICT);
+
+            // A parameter saved on its own wraps its tensor
+            if ((name == "torch._utils _rebuild_parameter" || name == "torch._utils _rebuild_parameter_with_state") && !items.empty())
+                return items[0];
+
+            // _rebuild_tensor_v2(storage, storage offset, size, stride, requires_grad, backward hooks, ...)
+            if ((name == "torch._utils _rebuild_tensor_v2" || name == "torch._utils _rebuild_tensor") && items.size() >= 4 &&
+                items[0]->kind == PickleValue::Kind::STORAGE)
+            {
+                PickleRef tensor = makeValue(PickleValue::Kind::TENSOR);
+                tensor->type = items[0]->type;
+                tensor->storage = items[0]->text;
+                tensor->offset = items[1]->integer;
+                for (const PickleRef& size : items[2]->items)
+                    tensor->shape.push_back(size->integer);
+                for (const PickleRef& stride : items[3]->items)
+                    tensor->stride.push_back(stride->integer);
+                return tensor;
+            }
+
+            return makeValue(PickleValue::Kind::OBJECT);
+        }
+
+        const uint8_t* position;
+        const uint8_t* end;
+        bool failed = false;
+        std::vector<PickleRef> stack;
+        std::vector<size_t> marks;
+        std::unordered_map<uint32_t, PickleRef> memo;
+};
+
+
+PtStateDict::~PtStateDict()
+{
+    release();
+}
+
+
+void PtStateDict::release()
+{
+    if (mapping != nullptr)
+        munmap(mapping, mappedSize);
+
+    mapping = nullptr;
+    mappedSize = 0;
+    entries.clear();
+}
+
+
+bool PtStateDict::load(const std::string& path, std::string* error)
+{
+    release();
+
+    // The errors are printed, or handed to the caller when it asks for them
+    std::string reason;
+    auto fail = [&](const std::string& message) {
+        reason += message;
+        release();
+        if (error != nullptr)
+            *error = reason;
+        else
+            printf("%s", reason.c_str());
+        return false;
+    };
+
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+        if (fd >= 0)
+            close(fd);
+        return fail("Error: Could not read the checkpoint: " + path + "\n");
+    }
+
+    mappedSize = info.st_size;
+    mapping = mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (mapping == MAP_FAILED)
+    {
+        mapping = nullptr;
+        return fail("Error: Could not map the checkpoint: " + path + "\n");
+    }
+
+    const uint8_t* file = static_cast<const uint8_t*>(mapping);
+
+    std::vector<ZipEntry> archive;
+    if (!readZipEntries(file, mappedSize, archive, reason))
+        return fail("Error: " + path + " is not a PyTorch zip checkpoint (saved with torch.save).\n");
+
+    // Every entry is under a folder named after the archive: "<name>/data.pkl", "<name>/data/0", ...
+    std::unordered_map<std::string, const ZipEntry*> byName;
+    const ZipEntry* pickle = nullptr;
+    std::string prefix;
+
+    for (const ZipEntry& entry : archive)
+    {
+        byName[entry.name] = &entry;
+        if (entry.name.size() >= 8 && entry.name.compare(entry.name.size() - 8, 8, "data.pkl") == 0)
+        {
+            pickle = &entry;
+            prefix = entry.name.substr(0, entry.name.size() - 8);
+        }
+    }
+
+    uint16_t probe = 1;
+    bool littleEndianHost = *reinterpret_cast<uint8_t*>(&probe) == 1;
+    auto byteorder = byName.find(prefix + "byteorder");
+    bool littleEndianFile = byteorder == byName.end() || std::string(reinterpret_cast<const char*>(byteorder->second->data), byteorder->second->size) == "little";
+
+    if (pickle == nullptr || !littleEndianHost || !littleEndianFile)
+        return fail("Error: " + path + " has no state_dict in the byte order of this machine.\n");
+
+    Unpickler unpickler(pickle->data, pickle->size);
+    PickleRef root = unpickler.run();
+    if (root == nullptr || root->kind != PickleValue::Kind::DICT)
+    {
+        reason += unpickler.reason;
+        return fail("Error: " + path + " does not hold a state_dict (save model.state_dict(), not the model).\n");
+    }
+
+    for (size_t i = 0; i + 1 < root->items.size(); i += 2)
+    {
+        const PickleRef& key = root->items[i];
+        const PickleRef& value = root->items[i + 1];
+        if (key->kind != PickleValue::Kind::STRING || value->kind != PickleValue::Kind::TENSOR)
+            continue;
+
+        PtTensor tensor;
+        tensor.name = key->text;
+        tensor.type = value->type;
+        tensor.shape = value->shape;
+        tensor.elements = 1;
+
+        // Only contiguous row-major tensors are read in place
+        int64_t expectedStride = 1;
+        bool contiguous = value->stride.size() == value->shape.size();
+        for (size_t d = value->shape.size(); d > 0 && contiguous; d--)
+        {
+            contiguous = value->shape[d - 1] == 1 || value->stride[d - 1] == expectedStride;
+            expectedStride *= value->shape[d - 1];
+        }
+        for (int64_t size : value->shape)
+            tensor.elements *= (size_t)size;
+
+        auto storage = byName.find(prefix + "data/" + value->storage);
+        size_t elementSize = scalarSize(tensor.type);
+
+        if (elementSize == 0 || !contiguous || storage == byName.end() || value->offset < 0 ||
+            ((size_t)value->offset + tensor.elements) * elementSize > storage->second->size)
+            return fail("Error: The tensor " + tensor.name + " of " + path + " is not a contiguous floating-point tensor.\n");
+
+        tensor.data = storage->second->data + (size_t)value->offset * elementSize;
+        entries.push_back(tensor);
+    }
+
+    return true;
+}
+
+
+const PtTensor* PtStateDict::find(const std::string& name) const
+{
+    for (const PtTensor& tensor : entries)
+    {
+        if (tensor.name == name)
+            return &tensor;
+    }
+
+    return nullptr;
+}
+
+
+/**
+ * IEEE 754 half precision to single precision.
+ */
+static float halfToFloat(uint16_t half)
+{
+    uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FF;
+
+    if (exponent == 0)
+    {
+        // Zero or subnormal: mantissa x 2^-24
+        float value = std::ldexp((float)mantissa, -24);
+        return sign ? -value : value;
+    }
+
+    uint32_t bits = exponent == 0x1F ? sign | 0x7F800000 | (mantissa << 13)
+                                     : sign | ((exponent + 112) << 23) | (mantissa << 13);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+
+void ptTensorToDouble(const PtTensor& tensor, double* output)
+{
+    // The storages are aligned in the archive, memcpy keeps the reads valid if they are not
+    switch (tensor.type)
+    {
+        case PtScalarType::FLOAT64:
+            memcpy(output, tensor.data, tensor.elements * sizeof(double));
+            break;
+
+        case PtScalarType::FLOAT32:
+            for (size_t i = 0; i < tensor.elements; i++)
+            {
+                float value;
+                memcpy(&value, tensor.data + i * sizeof(float), sizeof(float));
+                output[i] = value;
+            }
+            break;
+
+        case PtScalarType::FLOAT16:
+            for (size_t i = 0; i < tensor.elements; i++)
+                output[i] = halfToFloat(read16(tensor.data + 2 * i));
+            break;
+
+        case PtScalarType::BFLOAT16:
+            for (size_t i = 0; i < tensor.elements; i++)
+            {
+                uint32_t bits = (uint32_t)read16(tensor.data + 2 * i) << 16;
+                float value;
+                memcpy(&value, &bits, sizeof(value));
+                output[i] = value;
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+bool isPtCheckpoint(const std::string& path)
+{
+    std::string extension = std::filesystem::path(path).extension().string();
+    return extension == ".pt" || extension == ".pth";
+}
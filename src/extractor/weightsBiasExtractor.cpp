@@ -1,44 +1,74 @@
 #include "weightsBiasExtractor.hpp"
 
 
-std::vector<BiasesWeights> parseJSON(const std::string& jsonString)
+/**
+ * Appends the numbers of a JSON value, nested arrays included, in row-major order.
+ */
+static void flattenJson(const nlohmann::json& value, std::vector<double>& values)
+{
+    if (!value.is_array())
+    {
+        values.push_back(value.get<double>());
+        return;
+    }
+
+    for (const nlohmann::json& element : value)
+        flattenJson(element, values);
+}
+
+
+std::vector<BiasesWeights> parseJSON(const std::string& jsonString, std::string* error)
 {
     std::vector<BiasesWeights> importedWeightsAndBiases;
 
+    // The errors go to the standard error, or to the caller when it asks for them
+    auto fail = [&](const std::string& message) {
+        if (error != nullptr)
+            *error = message;
+        else
+            std::cerr << message << std::endl;
+        return std::vector<BiasesWeights>();
+    };
+
     std::ifstream file(jsonString);
 
-    if (!file.is_open()) {
-        std::cerr << "Failed to open the file." << std::endl;
-        return {};
-    }
+    if (!file.is_open())
+        return fail("Failed to open the file.");
 
     nlohmann::json data = nlohmann::json::parse(file);
     file.close();
 
-    for (size_t i = 1; i <= data.size() / 2; i++)
+    // The convolution layers (conv1, conv2, ...) then the fully connected ones (fc1, fc2, ...)
+    for (const std::string prefix : { "conv", "fc" })
     {
-        BiasesWeights bw;
-        bw.BiasName = "fc" + std::to_string(i) + ".bias";
-        bw.WeightsName = "fc" + std::to_string(i) + ".weight";
+        for (int i = 1; data.contains(prefix + std::to_string(i) + ".weight"); i++)
+        {
+            BiasesWeights bw;
+            bw.LayerIndex = i;
+            bw.BiasName = prefix + std::to_string(i) + ".bias";
+            bw.WeightsName = prefix + std::to_string(i) + ".weight";
+
+            if (!data.contains(bw.BiasName))
+                return fail("The key does not exist.");
 
-        if (data.contains(bw.BiasName) && data.contains(bw.WeightsName)) {
             // Extract bias and weight values
-            std::vector<double> bias_vector = data[bw.BiasName].get<std::vector<double>>();
-            std::vector<std::vector<double>> weight_matrix = data[bw.WeightsName].get<std::vector<std::vector<double>>>();
+            bw.biases = data[bw.BiasName].get<std::vector<double>>();
 
-            // Assign the extracted values to the structure fields
-            bw.biases = bias_vector;
-            bw.weights = weight_matrix;
-        }
-        else {
-            std::cerr << "The key does not exist." << std::endl;
-            return {};
-        }
+            // One row per neuron or filter, a filter exported by PyTorch is nested (channels x kernel x kernel)
+            for (const nlohmann::json& row : data[bw.WeightsName])
+            {
+                bw.weights.emplace_back();
+                flattenJson(row, bw.weights.back());
+            }
 
-        // Add the BiasesWeights instance to the vector
-        importedWeightsAndBiases.push_back(bw);
+            // Add the BiasesWeights instance to the vector
+            importedWeightsAndBiases.push_back(bw);
+        }
     }
 
+    if (importedWeightsAndBiases.empty() || importedWeightsAndBiases.size() * 2 != data.size())
+        return fail("The key does not exist.");
+
     return importedWeightsAndBiases;
 }
 
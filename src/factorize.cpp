@@ -0,0 +1,212 @@
+#include "factorize.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "test.hpp"
+#include "saveToJson.hpp"
+#include "benchmark.hpp"
+
+
+/**
+ * Rank chosen for one fully connected layer.
+ */
+struct LayerFactorization
+{
+    size_t index = 0;
+    std::string name;
+    int inputSize = 0;
+    int outputSize = 0;
+    int rank = 0;
+    double accuracy = 0.0;
+    SingularValueDecomposition svd;
+};
+
+
+/**
+ * Accuracy and speed of a network on the validation images, accuracy and loss on the testing images.
+ */
+struct FactorizationResult
+{
+    std::string layout;
+    size_t parameters = 0;
+    double accuracy = 0.0;
+    double testAccuracy = 0.0;
+    double testLoss = 0.0;
+    double sampleUs = 0.0;
+    double batchUs = 0.0;
+};
+
+
+/**
+ * Returns the accuracy of the network on the dataset, in percent, and optionally its mean loss.
+ */
+static double datasetAccuracy(Network& net, const Dataset& dataset, double* loss = nullptr)
+{
+    std::vector<TestResult> tested = evaluateDataset(net, dataset);
+    double correct = 0.0;
+    double totalLoss = 0.0;
+    for (const TestResult& sample : tested)
+    {
+        correct += sample.trueValue == sample.predictedValue;
+        totalLoss += sample.loss;
+    }
+
+    size_t count = std::max<size_t>(tested.size(), 1);
+    if (loss != nullptr)
+        *loss = totalLoss / count;
+    return 100.0 * correct / count;
+}
+
+
+/**
+ * Measures the network on the validation and on the testing images.
+ */
+static FactorizationResult measureNetwork(Network& net, const Dataset& validation, const Dataset& test, const std::vector<double>& timing, int samples)
+{
+    FactorizationResult result;
+    result.layout = networkLayout(net);
+    for (const std::shared_ptr<Layer>& layer : net.Layers)
+        result.parameters += layer->weights.size() + layer->biases.size();
+
+    result.accuracy = datasetAccuracy(net, validation);
+    result.testAccuracy = datasetAccuracy(net, test, &result.testLoss);
+    result.sampleUs = forwardLatencyUs(net, timing, samples, 1);
+    result.batchUs = forwardLatencyUs(net, timing, samples, TEST_BATCH_SIZE);
+    return result;
+}
+
+
+int networkFactorize(Network &net, Arguments &inputParams)
+{
+    // The ranks are chosen on images held out of the training dataset, the testing images only report the result
+    splitValidationSet(inputParams);
+
+    Dataset dataset, test;
+    if (!loadDataset(dataset, inputParams.ValidationDatasetImages) || !loadDataset(test, inputParams.TestDatasetImages))
+        return 1;
+
+    int samples = std::min(dataset.size(), TIMING_SAMPLES);
+    std::vector<uint32_t> indices(samples);
+    std::iota(indices.begin(), indices.end(), 0);
+    std::vector<double> timing;
+    fillBatch(dataset, indices.data(), samples, timing);
+
+    FactorizationResult original = measureNetwork(net, dataset, test, timing, samples);
+    double target = original.accuracy - inputParams.factorizeBudget;
+
+    std::vector<LayerFactorization> layers;
+    for (size_t i = 0; i < net.Layers.size(); i++)
+    {
+        if (net.Layers[i]->getType() != LayerType::StandardLayer)
+            continue;
+
+        LayerFactorization layer;
+        layer.index = i;
+        layer.name = net.parameterName(i);
+        layer.inputSize = net.Layers[i]->inputSize;
+        layer.outputSize = net.Layers[i]->outputSize;
+        layers.push_back(layer);
+    }
+
+    // The layers are factorised one after the other, each one seeing the approximations of the previous ones
+    double accuracy = original.accuracy;
+    for (LayerFactorization& layer : layers)
+    {
+        std::vector<double>& weights = net.Layers[layer.index]->weights;
+
+        // Largest rank that saves enough multiply-adds to pay for the extra layer
+        int maxRank = (int)(MAX_FACTORISED_COST * layerMultiplyAdds(layer.inputSize, layer.outputSize) / (layer.inputSize + layer.outputSize));
+        maxRank = std::min(maxRank, std::min(layer.inputSize, layer.outputSize));
+
+        if (maxRank >= 1)
+        {
+            std::vector<double> dense = weights;
+            layer.svd = jacobiSVD(dense.data(), layer.outputSize, layer.inputSize);
+
+            auto accuracyAtRank = [&](int rank) {
+                lowRankApproximation(layer.svd, rank, weights.data());
+                net.Layers[layer.index]->transposeWeights();
+                return datasetAccuracy(net, dataset);
+            };
+
+            // The accuracy grows with the rank: bisection on the smallest rank within the budget
+            if (accuracyAtRank(maxRank) >= target)
+            {
+                int low = 1, high = maxRank;
+                while (low < high)
+                {
+                    int middle = (low + high) / 2;
+                    if (accuracyAtRank(middle) >= target)
+                        high = middle;
+                    else
+                        low = middle + 1;
+                }
+                layer.rank = high;
+                accuracy = accuracyAtRank(high);
+            }
+            else
+            {
+                weights = dense;
+                net.Layers[layer.index]->transposeWeights();
+            }
+        }
+
+        layer.accuracy = accuracy;
+    }
+
+    // From the last layer, so the positions of the layers still to split do not move
+    for (auto layer = layers.rbegin(); layer != layers.rend(); ++layer)
+    {
+        if (layer->rank > 0 && !factorizeLayer(net, layer->index, layer->svd, layer->rank))
+        {
+            printf("[ERROR]: Could not factorise the layer %s.\n", layer->name.c_str());
+            return 1;
+        }
+    }
+
+    bool factorized = std::any_of(layers.begin(), layers.end(), [](const LayerFactorization& layer) { return layer.rank > 0; });
+    FactorizationResult result = measureNetwork(net, dataset, test, timing, samples);
+    std::string checkpoint = factorized ? WeightsBiasesToJSON(net) : "";
+
+    printf("\n");
+    printCentered(" LOW-RANK FACTORISATION ", '*');
+    printf("\n");
+    printf("- Accuracy budget:             %g percentage points of validation accuracy (at least %.2f%%)\n", inputParams.factorizeBudget, std::max(0.0, target));
+    std::cout << "- Validation images:           " << dataset.size() << " (" << samples << " to time)" << std::endl;
+    std::cout << "- Testing images:              " << test.size() << "\n" << std::endl;
+
+    printf("%6s  %-12s %6s %14s %14s %10s\n", "Layer", "Shape", "Rank", "Mult-adds", "Factorised", "Val. acc.");
+    std::string ranks;
+    for (const LayerFactorization& layer : layers)
+    {
+        std::string shape = std::to_string(layer.inputSize) + "x" + std::to_string(layer.outputSize);
+        std::string rank = layer.rank > 0 ? std::to_string(layer.rank) : "-";
+        printf("%6s  %-12s %6s %14zu %14zu %9.2f%%\n", layer.name.c_str(), shape.c_str(), rank.c_str(),
+               layerMultiplyAdds(layer.inputSize, layer.outputSize), layerMultiplyAdds(layer.inputSize, layer.outputSize, layer.rank), layer.accuracy);
+        ranks += (ranks.empty() ? "" : ",") + std::to_string(layer.rank);
+    }
+
+    std::string batchHeader = "us/image (" + std::to_string(TEST_BATCH_SIZE) + ")";
+    printf("\n%-11s %-16s %10s %10s %10s %10s %12s %12s %8s\n", "Network", "Layers", "Params", "Val. acc.", "Test acc.", "Test loss",
+           "us/image (1)", batchHeader.c_str(), "Speedup");
+    printf("%-11s %-16s %10zu %9.2f%% %9.2f%% %10.5f %12.3f %12.3f %8s\n", "Original", original.layout.c_str(), original.parameters,
+           original.accuracy, original.testAccuracy, original.testLoss, original.sampleUs, original.batchUs, "-");
+    printf("%-11s %-16s %10zu %9.2f%% %9.2f%% %10.5f %12.3f %12.3f %7.2fx\n", "Factorised", result.layout.c_str(), result.parameters,
+           result.accuracy, result.testAccuracy, result.testLoss, result.sampleUs, result.batchUs, result.sampleUs > 0.0 ? original.sampleUs / result.sampleUs : 0.0);
+
+    printf("\n");
+    if (factorized)
+    {
+        std::cout << "- Checkpoint:                  " << checkpoint << std::endl;
+        std::cout << "- Load it with:                -Ranks " << ranks << std::endl;
+    }
+    else
+        std::cout << "- No layer can be factorised within the budget, the network is unchanged." << std::endl;
+
+    printf("\n");
+    printHorizontalLine('*');
+
+    return 0;
+}
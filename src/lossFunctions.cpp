@@ -1,108 +1,82 @@
 #include "lossFunctions.hpp"
 
 
-double mse_loss(const std::vector<double>& yTrue, const std::vector<double>& yPredicted)
+double sparse_mse_loss(int label, const double* yPredicted, size_t classes)
 {
-    assert(yTrue.size() == yPredicted.size());
+    assert(label >= 0 && (size_t)label < classes);
     double totalSum = 0.0;
 
-    for (size_t i = 0; i < yTrue.size(); i++)
-        totalSum += pow(yTrue[i] - yPredicted[i], 2);
+    for (size_t i = 0; i < classes; i++)
+    {
+        double difference = ((int)i == label ? 1.0 : 0.0) - yPredicted[i];
+        totalSum += difference * difference;
+    }
 
-    return totalSum / yTrue.size();
+    return totalSum / classes;
 }
 
 
-std::vector<double> mse_loss_prime(const std::vector<double>& yTrue, const std::vector<double>& yPredicted)
+void sparse_mse_loss_prime(int label, const double* yPredicted, size_t classes, double* gradient)
 {
-    assert(yTrue.size() == yPredicted.size());
-    std::vector<double> gradient;
-    int n = yTrue.size();
-    
-    for (int i = 0; i < n; i++)
-    {
-        // Derivative of MSE with respect to each predicted value
-        double grad = (2.0 / n) * (yPredicted[i] - yTrue[i]);
-        gradient.push_back(grad);
-    }
-    
-    return gradient;
+    assert(label >= 0 && (size_t)label < classes);
+    const double scale = 2.0 / classes;
+
+    for (size_t i = 0; i < classes; i++)
+        gradient[i] = scale * yPredicted[i];
+
+    gradient[label] = scale * (yPredicted[label] - 1.0);
 }
 
 
-double squared_error_loss(const std::vector<double>& yTrue, const std::vector<double>& yPredicted)
+double sparse_squared_error_loss(int label, const double* yPredicted, size_t classes)
 {
-    assert(yTrue.size() == yPredicted.size());
+    assert(label >= 0 && (size_t)label < classes);
     double loss = 0.0;
-    
-    for (size_t i = 0; i < yTrue.size(); ++i)
-        // Squared Error: L = (yTrue - yPredicted)^2
-        loss += pow(yTrue[i] - yPredicted[i], 2);
-    
+
+    for (size_t i = 0; i < classes; i++)
+    {
+        double difference = ((int)i == label ? 1.0 : 0.0) - yPredicted[i];
+        loss += difference * difference;
+    }
+
     return loss;
 }
 
 
-std::vector<double> squared_error_loss_prime(const std::vector<double>& yTrue, const std::vector<double>& yPredicted)
+void sparse_squared_error_loss_prime(int label, const double* yPredicted, size_t classes, double* gradient)
 {
-    assert(yTrue.size() == yPredicted.size());
-    std::vector<double> derivative(yTrue.size());
-    
-    for (size_t i = 0; i < yTrue.size(); ++i)
-        // Derivative: dL/dy_pred = 2 * (yPredicted - yTrue)
-        derivative[i] = 2 * (yPredicted[i] - yTrue[i]);
-    
-    return derivative;
+    assert(label >= 0 && (size_t)label < classes);
+
+    for (size_t i = 0; i < classes; i++)
+        gradient[i] = 2 * yPredicted[i];
+
+    gradient[label] = 2 * (yPredicted[label] - 1.0);
 }
 
 
-double binary_cross_entropy_loss(const std::vector<double>& yTrue, const std::vector<double>& yPredicted)
+double sparse_binary_cross_entropy_loss(int label, const double* yPredicted, size_t classes)
 {
-    assert(yTrue.size() == yPredicted.size());
+    assert(label >= 0 && (size_t)label < classes);
     double loss = 0.0;
     const double epsilon = 1e-12; // Small value to prevent log(0)
-    
-    for (size_t i = 0; i < yTrue.size(); ++i)
+
+    for (size_t i = 0; i < classes; i++)
     {
         // Clamping the predictions to prevent log(0)
         double yPred = std::min(std::max(yPredicted[i], epsilon), 1.0 - epsilon);
-        loss += yTrue[i] * log(yPred) + (1 - yTrue[i]) * log(1 - yPred);
+        loss += (int)i == label ? log(yPred) : log(1 - yPred);
     }
-    
-    return -loss;
-}
-
 
-std::vector<double> binary_cross_entropy_loss_prime(const std::vector<double>& yTrue, const std::vector<double>& yPredicted)
-{
-    assert(yTrue.size() == yPredicted.size());
-    std::vector<double> derivative(yTrue.size());
-    
-    for (size_t i = 0; i < yTrue.size(); ++i)
-        // Derivative: dL/dy_pred = y_pred - y_true
-        derivative[i] = yPredicted[i] - yTrue[i];
-    
-    return derivative;
+    return -loss;
 }
 
 
-LossFunctionPrime select_LossFunction_prime(LossFunction lossFunction)
+void sparse_binary_cross_entropy_loss_prime(int label, const double* yPredicted, size_t classes, double* gradient)
 {
-    switch (lossFunction)
-    {
-        case LossFunction::MEAN_SQUARED_ERROR:
-            return LossFunctionPrime::MEAN_SQUARED_ERROR_PRIME;
+    assert(label >= 0 && (size_t)label < classes);
 
-        case LossFunction::SQUARED_ERROR:
-            return LossFunctionPrime::SQUARED_ERROR_PRIME;
-        
-        case LossFunction::CROSS_ENTROPY:
-            return LossFunctionPrime::CROSS_ENTROPY_PRIME;
-        
-        default:
-            printf("[WARNING]: Loss function not supported. Returning INVALID loss function prime.\n");
-            return LossFunctionPrime::INVALID;
-    }
+    std::copy(yPredicted, yPredicted + classes, gradient);
+    gradient[label] = yPredicted[label] - 1.0;
 }
 
 
@@ -37,7 +37,13 @@
 #include "weightsBiasExtractor.hpp"
 #include "train.hpp"
 #include "test.hpp"
+#include "serve.hpp"
+#include "prune.hpp"
+#include "factorize.hpp"
+#include "cppExporter.hpp"
 #include "printer.hpp"
+#include "benchmark.hpp"
+#include "random.hpp"
 
 
 int main(int argc, char **argv)
@@ -46,22 +52,66 @@ int main(int argc, char **argv)
     int res = parser(inputParams, argc, argv);
     if (res != 0) return res;
 
+    // Every random draw (initial weights, validation split, shuffling) derives from the seed
+    setGlobalSeed(inputParams.seed);
+
     Network net;
-    net.addLayer(Layer(784, 128));
-    net.addLayer(ActivationLayer(ActivationType::RELU));
-    net.addLayer(Layer(128, 10));
-    net.addLayer(ActivationLayer(ActivationType::SOFTMAX));
+    buildNetwork(net, inputParams.architecture, inputParams.initialization, inputParams.hiddenSize, inputParams.layerRanks);
 
     net.addLossFunction(LossFunction::CROSS_ENTROPY);
+    net.addOptimizer(inputParams.optimizer);
+
+    // The server keeps the standard output for its responses (it loads the GEMM tiling itself)
+    if (!inputParams.serve)
+    {
+        infoPrinter(inputParams, net);
+        loadGemmTiling(stdout);
+    }
+
+    // The weights are read from a JSON file or natively from a PyTorch .pt file
+    if (inputParams.hasWeightsBiases && !net.importCheckpoint(inputParams.WeightsBiasesPath))
+        return 1;
+
+    // PRUNE: the smallest weights are removed and the layers switch to the sparse kernels
+    if (inputParams.pruneSparsity > 0.0)
+    {
+        net.prune(inputParams.pruneSparsity);
+        if (!inputParams.serve)
+            sparsityPrinter(net);
+    }
+
+    // QUANTIZE: binary or ternary weights, packed into bit-planes and trained with the straight-through estimator
+    if (inputParams.quantization != WeightQuantization::NONE)
+    {
+        net.quantize(inputParams.quantization);
+        if (!inputParams.serve)
+            quantizationPrinter(net);
+    }
 
-    infoPrinter(inputParams, net);
+    // PRUNE NEURONS: smaller dense networks, with their accuracy and latency
+    if (!inputParams.pruneNeuronLevels.empty())
+        return networkPruneNeurons(net, inputParams);
 
-    std::vector<BiasesWeights> importedWeightsAndBiases;
-    weightsBiasExtractor(inputParams, importedWeightsAndBiases);
-    net.importWeightsBiases(importedWeightsAndBiases);
+    // FACTORIZE: every layer becomes two thinner layers, as long as the accuracy stays within the budget
+    if (inputParams.factorizeBudget >= 0.0)
+        return networkFactorize(net, inputParams);
+
+    // EXPORT: the network and its weights become a standalone C++ source
+    if (!inputParams.exportCppPath.empty())
+        return exportNetworkToCpp(net, inputParams.exportCppPath, inputParams.WeightsBiasesPath);
+
+    // SERVE: the network stays loaded and answers requests until it is stopped
+    if (inputParams.serve)
+        return networkServe(net, inputParams);
+
+    // Launch the other training processes (-Processes) and give them the same initial weights
+    if (startTrainingProcesses(net, inputParams, argc, argv) != 0) return 1;
 
     // TRAIN
-    networkTrain(net, inputParams);
+    if (networkTrain(net, inputParams) != 0) return 1;
+
+    // Only the process started by the user goes on after the training
+    if (inputParams.rank > 0) return 0;
 
     // std::vector<std::string> jsonFiles = getJsonFiles("./Resources/output/weights/09_14_24/");
     // ./Resources/output/weights/09_14_24/fc128_ReLU_fc10_Softmax_09_14_24_23_26_55.json
@@ -70,5 +120,10 @@ int main(int argc, char **argv)
     // TEST
     networkTest(net, inputParams);
 
+    // BENCHMARK
+    inferenceBenchmark(net, inputParams);
+    if (inputParams.Test)
+        quantizationReport(net, inputParams);
+
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,135 @@
+#include "metrics.hpp"
+
+
+void ClassificationMetrics::reset(int classes, bool trackConfusion)
+{
+    this->classes = classes;
+    samples = 0;
+    correct = 0;
+    lossSum = 0.0;
+
+    if (trackConfusion)
+        confusion.assign((size_t)classes * classes, 0);
+    else
+        confusion.clear();
+}
+
+
+void ClassificationMetrics::merge(const ClassificationMetrics& other)
+{
+    samples += other.samples;
+    correct += other.correct;
+    lossSum += other.lossSum;
+
+    if (confusion.size() == other.confusion.size())
+    {
+        for (size_t i = 0; i < confusion.size(); i++)
+            confusion[i] += other.confusion[i];
+    }
+}
+
+
+double ClassificationMetrics::accuracy() const
+{
+    return samples > 0 ? 100.0 * ((double)correct / samples) : 0.0;
+}
+
+
+double ClassificationMetrics::classAccuracy(int label) const
+{
+    if (confusion.empty())
+        return 0.0;
+
+    const int* row = confusion.data() + (size_t)label * classes;
+    int total = 0;
+    for (int c = 0; c < classes; c++)
+        total += row[c];
+
+    return total > 0 ? 100.0 * ((double)row[label] / total) : 0.0;
+}
+
+
+/**
+ * One row of the output block: returns the loss of the sample and sets its predicted class.
+ * The loss and its derivative come from the sparse loss functions.
+ */
+template <LossFunction Loss, bool WithGradient>
+static double evaluateRow(const double* y, int label, size_t classes, double* gradient, int& predicted)
+{
+    predicted = (int)(std::max_element(y, y + classes) - y);
+
+    if (Loss == LossFunction::CROSS_ENTROPY)
+    {
+        if (WithGradient)
+            sparse_binary_cross_entropy_loss_prime(label, y, classes, gradient);
+        return sparse_binary_cross_entropy_loss(label, y, classes);
+    }
+
+    if (Loss == LossFunction::MEAN_SQUARED_ERROR)
+    {
+        if (WithGradient)
+            sparse_mse_loss_prime(label, y, classes, gradient);
+        return sparse_mse_loss(label, y, classes);
+    }
+
+    if (WithGradient)
+        sparse_squared_error_loss_prime(label, y, classes, gradient);
+    return sparse_squared_error_loss(label, y, classes);
+}
+
+
+template <LossFunction Loss, bool WithGradient>
+static void evaluateRows(const double* outputs, const int* labels, size_t batchSize, size_t classes,
+                         ClassificationMetrics& metrics, double* losses, int* predictions, double* gradients)
+{
+    bool trackConfusion = !metrics.confusion.empty();
+
+    for (size_t n = 0; n < batchSize; n++)
+    {
+        int predicted;
+        double loss = evaluateRow<Loss, WithGradient>(outputs + n * classes, labels[n], classes, WithGradient ? gradients + n * classes : nullptr, predicted);
+
+        metrics.lossSum += loss;
+        metrics.correct += (predicted == labels[n]);
+        if (trackConfusion)
+            metrics.confusion[(size_t)labels[n] * metrics.classes + predicted]++;
+
+        if (losses != nullptr)
+            losses[n] = loss;
+        if (predictions != nullptr)
+            predictions[n] = predicted;
+    }
+
+    metrics.samples += batchSize;
+}
+
+
+template <LossFunction Loss>
+static void evaluateRows(const double* outputs, const int* labels, size_t batchSize, size_t classes,
+                         ClassificationMetrics& metrics, double* losses, int* predictions, double* gradients)
+{
+    if (gradients != nullptr)
+        evaluateRows<Loss, true>(outputs, labels, batchSize, classes, metrics, losses, predictions, gradients);
+    else
+        evaluateRows<Loss, false>(outputs, labels, batchSize, classes, metrics, losses, predictions, gradients);
+}
+
+
+void evaluateBatch(LossFunction lossFunction, const double* outputs, const int* labels, size_t batchSize, size_t classes,
+                   ClassificationMetrics& metrics, double* losses, int* predictions, double* gradients)
+{
+    switch (lossFunction)
+    {
+        case LossFunction::MEAN_SQUARED_ERROR:
+            evaluateRows<LossFunction::MEAN_SQUARED_ERROR>(outputs, labels, batchSize, classes, metrics, losses, predictions, gradients);
+            break;
+
+        case LossFunction::SQUARED_ERROR:
+            evaluateRows<LossFunction::SQUARED_ERROR>(outputs, labels, batchSize, classes, metrics, losses, predictions, gradients);
+            break;
+
+        default:
+            evaluateRows<LossFunction::CROSS_ENTROPY>(outputs, labels, batchSize, classes, metrics, losses, predictions, gradients);
+            break;
+    }
+}
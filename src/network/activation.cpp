@@ -4,6 +4,13 @@
 
 
 std::vector<double> Activation(ActivationType activationFunction, std::vector<double> inputs)
+{
+    Activation(activationFunction, inputs.data(), inputs.data(), inputs.size());
+    return inputs;
+}
+
+
+void Activation(ActivationType activationFunction, const double* inputs, double* outputs, size_t size)
 {
     double Z = 0.0;
     double D = 0.0;
@@ -12,13 +19,13 @@ std::vector<double> Activation(ActivationType activationFunction, std::vector<do
     {
         case ActivationType::SOFTMAX:
         {
-            auto max_it = std::max_element(inputs.begin(), inputs.end());
+            auto max_it = std::max_element(inputs, inputs + size);
 
             // Check if the vector is not empty
-            if (max_it != inputs.end())
+            if (max_it != inputs + size)
                 D = -*max_it;
 
-            for (size_t j = 0; j < inputs.size(); j++)
+            for (size_t j = 0; j < size; j++)
                 Z += std::exp(inputs[j]+D);
             break;
         }
@@ -27,39 +34,39 @@ std::vector<double> Activation(ActivationType activationFunction, std::vector<do
             break;
     }
 
-    for (size_t i = 0; i < inputs.size(); i++)
+    for (size_t i = 0; i < size; i++)
     {
         switch (activationFunction)
         {
             case ActivationType::SIGMOID:
-                inputs[i] = 1 / (1 + std::exp(-inputs[i]));
+                outputs[i] = 1 / (1 + std::exp(-inputs[i]));
                 break;
             
             case ActivationType::SIGMOID_PRIME:
-                inputs[i] = inputs[i] * (1 - inputs[i]);
+                outputs[i] = inputs[i] * (1 - inputs[i]);
                 break;
                 
             case ActivationType::RELU:
-                inputs[i] = std::max(0.0, inputs[i]);
+                outputs[i] = std::max(0.0, inputs[i]);
                 break;
             
             case ActivationType::RELU_PRIME:
-                if (inputs[i] > 0.00) inputs[i] = 1.0;
-                else inputs[i] = 0.0;
+                if (inputs[i] > 0.00) outputs[i] = 1.0;
+                else outputs[i] = 0.0;
                 break;
                 
             case ActivationType::TANH:
-                inputs[i] = std::tanh(inputs[i]);
+                outputs[i] = std::tanh(inputs[i]);
                 break;
             
             case ActivationType::TANH_PRIME:
-                inputs[i] = 1 - std::pow(std::tanh(inputs[i]), 2);
+                outputs[i] = 1 - std::pow(std::tanh(inputs[i]), 2);
                 break;
                 
             case ActivationType::SOFTMAX:
                 // Stable version of the softmax function
                 // https://eli.thegreenplace.net/2016/the-softmax-function-and-its-derivative/
-                inputs[i] = std::exp(inputs[i] + D) / Z;
+                outputs[i] = std::exp(inputs[i] + D) / Z;
                 break;
             
             // case ActivationType::SOFTMAX_PRIME:
@@ -67,12 +74,11 @@ std::vector<double> Activation(ActivationType activationFunction, std::vector<do
             // https://alexcpn.github.io/html/NN/ml/8_backpropogation_full/
                 
             default:
+                outputs[i] = inputs[i];
                 break;
         }
         
     }
-
-    return inputs;
 }
 
 
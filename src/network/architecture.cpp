@@ -0,0 +1,89 @@
+#include "architecture.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+#include "network.hpp"
+
+
+/**
+ * Random stream of the next layer with parameters: its position among those of the network.
+ */
+static uint64_t nextStream(const Network& net)
+{
+    return net.standardLayerCount + net.convolutionLayerCount;
+}
+
+
+/**
+ * Adds the `index`-th fully connected layer of an architecture, as two thinner layers when it has a rank.
+ */
+static void addFullyConnected(Network& net, int inputSize, int outputSize, InitializationType initialization, const std::vector<int>& ranks, size_t index)
+{
+    int rank = index < ranks.size() ? ranks[index] : 0;
+    if (rank > 0)
+    {
+        net.addLayer(Layer(inputSize, rank, initialization, nextStream(net)));
+        net.addLayer(Layer(rank, outputSize, initialization, nextStream(net)));
+        return;
+    }
+
+    net.addLayer(Layer(inputSize, outputSize, initialization, nextStream(net)));
+}
+
+
+void buildNetwork(Network& net, NetworkArchitecture architecture, InitializationType initialization, int hiddenSize, const std::vector<int>& ranks)
+{
+    if (architecture == NetworkArchitecture::CNN)
+    {
+        Conv2DLayer conv1({ 1, 28, 28 }, 4, 3, 1, 1, initialization, nextStream(net));
+        net.addLayer(conv1);
+        net.addLayer(ActivationLayer(ActivationType::RELU));
+
+        MaxPool2DLayer pool1(conv1.outputShape, 2);
+        net.addLayer(pool1);
+
+        Conv2DLayer conv2(pool1.outputShape, 8, 3, 1, 1, initialization, nextStream(net));
+        net.addLayer(conv2);
+        net.addLayer(ActivationLayer(ActivationType::RELU));
+
+        MaxPool2DLayer pool2(conv2.outputShape, 2);
+        net.addLayer(pool2);
+        addFullyConnected(net, pool2.outputShape.size(), 10, initialization, ranks, 0);
+        net.addLayer(ActivationLayer(ActivationType::SOFTMAX));
+        return;
+    }
+
+    addFullyConnected(net, 784, hiddenSize, initialization, ranks, 0);
+    net.addLayer(ActivationLayer(ActivationType::RELU));
+    addFullyConnected(net, hiddenSize, 10, initialization, ranks, 1);
+    net.addLayer(ActivationLayer(ActivationType::SOFTMAX));
+}
+
+
+std::string NetworkArchitectureToString(NetworkArchitecture architecture)
+{
+    switch (architecture)
+    {
+        case NetworkArchitecture::MLP:
+            return "Fully Connected (FC)";
+
+        case NetworkArchitecture::CNN:
+            return "Convolutional (CNN)";
+
+        default:
+            return "None";
+    }
+}
+
+
+NetworkArchitecture stringToNetworkArchitecture(const std::string& name)
+{
+    std::string lower = name;
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+
+    if (lower == "mlp" || lower == "fc") return NetworkArchitecture::MLP;
+    if (lower == "cnn" || lower == "conv") return NetworkArchitecture::CNN;
+
+    return NetworkArchitecture::INVALID;
+}
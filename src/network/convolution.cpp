@@ -0,0 +1,251 @@
+#include "convolution.hpp"
+
+#include <algorithm>
+
+
+Conv2DLayer::Conv2DLayer(ImageShape inputShape, int filters, int kernelSize, int stride, int padding, InitializationType initialization, uint64_t stream)
+    : Layer(inputShape.channels * kernelSize * kernelSize, filters, initialization, stream)
+{
+    this->inputShape = inputShape;
+    this->kernelSize = kernelSize;
+    this->stride = stride;
+    this->padding = padding;
+
+    outputShape.channels = filters;
+    outputShape.height = stride > 0 ? (inputShape.height + 2 * padding - kernelSize) / stride + 1 : 0;
+    outputShape.width = stride > 0 ? (inputShape.width + 2 * padding - kernelSize) / stride + 1 : 0;
+
+    if (inputShape.size() <= 0 || filters <= 0 || kernelSize <= 0 || padding < 0 || outputShape.height <= 0 || outputShape.width <= 0)
+    {
+        printf("[ERROR]: A %dx%d convolution with stride %d and padding %d does not fit a %dx%dx%d input.\n",
+               kernelSize, kernelSize, stride, padding, inputShape.channels, inputShape.height, inputShape.width);
+        exit(1);
+    }
+}
+
+
+void Conv2DLayer::im2col(const double* inputs, int batchSize, double* patches) const
+{
+    for (int n = 0; n < batchSize; n++)
+    {
+        const double* image = inputs + (size_t)n * inputShape.size();
+
+        for (int oy = 0; oy < outputShape.height; oy++)
+        {
+            for (int ox = 0; ox < outputShape.width; ox++)
+            {
+                for (int c = 0; c < inputShape.channels; c++)
+                {
+                    const double* channel = image + (size_t)c * inputShape.height * inputShape.width;
+
+                    for (int ky = 0; ky < kernelSize; ky++)
+                    {
+                        int y = oy * stride - padding + ky;
+                        bool rowInside = y >= 0 && y < inputShape.height;
+
+                        for (int kx = 0; kx < kernelSize; kx++)
+                        {
+                            int x = ox * stride - padding + kx;
+                            *patches++ = (rowInside && x >= 0 && x < inputShape.width) ? channel[y * inputShape.width + x] : 0.0;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+void Conv2DLayer::col2im(const double* patches, int batchSize, double* inputs) const
+{
+    for (int n = 0; n < batchSize; n++)
+    {
+        double* image = inputs + (size_t)n * inputShape.size();
+
+        for (int oy = 0; oy < outputShape.height; oy++)
+        {
+            for (int ox = 0; ox < outputShape.width; ox++)
+            {
+                for (int c = 0; c < inputShape.channels; c++)
+                {
+                    double* channel = image + (size_t)c * inputShape.height * inputShape.width;
+
+                    for (int ky = 0; ky < kernelSize; ky++)
+                    {
+                        int y = oy * stride - padding + ky;
+                        bool rowInside = y >= 0 && y < inputShape.height;
+
+                        for (int kx = 0; kx < kernelSize; kx++, patches++)
+                        {
+                            int x = ox * stride - padding + kx;
+                            if (rowInside && x >= 0 && x < inputShape.width)
+                                channel[y * inputShape.width + x] += *patches;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+void Conv2DLayer::forwardBatch(const double* inputs, int inputWidth, double* outputs, int batchSize) const
+{
+    (void)inputWidth;
+
+    // Reused by every batch of the thread, the layer itself stays untouched
+    thread_local std::vector<double> patches;
+    thread_local std::vector<double> products;
+
+    int positions = outputShape.height * outputShape.width;
+    int rows = batchSize * positions;
+
+    patches.resize((size_t)rows * inputSize);
+    products.resize((size_t)rows * outputSize);
+
+    // products = patches x Wᵀ + biases, one row per position: the product of a dense layer
+    im2col(inputs, batchSize, patches.data());
+    Layer::forwardBatch(patches.data(), inputSize, products.data(), rows);
+
+    // (position x filter) -> (filter x position) for every sample
+    for (int n = 0; n < batchSize; n++)
+    {
+        const double* sample = products.data() + (size_t)n * positions * outputSize;
+        double* output = outputs + (size_t)n * outputShape.size();
+
+        for (int p = 0; p < positions; p++)
+        {
+            for (int f = 0; f < outputSize; f++)
+                output[(size_t)f * positions + p] = sample[(size_t)p * outputSize + f];
+        }
+    }
+}
+
+
+void Conv2DLayer::backwardBatch(const std::vector<double>& inputs, const std::vector<double>& outputs, const std::vector<double>& error,
+                                std::vector<double>& inputError, LayerGradients& gradients, int batchSize, bool computeInputError) const
+{
+    (void)outputs;
+
+    thread_local std::vector<double> patches;
+    thread_local std::vector<double> patchError;
+    thread_local std::vector<double> rowError;
+
+    int positions = outputShape.height * outputShape.width;
+    int rows = batchSize * positions;
+
+    patches.resize((size_t)rows * inputSize);
+    rowError.resize((size_t)rows * outputSize);
+
+    // The patches are lowered again rather than kept from the forward pass
+    im2col(inputs.data(), batchSize, patches.data());
+
+    // (filter x position) -> (position x filter) for every sample
+    for (int n = 0; n < batchSize; n++)
+    {
+        const double* sample = error.data() + (size_t)n * outputShape.size();
+        double* row = rowError.data() + (size_t)n * positions * outputSize;
+
+        for (int p = 0; p < positions; p++)
+        {
+            for (int f = 0; f < outputSize; f++)
+                row[(size_t)p * outputSize + f] = sample[(size_t)f * positions + p];
+        }
+    }
+
+    // gradients.weights = rowErrorᵀ x patches, gradients.biases = Σ rowError, patchError = rowError x W
+    Layer::backwardBatch(patches, rowError, rowError, patchError, gradients, rows, computeInputError);
+
+    if (!computeInputError)
+        return;
+
+    inputError.assign((size_t)batchSize * inputShape.size(), 0.0);
+    col2im(patchError.data(), batchSize, inputError.data());
+}
+
+
+MaxPool2DLayer::MaxPool2DLayer(ImageShape inputShape, int poolSize, int stride) : Layer(0, 0)
+{
+    this->inputShape = inputShape;
+    this->poolSize = poolSize;
+    this->stride = stride > 0 ? stride : poolSize;
+
+    outputShape.channels = inputShape.channels;
+    outputShape.height = poolSize > 0 ? (inputShape.height - poolSize) / this->stride + 1 : 0;
+    outputShape.width = poolSize > 0 ? (inputShape.width - poolSize) / this->stride + 1 : 0;
+
+    if (inputShape.size() <= 0 || poolSize <= 0 || poolSize > inputShape.height || poolSize > inputShape.width)
+    {
+        printf("[ERROR]: A %dx%d max pooling does not fit a %dx%dx%d input.\n",
+               poolSize, poolSize, inputShape.channels, inputShape.height, inputShape.width);
+        exit(1);
+    }
+}
+
+
+int MaxPool2DLayer::windowMaximum(const double* sample, int channel, int y, int x) const
+{
+    int best = (channel * inputShape.height + y * stride) * inputShape.width + x * stride;
+
+    for (int py = 0; py < poolSize; py++)
+    {
+        int row = (channel * inputShape.height + y * stride + py) * inputShape.width + x * stride;
+        for (int px = 0; px < poolSize; px++)
+        {
+            if (sample[row + px] > sample[best])
+                best = row + px;
+        }
+    }
+
+    return best;
+}
+
+
+void MaxPool2DLayer::forwardBatch(const double* inputs, int inputWidth, double* outputs, int batchSize) const
+{
+    (void)inputWidth;
+
+    for (int n = 0; n < batchSize; n++)
+    {
+        const double* sample = inputs + (size_t)n * inputShape.size();
+
+        for (int c = 0; c < outputShape.channels; c++)
+        {
+            for (int y = 0; y < outputShape.height; y++)
+            {
+                for (int x = 0; x < outputShape.width; x++)
+                    *outputs++ = sample[windowMaximum(sample, c, y, x)];
+            }
+        }
+    }
+}
+
+
+void MaxPool2DLayer::backwardBatch(const std::vector<double>& inputs, const std::vector<double>& outputs, const std::vector<double>& error,
+                                   std::vector<double>& inputError, LayerGradients& gradients, int batchSize, bool computeInputError) const
+{
+    // Marking the unused parameters to avoid compiler warnings
+    (void)outputs;
+    (void)gradients;
+
+    if (!computeInputError)
+        return;
+
+    inputError.assign((size_t)batchSize * inputShape.size(), 0.0);
+    const double* windowError = error.data();
+
+    for (int n = 0; n < batchSize; n++)
+    {
+        const double* sample = inputs.data() + (size_t)n * inputShape.size();
+        double* sampleError = inputError.data() + (size_t)n * inputShape.size();
+
+        for (int c = 0; c < outputShape.channels; c++)
+        {
+            for (int y = 0; y < outputShape.height; y++)
+            {
+                for (int x = 0; x < outputShape.width; x++)
+                    sampleError[windowMaximum(sample, c, y, x)] += *windowError++;
+            }
+        }
+    }
+}
@@ -0,0 +1,377 @@
+#include "gemm.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <unistd.h>
+
+#include <nlohmann/json.hpp>
+
+#ifdef VANILLANET_USE_CBLAS
+#include <cblas.h>
+#endif
+
+#include "toolkit.hpp"
+
+
+// Register tile of the micro-kernel: MR rows of A times NR columns of B
+static constexpr int MR = 4;
+static constexpr int NR = 8;
+
+// Below this amount of multiply-adds the packing costs more than it saves
+static constexpr long DIRECT_GEMM_LIMIT = 32 * 32 * 32;
+
+// Side of the tiles copied by `transpose`
+static constexpr int TRANSPOSE_TILE = 8;
+
+
+static inline double elementA(bool transA, const double* A, int lda, int i, int p)
+{
+    return transA ? A[(size_t)p * lda + i] : A[(size_t)i * lda + p];
+}
+
+
+static inline double elementB(bool transB, const double* B, int ldb, int p, int j)
+{
+    return transB ? B[(size_t)j * ldb + p] : B[(size_t)p * ldb + j];
+}
+
+
+/**
+ * Direct product for small problems, without packing. The loop order keeps the innermost
+ * loop on contiguous memory for every transposition, and a forward pass on a single sample
+ * (transB) reduces to one dot product per neuron, as in the original per-neuron code.
+ */
+static void directGemm(bool transA, bool transB, int M, int N, int K,
+                       double alpha, const double* A, int lda, const double* B, int ldb,
+                       double* C, int ldc)
+{
+    for (int i = 0; i < M; i++)
+    {
+        double* c = C + (size_t)i * ldc;
+
+        if (transB && !transA)
+        {
+            const double* a = A + (size_t)i * lda;
+            for (int j = 0; j < N; j++)
+            {
+                const double* b = B + (size_t)j * ldb;
+                double sum = 0.0;
+
+                for (int p = 0; p < K; p++)
+                    sum += a[p] * b[p];
+
+                c[j] += alpha * sum;
+            }
+        }
+        else
+        {
+            for (int p = 0; p < K; p++)
+            {
+                double a = alpha * elementA(transA, A, lda, i, p);
+                for (int j = 0; j < N; j++)
+                    c[j] += a * elementB(transB, B, ldb, p, j);
+            }
+        }
+    }
+}
+
+
+/**
+ * Packs a mc x kc block of op(A) in slivers of MR rows. Inside a sliver the MR values of a
+ * column are contiguous, which is the order the micro-kernel reads them. Rows past the edge
+ * are padded with zeros.
+ */
+static void packA(bool transA, const double* A, int lda, int row0, int col0, int mc, int kc, double* packed)
+{
+    for (int s = 0; s < mc; s += MR)
+    {
+        for (int p = 0; p < kc; p++)
+        {
+            for (int r = 0; r < MR; r++)
+                *packed++ = (s + r < mc) ? elementA(transA, A, lda, row0 + s + r, col0 + p) : 0.0;
+        }
+    }
+}
+
+
+/**
+ * Packs a kc x nc panel of op(B) in slivers of NR columns. Inside a sliver the NR values of a
+ * row are contiguous. Columns past the edge are padded with zeros.
+ */
+static void packB(bool transB, const double* B, int ldb, int row0, int col0, int kc, int nc, double* packed)
+{
+    for (int s = 0; s < nc; s += NR)
+    {
+        for (int p = 0; p < kc; p++)
+        {
+            for (int c = 0; c < NR; c++)
+                *packed++ = (s + c < nc) ? elementB(transB, B, ldb, row0 + p, col0 + s + c) : 0.0;
+        }
+    }
+}
+
+
+/**
+ * Computes a MR x NR tile of C from a packed sliver of A and a packed sliver of B. The
+ * accumulator has a fixed size so the compiler keeps it in vector registers.
+ */
+static inline void microKernel(int kc, const double* a, const double* b, double alpha,
+                               double* C, int ldc, int mr, int nr)
+{
+    double acc[MR][NR] = {};
+
+    for (int p = 0; p < kc; p++)
+    {
+        for (int r = 0; r < MR; r++)
+        {
+            const double ar = a[r];
+            for (int c = 0; c < NR; c++)
+                acc[r][c] += ar * b[c];
+        }
+        a += MR;
+        b += NR;
+    }
+
+    for (int r = 0; r < mr; r++)
+    {
+        double* c = C + (size_t)r * ldc;
+        for (int j = 0; j < nr; j++)
+            c[j] += alpha * acc[r][j];
+    }
+}
+
+
+static void blockedGemm(const GemmTiling& tiling, bool transA, bool transB, int M, int N, int K,
+                        double alpha, const double* A, int lda, const double* B, int ldb,
+                        double* C, int ldc)
+{
+    int mcMax = ((tiling.mc + MR - 1) / MR) * MR;
+    int ncMax = ((tiling.nc + NR - 1) / NR) * NR;
+
+    // Reused between calls to avoid an allocation per product
+    thread_local std::vector<double> packedA;
+    thread_local std::vector<double> packedB;
+    packedA.resize((size_t)mcMax * tiling.kc);
+    packedB.resize((size_t)ncMax * tiling.kc);
+
+    for (int jc = 0; jc < N; jc += ncMax)
+    {
+        int nc = std::min(ncMax, N - jc);
+
+        for (int pc = 0; pc < K; pc += tiling.kc)
+        {
+            int kc = std::min(tiling.kc, K - pc);
+            packB(transB, B, ldb, pc, jc, kc, nc, packedB.data());
+
+            for (int ic = 0; ic < M; ic += mcMax)
+            {
+                int mc = std::min(mcMax, M - ic);
+                packA(transA, A, lda, ic, pc, mc, kc, packedA.data());
+
+                for (int jr = 0; jr < nc; jr += NR)
+                {
+                    const double* b = packedB.data() + (size_t)jr * kc;
+
+                    for (int ir = 0; ir < mc; ir += MR)
+                    {
+                        const double* a = packedA.data() + (size_t)ir * kc;
+                        double* c = C + (size_t)(ic + ir) * ldc + jc + jr;
+                        microKernel(kc, a, b, alpha, c, ldc, std::min(MR, mc - ir), std::min(NR, nc - jr));
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+void gemm(bool transA, bool transB, int M, int N, int K,
+          double alpha, const double* A, int lda, const double* B, int ldb,
+          double beta, double* C, int ldc)
+{
+    if (M <= 0 || N <= 0)
+        return;
+
+#ifdef VANILLANET_USE_CBLAS
+    if (K > 0)
+    {
+        cblas_dgemm(CblasRowMajor, transA ? CblasTrans : CblasNoTrans, transB ? CblasTrans : CblasNoTrans,
+                    M, N, K, alpha, A, lda, B, ldb, beta, C, ldc);
+        return;
+    }
+#endif
+
+    for (int i = 0; i < M; i++)
+    {
+        double* c = C + (size_t)i * ldc;
+        if (beta == 0.0)
+            std::fill(c, c + N, 0.0);
+        else if (beta != 1.0)
+            for (int j = 0; j < N; j++)
+                c[j] *= beta;
+    }
+
+    if (K <= 0 || alpha == 0.0)
+        return;
+
+    if (M == 1 || N == 1 || (long)M * N * K < DIRECT_GEMM_LIMIT)
+        directGemm(transA, transB, M, N, K, alpha, A, lda, B, ldb, C, ldc);
+    else
+        blockedGemm(gemmTiling(), transA, transB, M, N, K, alpha, A, lda, B, ldb, C, ldc);
+}
+
+
+void transpose(const double* A, int rows, int cols, double* B)
+{
+    for (int r0 = 0; r0 < rows; r0 += TRANSPOSE_TILE)
+    {
+        int r1 = std::min(rows, r0 + TRANSPOSE_TILE);
+        for (int c0 = 0; c0 < cols; c0 += TRANSPOSE_TILE)
+        {
+            int c1 = std::min(cols, c0 + TRANSPOSE_TILE);
+            for (int c = c0; c < c1; c++)
+                for (int r = r0; r < r1; r++)
+                    B[(size_t)c * rows + r] = A[(size_t)r * cols + c];
+        }
+    }
+}
+
+
+std::string gemmBackendName()
+{
+#ifdef VANILLANET_USE_CBLAS
+    return std::string("CBLAS (") + VANILLANET_BLAS_VENDOR + ")";
+#else
+    return "In-tree blocked GEMM";
+#endif
+}
+
+
+static std::string hostName()
+{
+    char name[256] = {};
+    if (gethostname(name, sizeof(name) - 1) != 0)
+        return "unknown";
+    return name;
+}
+
+
+std::string gemmTilingCachePath()
+{
+    return "./Resources/output/gemm_tiling.json";
+}
+
+
+GemmTiling tuneGemmTiling()
+{
+    // Shapes of the 784x128 layer on a batch of 64 samples
+    const int batch = 64, inputs = 784, outputs = 128;
+
+    std::vector<double> X((size_t)batch * inputs), W((size_t)outputs * inputs), E((size_t)batch * outputs);
+    std::vector<double> Y((size_t)batch * outputs), G((size_t)outputs * inputs);
+
+    for (size_t i = 0; i < X.size(); i++) X[i] = (i % 17) / 17.0;
+    for (size_t i = 0; i < W.size(); i++) W[i] = (i % 13) / 13.0 - 0.5;
+    for (size_t i = 0; i < E.size(); i++) E[i] = (i % 7) / 7.0 - 0.5;
+
+    GemmTiling best;
+    double bestTime = -1.0;
+
+    for (int kc : {128, 256, 392, 784})
+    {
+        for (int mc : {32, 64, 128})
+        {
+            for (int nc : {128, 256, 512, 1024})
+            {
+                GemmTiling candidate{mc, kc, nc};
+                double fastest = -1.0;
+
+                for (int rep = 0; rep < 3; rep++)
+                {
+                    auto start = std::chrono::steady_clock::now();
+                    blockedGemm(candidate, false, true, batch, outputs, inputs, 1.0, X.data(), inputs, W.data(), inputs, Y.data(), outputs);
+                    blockedGemm(candidate, true, false, outputs, inputs, batch, 1.0, E.data(), outputs, X.data(), inputs, G.data(), inputs);
+                    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+                    if (fastest < 0.0 || elapsed < fastest)
+                        fastest = elapsed;
+                }
+
+                if (bestTime < 0.0 || fastest < bestTime)
+                {
+                    bestTime = fastest;
+                    best = candidate;
+                }
+            }
+        }
+    }
+
+    return best;
+}
+
+
+static GemmTiling loadOrTuneTiling(FILE* log)
+{
+    std::string path = gemmTilingCachePath();
+    std::string host = hostName();
+    nlohmann::json cache = nlohmann::json::object();
+
+    std::ifstream file(path);
+    if (file.is_open())
+    {
+        cache = nlohmann::json::parse(file, nullptr, false);
+        if (cache.is_discarded() || !cache.is_object())
+            cache = nlohmann::json::object();
+        file.close();
+    }
+
+    // An entry that is not an object of three positive integers is tuned again
+    if (cache.contains(host) && cache[host].is_object())
+    {
+        const nlohmann::json& entry = cache[host];
+        auto blockSize = [&](const char* name) {
+            return entry.contains(name) && entry[name].is_number_integer() ? entry[name].get<int>() : 0;
+        };
+
+        GemmTiling tiling{blockSize("mc"), blockSize("kc"), blockSize("nc")};
+        if (tiling.mc > 0 && tiling.kc > 0 && tiling.nc > 0)
+            return tiling;
+    }
+
+    GemmTiling tiling = tuneGemmTiling();
+    cache[host] = {{"mc", tiling.mc}, {"kc", tiling.kc}, {"nc", tiling.nc}};
+
+    makeFolder("./Resources", "output");
+    std::ofstream out(path);
+    if (out.is_open())
+        out << cache.dump(4);
+
+    fprintf(log, ">> GEMM tiling tuned for %s: mc=%d kc=%d nc=%d (cached in %s)\n", host.c_str(), tiling.mc, tiling.kc, tiling.nc, path.c_str());
+    fflush(log);
+    return tiling;
+}
+
+
+// The default block sizes until `loadGemmTiling` is called
+static GemmTiling tilingInUse;
+static std::once_flag tilingLoaded;
+
+
+void loadGemmTiling(FILE* log)
+{
+#ifdef VANILLANET_USE_CBLAS
+    // The products go to the CBLAS library, the tiling is never used
+    (void)log;
+#else
+    std::call_once(tilingLoaded, [log]() { tilingInUse = loadOrTuneTiling(log); });
+#endif
+}
+
+
+GemmTiling& gemmTiling()
+{
+    return tilingInUse;
+}
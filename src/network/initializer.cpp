@@ -0,0 +1,79 @@
+#include "initializer.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+#include "random.hpp"
+#include "threadPool.hpp"
+
+
+// Minimum number of weights filled by a task
+static constexpr size_t INIT_GRAIN = 1 << 14;
+
+
+double initializationLimit(InitializationType type, int inputSize, int outputSize)
+{
+    switch (type)
+    {
+        case InitializationType::HE:
+            return std::sqrt(6.0 / std::max(1, inputSize));
+
+        case InitializationType::LECUN:
+            return std::sqrt(3.0 / std::max(1, inputSize));
+
+        default:
+            return std::sqrt(6.0 / std::max(1, inputSize + outputSize));
+    }
+}
+
+
+void initializeWeights(InitializationType type, int inputSize, int outputSize, uint64_t stream, std::vector<double>& weights)
+{
+    const size_t size = (size_t)inputSize * outputSize;
+    weights.resize(size);
+
+    const double limit = initializationLimit(type, inputSize, outputSize);
+    const uint64_t key = splitMix64(globalSeed() ^ splitMix64(stream));
+
+    // The top 53 bits of the hash give a double in [0, 1), mapped to [-limit, limit)
+    const double scale = 2.0 * limit / 9007199254740992.0;
+    double* w = weights.data();
+
+    threadPool().parallelFor(0, size, INIT_GRAIN, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
+            w[i] = (splitMix64(key + i) >> 11) * scale - limit;
+    });
+}
+
+
+std::string InitializationTypeToString(InitializationType type)
+{
+    switch (type)
+    {
+        case InitializationType::GLOROT:
+            return "Glorot";
+
+        case InitializationType::HE:
+            return "He";
+
+        case InitializationType::LECUN:
+            return "LeCun";
+
+        default:
+            return "None";
+    }
+}
+
+
+InitializationType stringToInitializationType(const std::string& name)
+{
+    std::string lower = name;
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+
+    if (lower == "glorot" || lower == "xavier") return InitializationType::GLOROT;
+    if (lower == "he" || lower == "kaiming") return InitializationType::HE;
+    if (lower == "lecun") return InitializationType::LECUN;
+
+    return InitializationType::INVALID;
+}
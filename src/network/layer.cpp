@@ -1,11 +1,29 @@
 #include "layer.hpp"
 
+#include <algorithm>
+#include <cmath>
 
-Layer::Layer(int inputSize, int outputSize)
+
+/**
+ * Lists the non-zero inputs of a batch, returns false if there are too many of them to skip the others.
+ */
+static bool compressInputs(const double* inputs, int batchSize, int inputSize, SparseMatrix& batch)
+{
+    size_t count = (size_t)batchSize * inputSize;
+    size_t nonZeros = std::count_if(inputs, inputs + count, [](double input) { return input != 0.0; });
+    if (nonZeros > MAX_INPUT_DENSITY * count)
+        return false;
+
+    denseToSparse(inputs, batchSize, inputSize, batch);
+    return true;
+}
+
+
+Layer::Layer(int inputSize, int outputSize, InitializationType initialization, uint64_t stream)
 {
     this->inputSize = inputSize;
     this->outputSize = outputSize;
-    this->neurons = Layer::initializeNeurons(inputSize, outputSize);
+    Layer::initializeNeurons(inputSize, outputSize, initialization, stream);
 }
 
 
@@ -17,37 +35,45 @@ int Layer::getLayerSize()
 
 void Layer::importWeightsBiases(std::vector<std::vector<double>> weights, std::vector<double> biases)
 {
-    // printf("Weights size: %ld, Biases size: %ld, Neurons size: %ld\n", weights.size(), biases.size(), neurons.size());
-    
-    if (weights.size() != neurons.size() || biases.size() != neurons.size())
+    // printf("Weights size: %ld, Biases size: %ld, Neurons size: %d\n", weights.size(), biases.size(), outputSize);
+
+    if (static_cast<int>(weights.size()) != outputSize || static_cast<int>(biases.size()) != outputSize)
     {
-        printf("Error: Weights vector size: %ld or Biases size: %ld does not match the number of neurons: %ld\n", weights.size(), biases.size(), neurons.size());
+        printf("Error: Weights vector size: %ld or Biases size: %ld does not match the number of neurons: %d\n", weights.size(), biases.size(), outputSize);
         return;
     }
-    
-    for (size_t i = 0; i < neurons.size(); i++)
+
+    for (int i = 0; i < outputSize; i++)
     {
-        //printf("%d) Weights size: %ld, Neuron size: %ld\n", i+1, weights[i].size(), neurons[i].weights.size());
-        
-        if (weights[i].size() != neurons[i].weights.size())
+        if (static_cast<int>(weights[i].size()) != inputSize)
         {
-            printf("Error: Weights size: %ld does not match the number of inputs: %ld\n", weights[i].size(), neurons[i].weights.size());
+            printf("Error: Weights size: %ld does not match the number of inputs: %d\n", weights[i].size(), inputSize);
             return;
         }
+    }
 
-        neurons[i].setWeights(weights[i]);
-        neurons[i].setBias(biases[i]);
+    for (int i = 0; i < outputSize; i++)
+    {
+        std::copy(weights[i].begin(), weights[i].end(), this->weights.begin() + (size_t)i * inputSize);
+        this->biases[i] = biases[i];
     }
 
+    // A pruned layer keeps its pattern, as a quantized layer keeps its quantization
+    if (isSparse())
+        applySparsityPattern(sparseWeights, this->weights.data());
+    if (isQuantized())
+        quantize(packedWeights.type);
+    transposeWeights();
 }
 
 
 void Layer::saveWeightsBiases(std::vector<std::vector<double>>& weights, std::vector<double>& biases)
 {
-    for (size_t i = 0; i < neurons.size(); i++)
+    for (int i = 0; i < outputSize; i++)
     {
-        weights.push_back(neurons[i].weights);
-        biases.push_back(neurons[i].bias);
+        auto row = this->weights.begin() + (size_t)i * inputSize;
+        weights.emplace_back(row, row + inputSize);
+        biases.push_back(this->biases[i]);
     }
 }
 
@@ -57,83 +83,261 @@ std::vector<double> Layer::forwardPass(std::vector<double> inputs)
     this -> inputs = inputs;
 
     std::vector<double> outputs;
-    outputs.reserve(neurons.size());
-
-    for (size_t i = 0; i < neurons.size(); i++)
-    {
-        outputs.push_back(neurons[i].getOutput(inputs));
-    }
+    forwardBatch(inputs, outputs, 1);
 
     this->outputs = outputs;
     return outputs;
 }
 
 
-std::vector<double> Layer::backwardPass(std::vector<double>& error, std::vector<std::vector<double>>& weights, std::vector<double>& biases)
+void Layer::forwardBatch(const std::vector<double>& inputs, std::vector<double>& outputs, int batchSize) const
 {
-    std::vector<double> input_error(inputs.size(), 0.0);
+    int inputWidth = batchSize > 0 ? inputs.size() / batchSize : 0;
+
+    outputs.resize((size_t)batchSize * outputWidth(inputWidth));
+    forwardBatch(inputs.data(), inputWidth, outputs.data(), batchSize);
+}
 
-    for (size_t i = 0; i < neurons.size(); i++)
+
+void Layer::forwardBatch(const double* inputs, int inputWidth, double* outputs, int batchSize) const
+{
+    (void)inputWidth;
+
+    thread_local SparseMatrix sparseInputs;
+
+    // outputs = inputs x Wᵀ
+    if (isQuantized())
+        packedGemm(packedWeights, inputs, batchSize, outputs);
+    else if (isSparse())
+        spmm(sparseWeights, inputs, batchSize, outputs);
+    else if (exploitsInputSparsity() && compressInputs(inputs, batchSize, inputSize, sparseInputs))
+        gatherRows(sparseInputs, transposedWeights.data(), outputSize, outputs);
+    else
+        gemm(false, true, batchSize, outputSize, inputSize,
+             1.0, inputs, inputSize, weights.data(), inputSize,
+             0.0, outputs, outputSize);
+
+    for (int n = 0; n < batchSize; n++)
     {
-        std::vector<double> weights_error;
-        for (size_t j = 0; j < neurons[i].weights.size(); j++)
-        {
-            // Gradient with respect to weight j of neuron i
-            double weight_grad = this->inputs[j] * error[i];
-            weights_error.push_back(weight_grad);
+        double* row = outputs + (size_t)n * outputSize;
+        for (int i = 0; i < outputSize; i++)
+            row[i] += biases[i];
+    }
+}
 
-            // Update the error for input j (which will be passed to the previous layer)
-            input_error[j] += neurons[i].weights[j] * error[i];
-        }
-        weights.push_back(weights_error);
+
+void Layer::backwardBatch(const std::vector<double>& inputs, const std::vector<double>& outputs, const std::vector<double>& error,
+                          std::vector<double>& inputError, LayerGradients& gradients, int batchSize, bool computeInputError) const
+{
+    (void)outputs;
+
+    thread_local SparseMatrix sparseInputs;
+    thread_local std::vector<double> transposedGradients;
+
+    gradients.weights.resize(weights.size());
+    gradients.biases.assign(outputSize, 0.0);
+
+    // gradients.weights = errorᵀ x inputs, computed as (inputsᵀ x error)ᵀ over the non-zero inputs only when they are few
+    if (exploitsInputSparsity() && compressInputs(inputs.data(), batchSize, inputSize, sparseInputs))
+    {
+        transposedGradients.resize(weights.size());
+        scatterRows(sparseInputs, error.data(), outputSize, transposedGradients.data());
+        transpose(transposedGradients.data(), inputSize, outputSize, gradients.weights.data());
     }
+    else
+        gemm(true, false, outputSize, inputSize, batchSize,
+             1.0, error.data(), outputSize, inputs.data(), inputSize,
+             0.0, gradients.weights.data(), inputSize);
+
+    for (int n = 0; n < batchSize; n++)
+    {
+        const double* row = error.data() + (size_t)n * outputSize;
+        for (int i = 0; i < outputSize; i++)
+            gradients.biases[i] += row[i];
+    }
+
+    if (!computeInputError)
+        return;
 
-    biases = error;
-    return input_error;
+    // inputError = error x W, the gradients of a quantized layer going straight through to its real-valued weights
+    inputError.resize((size_t)batchSize * inputSize);
+    gemm(false, false, batchSize, inputSize, outputSize,
+         1.0, error.data(), outputSize, (isQuantized() ? quantizedWeights : weights).data(), inputSize,
+         0.0, inputError.data(), inputSize);
 }
 
 
-void Layer::updateWeightsBiases(double learningRate, std::vector<std::vector<double>> gradientsWeights, std::vector<double> gradientsBiases)
+void Layer::prepareOptimizer(const OptimizerSettings& optimizer)
 {
-    // printf("Weights size: %ld, Biases size: %ld, Neurons size: %ld\n", gradientsWeights.size(), gradientsBiases.size(), neurons.size());
-    
-    if (gradientsWeights.size() != neurons.size() || gradientsBiases.size() != neurons.size())
+    OptimizerState& state = optimizerState;
+    int buffers = optimizerStateBuffers(optimizer.type);
+
+    if ((buffers >= 1 && state.weightsFirstMoment.size() != weights.size()) ||
+        (buffers >= 2 && state.weightsSecondMoment.size() != weights.size()))
     {
-        printf("Error: Weights vector size: %ld or Biases size: %ld does not match the number of neurons: %ld\n", gradientsWeights.size(), gradientsBiases.size(), neurons.size());
-        return;
+        state.weightsFirstMoment.assign(buffers >= 1 ? weights.size() : 0, 0.0);
+        state.weightsSecondMoment.assign(buffers >= 2 ? weights.size() : 0, 0.0);
+        state.biasesFirstMoment.assign(buffers >= 1 ? biases.size() : 0, 0.0);
+        state.biasesSecondMoment.assign(buffers >= 2 ? biases.size() : 0, 0.0);
+        state.step = 0;
     }
-    
-    for (size_t i = 0; i < neurons.size(); i++)
-    {
-        //printf("%d) Weights size: %ld, Neuron size: %ld\n", i+1, gradientsWeights[i].size(), neurons[i].weights.size());
-        
-        if (gradientsWeights[i].size() != neurons[i].weights.size())
-        {
-            printf("Error: Weights size: %ld does not match the number of inputs: %ld\n", gradientsWeights[i].size(), neurons[i].weights.size());
-            return;
-        }
+}
 
-        neurons[i].setBias(neurons[i].bias - (learningRate * gradientsBiases[i]));
 
-        for (size_t j = 0; j < neurons[i].weights.size(); j++)
-        {
-            neurons[i].weights[j] -= learningRate * gradientsWeights[i][j];
-        }
+void Layer::applyOptimizer(const LayerGradients& gradients, const OptimizerSettings& optimizer, double learningRate, double gradientScale, long step)
+{
+    OptimizerState& state = optimizerState;
+    prepareOptimizer(optimizer);
+
+    if (step <= 0)
+        step = ++state.step;
+
+    optimizerStep(optimizer, learningRate, gradientScale, step, true,
+                  gradients.weights.data(), weights.data(), state.weightsFirstMoment.data(), state.weightsSecondMoment.data(), weights.size());
+    optimizerStep(optimizer, learningRate, gradientScale, step, false,
+                  gradients.biases.data(), biases.data(), state.biasesFirstMoment.data(), state.biasesSecondMoment.data(), biases.size());
+
+    // The pruned weights stay at 0 and the CSR values follow the update
+    if (isSparse())
+        applySparsityPattern(sparseWeights, weights.data());
+
+    // The quantized and the transposed weights follow the real-valued ones
+    if (isQuantized())
+        quantize(packedWeights.type);
+    transposeWeights();
+}
+
+
+void Layer::keepNeurons(const std::vector<int>& neurons)
+{
+    std::vector<double> keptWeights;
+    std::vector<double> keptBiases;
+    keptWeights.reserve(neurons.size() * inputSize);
+    keptBiases.reserve(neurons.size());
+
+    for (int neuron : neurons)
+    {
+        auto row = weights.begin() + (size_t)neuron * inputSize;
+        keptWeights.insert(keptWeights.end(), row, row + inputSize);
+        keptBiases.push_back(biases[neuron]);
     }
+
+    weights.swap(keptWeights);
+    biases.swap(keptBiases);
+    outputSize = neurons.size();
+
+    // The moments and the sparsity mask belong to the removed layout
+    optimizerState = OptimizerState();
+    sparseWeights = SparseMatrix();
+    if (isQuantized())
+        quantize(packedWeights.type);
+    transposeWeights();
 }
 
 
-std::vector<Neuron> Layer::initializeNeurons(int inputSize, int outputSize)
+void Layer::keepInputs(const std::vector<int>& inputs)
 {
-    std::vector<Neuron> neurons;
-    neurons.reserve(outputSize);
+    std::vector<double> keptWeights;
+    keptWeights.reserve((size_t)outputSize * inputs.size());
 
     for (int i = 0; i < outputSize; i++)
     {
-        neurons.emplace_back(inputSize, outputSize);
+        const double* row = weights.data() + (size_t)i * inputSize;
+        for (int input : inputs)
+            keptWeights.push_back(row[input]);
+    }
+
+    weights.swap(keptWeights);
+    inputSize = inputs.size();
+
+    optimizerState = OptimizerState();
+    sparseWeights = SparseMatrix();
+    if (isQuantized())
+        quantize(packedWeights.type);
+    transposeWeights();
+}
+
+
+void Layer::prune(double sparsity)
+{
+    size_t pruned = std::min(weights.size(), (size_t)(sparsity * weights.size()));
+
+    // The indices of the `pruned` weights with the smallest magnitude come first
+    std::vector<size_t> order(weights.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+
+    if (pruned > 0 && pruned < order.size())
+    {
+        std::nth_element(order.begin(), order.begin() + pruned, order.end(),
+                         [&](size_t a, size_t b) { return std::abs(weights[a]) < std::abs(weights[b]); });
+    }
+
+    for (size_t i = 0; i < pruned; i++)
+        weights[order[i]] = 0.0;
+
+    compressWeights();
+    transposeWeights();
+}
+
+
+void Layer::compressWeights()
+{
+    sparseWeights = denseToSparse(weights.data(), outputSize, inputSize);
+}
+
+
+void Layer::quantize(WeightQuantization type)
+{
+    if (type == WeightQuantization::NONE || type == WeightQuantization::INVALID)
+    {
+        packedWeights = PackedWeights();
+        quantizedWeights.clear();
+        return;
+    }
+
+    quantizeWeights(weights.data(), outputSize, inputSize, type, packedWeights, quantizedWeights);
+}
+
+
+void Layer::exploitInputSparsity(bool enable)
+{
+    if (!enable)
+    {
+        transposedWeights.clear();
+        return;
     }
 
-    return neurons;
+    transposedWeights.resize(weights.size());
+    transposeWeights();
+}
+
+
+void Layer::transposeWeights()
+{
+    if (!exploitsInputSparsity())
+        return;
+
+    transposedWeights.resize(weights.size());
+    transpose(weights.data(), outputSize, inputSize, transposedWeights.data());
+}
+
+
+double Layer::sparsity() const
+{
+    if (weights.empty())
+        return 0.0;
+
+    size_t zeros = std::count(weights.begin(), weights.end(), 0.0);
+    return (double)zeros / weights.size();
+}
+
+
+void Layer::initializeNeurons(int inputSize, int outputSize, InitializationType initialization, uint64_t stream)
+{
+    // Each layer draws from its own stream, so its weights do not depend on the size of the others
+    initializeWeights(initialization, inputSize, outputSize, stream, weights);
+    biases.assign(outputSize, 0.0);
 }
 
 
@@ -151,18 +355,30 @@ std::vector<double> ActivationLayer::forwardPass(std::vector<double> inputs)
 }
 
 
-std::vector<double> ActivationLayer::backwardPass(std::vector<double>& error, std::vector<std::vector<double>>& weights, std::vector<double>& biases)
+void ActivationLayer::forwardBatch(const double* inputs, int inputWidth, double* outputs, int batchSize) const
+{
+    // Softmax normalises each sample on its own
+    for (int n = 0; n < batchSize; n++)
+        Activation(this->activationFunction, inputs + (size_t)n * inputWidth, outputs + (size_t)n * inputWidth, inputWidth);
+}
+
+
+void ActivationLayer::backwardBatch(const std::vector<double>& inputs, const std::vector<double>& outputs, const std::vector<double>& error,
+                                    std::vector<double>& inputError, LayerGradients& gradients, int batchSize, bool computeInputError) const
 {
     // Marking the unused parameters to avoid compiler warnings
-    (void)weights;
-    (void)biases;
-    
+    (void)inputs;
+    (void)gradients;
+    (void)computeInputError;
+
     ActivationType sel_dAct = select_dActivation(this->activationFunction);
-    std::vector<double> dInput = Activation(sel_dAct, this->outputs);
 
-    for (size_t i = 0; i < error.size(); i++)
-        error[i] *= dInput[i];
+    inputError.resize(outputs.size());
+    size_t sampleSize = batchSize > 0 ? outputs.size() / batchSize : 0;
 
-    return error;
+    for (int n = 0; n < batchSize; n++)
+        Activation(sel_dAct, outputs.data() + n * sampleSize, inputError.data() + n * sampleSize, sampleSize);
 
-}
\ No newline at end of file
+    for (size_t i = 0; i < inputError.size(); i++)
+        inputError[i] *= error[i];
+}
@@ -0,0 +1,194 @@
+#include "lowRank.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "network.hpp"
+
+
+// Largest number of sweeps over the pairs of columns
+static constexpr int JACOBI_MAX_SWEEPS = 60;
+
+// Two columns are orthogonal when |<a, b>| <= JACOBI_TOLERANCE x |a| x |b|
+static constexpr double JACOBI_TOLERANCE = 1e-13;
+
+
+SingularValueDecomposition jacobiSVD(const double* A, int rows, int cols)
+{
+    // The matrix is decomposed as long as it is tall: a wide matrix is transposed, A = (Aᵀ)ᵀ
+    bool transposed = cols > rows;
+    int length = std::max(rows, cols);
+    int k = std::min(rows, cols);
+
+    // The k columns of the (tall) matrix, each stored contiguously, and the rotations applied to them
+    std::vector<double> columns((size_t)k * length);
+    std::vector<double> rotations((size_t)k * k, 0.0);
+
+    for (int j = 0; j < k; j++)
+    {
+        double* column = columns.data() + (size_t)j * length;
+        for (int i = 0; i < length; i++)
+            column[i] = transposed ? A[(size_t)j * cols + i] : A[(size_t)i * cols + j];
+        rotations[(size_t)j * k + j] = 1.0;
+    }
+
+    for (int sweep = 0; sweep < JACOBI_MAX_SWEEPS; sweep++)
+    {
+        bool rotated = false;
+
+        for (int p = 0; p < k - 1; p++)
+        {
+            double* a = columns.data() + (size_t)p * length;
+            double* va = rotations.data() + (size_t)p * k;
+
+            for (int q = p + 1; q < k; q++)
+            {
+                double* b = columns.data() + (size_t)q * length;
+                double* vb = rotations.data() + (size_t)q * k;
+
+                double alpha = 0.0, beta = 0.0, gamma = 0.0;
+                for (int i = 0; i < length; i++)
+                {
+                    alpha += a[i] * a[i];
+                    beta += b[i] * b[i];
+                    gamma += a[i] * b[i];
+                }
+
+                if (std::abs(gamma) <= JACOBI_TOLERANCE * std::sqrt(alpha * beta))
+                    continue;
+
+                // The rotation that makes the two columns orthogonal, with the smallest angle
+                double zeta = (beta - alpha) / (2.0 * gamma);
+                double t = std::copysign(1.0, zeta) / (std::abs(zeta) + std::sqrt(1.0 + zeta * zeta));
+                double c = 1.0 / std::sqrt(1.0 + t * t);
+                double s = c * t;
+
+                for (int i = 0; i < length; i++)
+                {
+                    double x = a[i], y = b[i];
+                    a[i] = c * x - s * y;
+                    b[i] = s * x + c * y;
+                }
+
+                for (int i = 0; i < k; i++)
+                {
+                    double x = va[i], y = vb[i];
+                    va[i] = c * x - s * y;
+                    vb[i] = s * x + c * y;
+                }
+
+                rotated = true;
+            }
+        }
+
+        if (!rotated)
+            break;
+    }
+
+    // The norms of the orthogonal columns are the singular values, sorted from the largest
+    std::vector<double> norms(k);
+    for (int j = 0; j < k; j++)
+    {
+        const double* column = columns.data() + (size_t)j * length;
+        norms[j] = std::sqrt(std::inner_product(column, column + length, column, 0.0));
+    }
+
+    std::vector<int> order(k);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return norms[a] > norms[b]; });
+
+    // Tall matrix: A = columns x rotationsᵀ, so U = normalised columns and V = rotations (swapped when transposed)
+    SingularValueDecomposition svd;
+    svd.rows = rows;
+    svd.cols = cols;
+    svd.S.resize(k);
+
+    std::vector<double>& left = transposed ? svd.V : svd.U;
+    std::vector<double>& right = transposed ? svd.U : svd.V;
+    left.assign((size_t)length * k, 0.0);
+    right.assign((size_t)k * k, 0.0);
+
+    for (int j = 0; j < k; j++)
+    {
+        int source = order[j];
+        const double* column = columns.data() + (size_t)source * length;
+        const double* rotation = rotations.data() + (size_t)source * k;
+        double norm = norms[source];
+        svd.S[j] = norm;
+
+        if (norm > 0.0)
+        {
+            for (int i = 0; i < length; i++)
+                left[(size_t)i * k + j] = column[i] / norm;
+        }
+
+        for (int i = 0; i < k; i++)
+            right[(size_t)i * k + j] = rotation[i];
+    }
+
+    return svd;
+}
+
+
+void lowRankApproximation(const SingularValueDecomposition& svd, int rank, double* dense)
+{
+    int k = svd.rank();
+    rank = std::min(rank, k);
+
+    for (int i = 0; i < svd.rows; i++)
+    {
+        const double* u = svd.U.data() + (size_t)i * k;
+        double* row = dense + (size_t)i * svd.cols;
+
+        for (int c = 0; c < svd.cols; c++)
+        {
+            const double* v = svd.V.data() + (size_t)c * k;
+            double sum = 0.0;
+            for (int j = 0; j < rank; j++)
+                sum += u[j] * svd.S[j] * v[j];
+            row[c] = sum;
+        }
+    }
+}
+
+
+size_t layerMultiplyAdds(int inputSize, int outputSize, int rank)
+{
+    if (rank == 0)
+        return (size_t)inputSize * outputSize;
+
+    return (size_t)rank * (inputSize + outputSize);
+}
+
+
+bool factorizeLayer(Network& net, size_t index, const SingularValueDecomposition& svd, int rank)
+{
+    if (index >= net.Layers.size() || net.Layers[index]->getType() != LayerType::StandardLayer)
+        return false;
+
+    const Layer& layer = *net.Layers[index];
+    if (layer.outputSize != svd.rows || layer.inputSize != svd.cols || rank < 1 || rank > svd.rank())
+        return false;
+
+    int k = svd.rank();
+    Layer first(svd.cols, rank);
+    Layer second(rank, svd.rows);
+
+    // √S goes to both factors, so they have the same scale
+    for (int j = 0; j < rank; j++)
+    {
+        double scale = std::sqrt(svd.S[j]);
+
+        for (int c = 0; c < svd.cols; c++)
+            first.weights[(size_t)j * svd.cols + c] = scale * svd.V[(size_t)c * k + j];
+
+        for (int i = 0; i < svd.rows; i++)
+            second.weights[(size_t)i * rank + j] = svd.U[(size_t)i * k + j] * scale;
+    }
+
+    std::fill(first.biases.begin(), first.biases.end(), 0.0);
+    second.biases = layer.biases;
+
+    return net.splitLayer(index, first, second);
+}
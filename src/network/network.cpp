@@ -3,8 +3,6 @@
 
 Network::Network()
 {
-    this->lossValue = 0.0;
-    this->lossPrimeValue = std::vector<double>();
     this->output = std::vector<double>();
 }
 
@@ -14,6 +12,10 @@ void Network::addLayer(const Layer& layer)
     Network::checkSoftmaxLastLayer();
     Layers.push_back(std::make_shared<Layer>(layer));
     standardLayerCount++;
+
+    // The first layer reads the images, whose background pixels are exactly 0
+    if (Layers.size() == 1)
+        Layers.back()->exploitInputSparsity(true);
 }
 
 
@@ -25,6 +27,99 @@ void Network::addLayer(const ActivationLayer& activationLayer)
 }
 
 
+void Network::addLayer(const Conv2DLayer& convolutionLayer)
+{
+    Network::checkSoftmaxLastLayer();
+    Layers.push_back(std::make_shared<Conv2DLayer>(convolutionLayer));
+    convolutionLayerCount++;
+}
+
+
+void Network::addLayer(const MaxPool2DLayer& poolingLayer)
+{
+    Network::checkSoftmaxLastLayer();
+    Layers.push_back(std::make_shared<MaxPool2DLayer>(poolingLayer));
+    poolingLayerCount++;
+}
+
+
+std::string Network::parameterName(size_t index) const
+{
+    if (index >= Layers.size() || !Layers[index]->hasParameters())
+        return "";
+
+    LayerType type = Layers[index]->getType();
+    int number = 1;
+    for (size_t i = 0; i < index; i++)
+        number += Layers[i]->getType() == type;
+
+    return (type == LayerType::ConvolutionLayer ? "conv" : "fc") + std::to_string(number);
+}
+
+
+std::vector<size_t> Network::hiddenLayers() const
+{
+    std::vector<size_t> hidden;
+
+    for (size_t i = 0; i < Layers.size(); i++)
+    {
+        if (Layers[i]->getType() != LayerType::StandardLayer)
+            continue;
+
+        size_t next = i + 1;
+        while (next < Layers.size() && Layers[next]->getType() == LayerType::ActivationLayer)
+            next++;
+
+        if (next < Layers.size() && Layers[next]->getType() == LayerType::StandardLayer)
+            hidden.push_back(i);
+    }
+
+    return hidden;
+}
+
+
+bool Network::keepNeurons(size_t index, const std::vector<int>& neurons)
+{
+    std::vector<size_t> hidden = hiddenLayers();
+    if (std::find(hidden.begin(), hidden.end(), index) == hidden.end() || neurons.empty())
+        return false;
+
+    for (size_t i = 0; i < neurons.size(); i++)
+    {
+        if (neurons[i] < 0 || neurons[i] >= Layers[index]->outputSize || (i > 0 && neurons[i] <= neurons[i - 1]))
+            return false;
+    }
+
+    size_t next = index + 1;
+    while (Layers[next]->getType() != LayerType::StandardLayer)
+        next++;
+
+    Layers[index]->keepNeurons(neurons);
+    Layers[next]->keepInputs(neurons);
+    return true;
+}
+
+
+bool Network::splitLayer(size_t index, const Layer& first, const Layer& second)
+{
+    if (index >= Layers.size() || Layers[index]->getType() != LayerType::StandardLayer)
+        return false;
+
+    if (first.inputSize != Layers[index]->inputSize || second.outputSize != Layers[index]->outputSize || first.outputSize != second.inputSize)
+        return false;
+
+    bool sparseInputs = Layers[index]->exploitsInputSparsity();
+    Layers[index] = std::make_shared<Layer>(second);
+    Layers.insert(Layers.begin() + index, std::make_shared<Layer>(first));
+    standardLayerCount++;
+
+    // The first layer of the two reads the inputs of the replaced one
+    Layers[index]->exploitInputSparsity(sparseInputs);
+    Layers[index + 1]->exploitInputSparsity(false);
+    return true;
+}
+
+
 void Network::checkSoftmaxLastLayer()
 {
     for (size_t i = 0; i < Layers.size(); i++)
@@ -46,16 +141,20 @@ void Network::checkSoftmaxLastLayer()
 void Network::addLossFunction(LossFunction lossFunction)
 {
     this->lossFunction = lossFunction;
-    this->lossFunctionPrime = select_LossFunction_prime(lossFunction);
+}
+
+
+void Network::addOptimizer(OptimizerType optimizerType)
+{
+    this->optimizer.type = optimizerType;
 }
 
 
 void Network::importWeightsBiases(std::vector<BiasesWeights> weightsBiases)
 {
-    int weightBiasIndex = 0;
     if (weightsBiases.size() == 0) return;
 
-    if (static_cast<int>(weightsBiases.size()) != standardLayerCount)
+    if (static_cast<int>(weightsBiases.size()) != standardLayerCount + convolutionLayerCount)
     {
         printf("Error: Number of layers in the network does not match the number of weights and biases provided.\n");
         return;
@@ -63,78 +162,118 @@ void Network::importWeightsBiases(std::vector<BiasesWeights> weightsBiases)
 
     for (size_t i = 0; i < Layers.size(); i++)
     {
-        // Identify the type of layer using the polymorphic method getType
-        if (Layers[i]->getType() == LayerType::StandardLayer)
+        if (!Layers[i]->hasParameters())
+            continue;
+
+        std::string weightsName = parameterName(i) + ".weight";
+        auto found = std::find_if(weightsBiases.begin(), weightsBiases.end(),
+                                  [&](const BiasesWeights& bw) { return bw.WeightsName == weightsName; });
+
+        if (found == weightsBiases.end())
         {
-            Layers[i]->importWeightsBiases(weightsBiases[weightBiasIndex].weights, weightsBiases[weightBiasIndex].biases);
-            weightBiasIndex++;
+            printf("Error: The weights and biases provided have no %s.\n", weightsName.c_str());
+            return;
         }
 
-        if (weightBiasIndex > static_cast<int>(weightsBiases.size())) break;
+        Layers[i]->importWeightsBiases(found->weights, found->biases);
     }
 }
 
 
-std::vector<BiasesWeights> Network::saveWeightsBiases()
+bool Network::importStateDict(const PtStateDict& stateDict, std::string* error)
 {
-    std::vector<BiasesWeights> weightsBiases;
-    int idx = 1;
+    std::vector<std::pair<const PtTensor*, const PtTensor*>> tensors;
 
+    auto fail = [&](const std::string& message) {
+        if (error != nullptr)
+            *error = message;
+        else
+            printf("%s", message.c_str());
+        return false;
+    };
+
+    // Every tensor is checked before the first layer is modified
     for (size_t i = 0; i < Layers.size(); i++)
     {
-        // Identify the type of layer using the polymorphic method getType
-        if (Layers[i]->getType() == LayerType::StandardLayer)
-        {
-            BiasesWeights bw;
-            Layers[i]->saveWeightsBiases(bw.weights, bw.biases);
+        const std::shared_ptr<Layer>& layer = Layers[i];
+        if (!layer->hasParameters())
+            continue;
 
-            bw.LayerIndex = idx++;
-            bw.BiasName = "fc" + std::to_string(bw.LayerIndex) + ".bias";
-            bw.WeightsName = "fc" + std::to_string(bw.LayerIndex) + ".weight";
+        std::string prefix = parameterName(i);
+        const PtTensor* weights = stateDict.find(prefix + ".weight");
+        const PtTensor* biases = stateDict.find(prefix + ".bias");
 
-            weightsBiases.push_back(bw);
-        }
+        if (weights == nullptr || biases == nullptr)
+            return fail("Error: The state_dict has no " + prefix + ".weight or " + prefix + ".bias tensor.\n");
+
+        // A convolution is stored as (filters, channels, kernel, kernel), in the same order as its rows
+        if (weights->shape.empty() || weights->shape[0] != layer->outputSize || weights->elements != layer->weights.size() ||
+            biases->shape != std::vector<int64_t>{ layer->outputSize })
+            return fail("Error: The shape of " + prefix + " does not match the layer (" + std::to_string(layer->inputSize) +
+                        " inputs, " + std::to_string(layer->outputSize) + " outputs).\n");
+
+        tensors.emplace_back(weights, biases);
     }
 
-    return weightsBiases;
+    size_t next = 0;
+    for (const std::shared_ptr<Layer>& layer : Layers)
+    {
+        if (!layer->hasParameters())
+            continue;
+
+        // The state_dict and the layer share the row-major (outputs x inputs) layout
+        ptTensorToDouble(*tensors[next].first, layer->weights.data());
+        ptTensorToDouble(*tensors[next].second, layer->biases.data());
+        if (layer->isSparse())
+            applySparsityPattern(layer->sparseWeights, layer->weights.data());
+        if (layer->isQuantized())
+            layer->quantize(layer->packedWeights.type);
+        layer->transposeWeights();
+        next++;
+    }
+
+    return true;
 }
 
 
-double Network::loss(const std::vector<double>& yTrue, const std::vector<double>& yPredicted)
+bool Network::importCheckpoint(const std::string& path)
 {
-    if (this->lossFunction == LossFunction::SQUARED_ERROR)
-        this->lossValue = squared_error_loss(yTrue, yPredicted);
-
-    else if (this->lossFunction == LossFunction::MEAN_SQUARED_ERROR)
-        this->lossValue = mse_loss(yTrue, yPredicted);
+    if (isPtCheckpoint(path))
+    {
+        PtStateDict stateDict;
+        return stateDict.load(path) && importStateDict(stateDict);
+    }
 
-    else if (this->lossFunction == LossFunction::CROSS_ENTROPY)
-        this->lossValue = binary_cross_entropy_loss(yTrue, yPredicted);
+    std::vector<BiasesWeights> weightsBiases = parseJSON(path);
+    if (weightsBiases.empty())
+        return false;
 
-    this->lossPrimeValue = lossPrime(yTrue, yPredicted);
-    return this->lossValue;
+    importWeightsBiases(weightsBiases);
+    return true;
 }
 
 
-std::vector<double> Network::lossPrime(const std::vector<double>& yTrue, const std::vector<double>& yPredicted)
+std::vector<BiasesWeights> Network::saveWeightsBiases()
 {
-    if (this->lossFunctionPrime == LossFunctionPrime::SQUARED_ERROR_PRIME)
-        this->lossPrimeValue = squared_error_loss_prime(yTrue, yPredicted);
-
-    else if (this->lossFunctionPrime == LossFunctionPrime::MEAN_SQUARED_ERROR_PRIME)
-        this->lossPrimeValue = mse_loss_prime(yTrue, yPredicted);
+    std::vector<BiasesWeights> weightsBiases;
 
-    else if (this->lossFunctionPrime == LossFunctionPrime::CROSS_ENTROPY_PRIME)
-        this->lossPrimeValue = binary_cross_entropy_loss_prime(yTrue, yPredicted);
+    for (size_t i = 0; i < Layers.size(); i++)
+    {
+        if (Layers[i]->hasParameters())
+        {
+            BiasesWeights bw;
+            Layers[i]->saveWeightsBiases(bw.weights, bw.biases);
 
-    return this->lossPrimeValue;
-}
+            std::string name = parameterName(i);
+            bw.LayerIndex = std::stoi(name.substr(name.find_first_of("0123456789")));
+            bw.BiasName = name + ".bias";
+            bw.WeightsName = name + ".weight";
 
+            weightsBiases.push_back(bw);
+        }
+    }
 
-void Network::setLoss(double loss, const std::vector<double>& lossPrime)
-{
-    this->lossValue = loss;
-    this->lossPrimeValue = lossPrime;
+    return weightsBiases;
 }
 
 
@@ -152,120 +291,134 @@ std::vector<double> Network::forwardPropagation(const std::vector<double>& input
 }
 
 
-std::vector<BiasesWeights> Network::backwardPropagation(const std::vector<double>& outputError)
+const std::vector<double>& Network::forwardPropagationBatch(BatchWorkspace& workspace) const
 {
-    int skipSoftmax = 1;
-    std::vector<double> error = outputError;
-    std::vector<BiasesWeights> weightsBiases;
-
-    ActivationLayer* activationLayer = dynamic_cast<ActivationLayer*>(Layers[Layers.size() - 1].get());
-    if (activationLayer != nullptr && activationLayer->activationFunction == ActivationType::SOFTMAX)
-        skipSoftmax = 2;
+    workspace.activations.resize(Layers.size());
 
-    for (int i = Layers.size() - skipSoftmax; i >= 0; i--)
+    for (size_t i = 0; i < Layers.size(); i++)
     {
-        BiasesWeights gradients;
+        const std::vector<double>& layerInputs = (i == 0) ? workspace.inputs : workspace.activations[i - 1];
+        Layers[i]->forwardBatch(layerInputs, workspace.activations[i], workspace.batchSize);
+    }
 
-        if (Layers[i]->getType() == LayerType::StandardLayer)
-        {
-            error = Layers[i]->backwardPass(error, gradients.weights, gradients.biases);
+    return Layers.empty() ? workspace.inputs : workspace.activations.back();
+}
+
+
+void Network::forwardPropagationBatch(const double* inputs, int batchSize, double* outputs, BatchWorkspace& workspace, size_t layers) const
+{
+    layers = std::min(layers, Layers.size());
+    workspace.activations.resize(Layers.size());
+
+    const double* layerInputs = inputs;
+    int width = inputSize();
 
-            gradients.LayerIndex = standardLayerCount - weightsBiases.size();
-            gradients.BiasName = "fc" + std::to_string(gradients.LayerIndex) + ".bias";
-            gradients.WeightsName = "fc" + std::to_string(gradients.LayerIndex) + ".weight";
+    for (size_t i = 0; i < layers; i++)
+    {
+        int nextWidth = Layers[i]->outputWidth(width);
 
-            weightsBiases.push_back(gradients);
+        // The last layer writes straight into the buffer of the caller
+        double* layerOutputs = outputs;
+        if (i + 1 < layers)
+        {
+            workspace.activations[i].resize((size_t)batchSize * nextWidth);
+            layerOutputs = workspace.activations[i].data();
         }
-        else error = Layers[i]->backwardPass(error, gradients.weights, gradients.biases);
+
+        Layers[i]->forwardBatch(layerInputs, width, layerOutputs, batchSize);
+        layerInputs = layerOutputs;
+        width = nextWidth;
     }
 
-    return weightsBiases;
+    if (layers == 0)
+        std::copy(inputs, inputs + (size_t)batchSize * width, outputs);
 }
 
 
-void Network::updateWeightsBiases(const std::vector<std::vector<BiasesWeights>>& accumulatedGrad, double learningRate)
+int Network::inputSize() const
 {
-    std::vector<BiasesWeights> average = calculateAverageGradients(accumulatedGrad);
-    std::reverse(average.begin(), average.end());
-
-    // for (int i = 0; i < average.size(); i++)
-    // {
-    //     for (int j = 0; j < average[i].biases.size(); j++)
-    //     {
-    //         printf("average[%d].biases[%d]: %.6f\n", i, j, average[i].biases[j]);
-    //     }
-
-    //     for (int j = 0; j < average[i].weights.size(); j++)
-    //     {
-    //         for (int k = 0; k < average[i].weights[j].size(); k++)
-    //         {
-    //             printf("average[%d].weights[%d][%d]: %.6f\n", i, j, k, average[i].weights[j][k]);
-    //         }
-    //     }
-    // }
-
-    int averageIndex = 0;
-    if (average.size() == 0) return;
-
-    if (static_cast<int>(average.size()) != standardLayerCount)
+    for (const std::shared_ptr<Layer>& layer : Layers)
     {
-        printf("Error: Number of layers in the network does not match the number of weights and biases provided.\n");
-        return;
+        if (layer->expectedInputWidth() > 0)
+            return layer->expectedInputWidth();
     }
 
-    for (size_t i = 0; i < Layers.size(); i++)
+    return 0;
+}
+
+
+int Network::outputSize(size_t layers) const
+{
+    int width = inputSize();
+
+    for (size_t i = 0; i < std::min(layers, Layers.size()); i++)
+        width = Layers[i]->outputWidth(width);
+
+    return width;
+}
+
+
+void Network::backwardPropagationBatch(BatchWorkspace& workspace) const
+{
+    int last = Layers.size() - 1;
+
+    ActivationLayer* activationLayer = dynamic_cast<ActivationLayer*>(Layers[last].get());
+    if (activationLayer != nullptr && activationLayer->activationFunction == ActivationType::SOFTMAX)
+        last--;
+
+    workspace.gradients.resize(Layers.size());
+    workspace.error = workspace.lossPrime;
+
+    for (int i = last; i >= 0; i--)
     {
-        // Identify the type of layer using the polymorphic method getType
-        if (Layers[i]->getType() == LayerType::StandardLayer)
-        {
-            Layers[i]->Layer::updateWeightsBiases(learningRate, average[averageIndex].weights, average[averageIndex].biases);
-            averageIndex++;
-        }
+        const std::vector<double>& layerInputs = (i == 0) ? workspace.inputs : workspace.activations[i - 1];
 
-        if (averageIndex > static_cast<int>(average.size())) break;
+        // The first layer has no previous layer to propagate the error to
+        Layers[i]->backwardBatch(layerInputs, workspace.activations[i], workspace.error,
+                                 workspace.inputError, workspace.gradients[i], workspace.batchSize, i > 0);
+
+        std::swap(workspace.error, workspace.inputError);
     }
 }
 
 
-std::vector<BiasesWeights> Network::calculateAverageGradients(const std::vector<std::vector<BiasesWeights>>& accumulatedGrad)
+void Network::updateWeightsBiases(const BatchWorkspace& workspace, double learningRate, long step)
 {
-    std::vector<BiasesWeights> average = accumulatedGrad[0];
-    int batchSize = accumulatedGrad.size();
+    if (workspace.batchSize == 0) return;
 
-    for (size_t i = 1; i < accumulatedGrad.size(); i++)
+    for (size_t i = 0; i < Layers.size(); i++)
     {
-        for (size_t j = 0; j < accumulatedGrad[i].size(); j++)
-        {
-            for (size_t k = 0; k < accumulatedGrad[i][j].biases.size(); k++)
-            {
-                average[j].biases[k] += accumulatedGrad[i][j].biases[k];
-            }
-
-            for (size_t k = 0; k < accumulatedGrad[i][j].weights.size(); k++)
-            {
-                for (size_t l = 0; l < accumulatedGrad[i][j].weights[k].size(); l++)
-                {
-                    average[j].weights[k][l] += accumulatedGrad[i][j].weights[k][l];
-                }
-            }
-        }
+        if (Layers[i]->hasParameters())
+            Layers[i]->applyOptimizer(workspace.gradients[i], optimizer, learningRate, 1.0 / workspace.batchSize, step);
     }
+}
+
 
-    for (size_t i = 0; i < average.size(); i++)
+void Network::prepareOptimizer()
+{
+    for (const std::shared_ptr<Layer>& layer : Layers)
     {
-        for (size_t j = 0; j < average[i].biases.size(); j++)
-        {
-            average[i].biases[j] /= batchSize;
-        }
+        if (layer->hasParameters())
+            layer->prepareOptimizer(optimizer);
+    }
+}
 
-        for (size_t j = 0; j < average[i].weights.size(); j++)
-        {
-            for (size_t k = 0; k < average[i].weights[j].size(); k++)
-            {
-                average[i].weights[j][k] /= batchSize;
-            }
-        }
+
+void Network::prune(double sparsity)
+{
+    for (const std::shared_ptr<Layer>& layer : Layers)
+    {
+        if (layer->hasParameters())
+            layer->prune(sparsity);
     }
+}
+
 
-    return average;
-}
\ No newline at end of file
+void Network::quantize(WeightQuantization type)
+{
+    for (const std::shared_ptr<Layer>& layer : Layers)
+    {
+        if (layer->getType() == LayerType::StandardLayer)
+            layer->quantize(type);
+    }
+}
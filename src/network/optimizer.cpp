@@ -0,0 +1,136 @@
+#include "optimizer.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+
+void optimizerStep(const OptimizerSettings& settings, double learningRate, double gradientScale, long step, bool decay,
+                   const double* gradients, double* parameters, double* firstMoment, double* secondMoment, size_t size)
+{
+    const double lr = learningRate;
+    const double s = gradientScale;
+
+    switch (settings.type)
+    {
+        case OptimizerType::SGD:
+        {
+            const double scaledLr = lr * s;
+            for (size_t i = 0; i < size; i++)
+                parameters[i] -= scaledLr * gradients[i];
+            break;
+        }
+
+        case OptimizerType::MOMENTUM:
+        {
+            const double mu = settings.momentum;
+            for (size_t i = 0; i < size; i++)
+            {
+                double v = mu * firstMoment[i] + s * gradients[i];
+                firstMoment[i] = v;
+                parameters[i] -= lr * v;
+            }
+            break;
+        }
+
+        case OptimizerType::NESTEROV:
+        {
+            const double mu = settings.momentum;
+            for (size_t i = 0; i < size; i++)
+            {
+                double g = s * gradients[i];
+                double v = mu * firstMoment[i] + g;
+                firstMoment[i] = v;
+                parameters[i] -= lr * (g + mu * v);
+            }
+            break;
+        }
+
+        case OptimizerType::ADAM:
+        case OptimizerType::ADAMW:
+        {
+            const double b1 = settings.beta1;
+            const double b2 = settings.beta2;
+            const double eps = settings.epsilon;
+
+            // Bias corrections of the moments
+            const double c1 = 1.0 / (1.0 - std::pow(b1, (double)step));
+            const double c2 = 1.0 / (1.0 - std::pow(b2, (double)step));
+
+            // Decoupled weight decay, folded in as a multiplicative shrink of the parameter
+            const double shrink = (settings.type == OptimizerType::ADAMW && decay) ? 1.0 - lr * settings.weightDecay : 1.0;
+
+            for (size_t i = 0; i < size; i++)
+            {
+                double g = s * gradients[i];
+                double m = b1 * firstMoment[i] + (1.0 - b1) * g;
+                double v = b2 * secondMoment[i] + (1.0 - b2) * g * g;
+                firstMoment[i] = m;
+                secondMoment[i] = v;
+                parameters[i] = shrink * parameters[i] - lr * (m * c1) / (std::sqrt(v * c2) + eps);
+            }
+            break;
+        }
+
+        default:
+            printf("Error: Invalid optimizer.\n");
+            break;
+    }
+}
+
+
+int optimizerStateBuffers(OptimizerType type)
+{
+    switch (type)
+    {
+        case OptimizerType::MOMENTUM:
+        case OptimizerType::NESTEROV:
+            return 1;
+
+        case OptimizerType::ADAM:
+        case OptimizerType::ADAMW:
+            return 2;
+
+        default:
+            return 0;
+    }
+}
+
+
+std::string OptimizerTypeToString(OptimizerType type)
+{
+    switch (type)
+    {
+        case OptimizerType::SGD:
+            return "(SGD) Stochastic Gradient Descent";
+
+        case OptimizerType::MOMENTUM:
+            return "(Momentum) SGD with Momentum";
+
+        case OptimizerType::NESTEROV:
+            return "(Nesterov) SGD with Nesterov Momentum";
+
+        case OptimizerType::ADAM:
+            return "(Adam) Adaptive Moment Estimation";
+
+        case OptimizerType::ADAMW:
+            return "(AdamW) Adam with Decoupled Weight Decay";
+
+        default:
+            return "None";
+    }
+}
+
+
+OptimizerType stringToOptimizerType(const std::string& name)
+{
+    std::string lower = name;
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+
+    if (lower == "sgd") return OptimizerType::SGD;
+    if (lower == "momentum") return OptimizerType::MOMENTUM;
+    if (lower == "nesterov") return OptimizerType::NESTEROV;
+    if (lower == "adam") return OptimizerType::ADAM;
+    if (lower == "adamw") return OptimizerType::ADAMW;
+
+    return OptimizerType::INVALID;
+}
@@ -0,0 +1,117 @@
+#include "pruning.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <numeric>
+
+#include "network.hpp"
+
+
+// Number of calibration samples run through the network at once
+static constexpr int CALIBRATION_BATCH = 64;
+
+
+std::vector<double> neuronScores(const Network& net, size_t layer, NeuronRanking ranking, const std::vector<double>& calibration, int samples)
+{
+    const Layer& hidden = *net.Layers[layer];
+    std::vector<double> scores(hidden.outputSize, 0.0);
+
+    if (ranking == NeuronRanking::NORM)
+    {
+        for (int i = 0; i < hidden.outputSize; i++)
+        {
+            const double* row = hidden.weights.data() + (size_t)i * hidden.inputSize;
+            scores[i] = std::sqrt(std::inner_product(row, row + hidden.inputSize, row, 0.0));
+        }
+        return scores;
+    }
+
+    // The activations seen by the next standard layer
+    size_t layers = layer + 1;
+    while (layers < net.Layers.size() && net.Layers[layers]->getType() == LayerType::ActivationLayer)
+        layers++;
+
+    int inputSize = net.inputSize();
+    BatchWorkspace workspace;
+    std::vector<double> outputs((size_t)CALIBRATION_BATCH * hidden.outputSize);
+
+    for (int first = 0; first < samples; first += CALIBRATION_BATCH)
+    {
+        int count = std::min(CALIBRATION_BATCH, samples - first);
+        net.forwardPropagationBatch(calibration.data() + (size_t)first * inputSize, count, outputs.data(), workspace, layers);
+
+        for (int n = 0; n < count; n++)
+        {
+            const double* row = outputs.data() + (size_t)n * hidden.outputSize;
+            for (int i = 0; i < hidden.outputSize; i++)
+                scores[i] += std::abs(row[i]);
+        }
+    }
+
+    for (double& score : scores)
+        score /= std::max(1, samples);
+
+    return scores;
+}
+
+
+bool shrinkHiddenLayers(Network& net, const std::vector<int>& sizes, NeuronRanking ranking, const std::vector<double>& calibration, int samples)
+{
+    std::vector<size_t> hidden = net.hiddenLayers();
+    if (sizes.size() != hidden.size())
+        return false;
+
+    for (size_t h = 0; h < hidden.size(); h++)
+    {
+        size_t layer = hidden[h];
+        int neurons = net.Layers[layer]->outputSize;
+        if (sizes[h] < 1 || sizes[h] > neurons)
+            return false;
+
+        if (sizes[h] == neurons)
+            continue;
+
+        std::vector<double> scores = neuronScores(net, layer, ranking, calibration, samples);
+
+        // The best ranked neurons, kept in their original order
+        std::vector<int> kept(neurons);
+        std::iota(kept.begin(), kept.end(), 0);
+        std::stable_sort(kept.begin(), kept.end(), [&](int a, int b) { return scores[a] > scores[b]; });
+        kept.resize(sizes[h]);
+        std::sort(kept.begin(), kept.end());
+
+        if (!net.keepNeurons(layer, kept))
+            return false;
+    }
+
+    return true;
+}
+
+
+std::string NeuronRankingToString(NeuronRanking ranking)
+{
+    switch (ranking)
+    {
+        case NeuronRanking::NORM:
+            return "Weight Norm";
+
+        case NeuronRanking::ACTIVATION:
+            return "Mean Activation";
+
+        default:
+            return "None";
+    }
+}
+
+
+NeuronRanking stringToNeuronRanking(const std::string& name)
+{
+    std::string lower = name;
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+
+    if (lower == "norm") return NeuronRanking::NORM;
+    if (lower == "activation") return NeuronRanking::ACTIVATION;
+
+    return NeuronRanking::INVALID;
+}
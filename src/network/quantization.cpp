@@ -0,0 +1,232 @@
+#include "quantization.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+
+// Number of samples whose tables are interleaved, so every lookup adds a whole block
+static constexpr int SAMPLE_BLOCK = 8;
+
+// Inputs per group: every group tabulates the 16 sums of its subsets
+static constexpr int GROUP_SIZE = 4;
+static constexpr int SUBSETS = 1 << GROUP_SIZE;
+static constexpr int GROUPS_PER_WORD = 64 / GROUP_SIZE;
+
+// Words of the rows whose tables are built at once (16 KB of tables for a block of samples)
+static constexpr int WORDS_PER_TILE = 1;
+
+// Fraction of the mean magnitude under which a ternary weight is 0
+static constexpr double TERNARY_THRESHOLD = 0.7;
+
+// Index of the lowest set bit of every subset: sum(v) = sum(v without that bit) + that input
+static constexpr int LOWEST_BIT[SUBSETS] = { 0, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0 };
+
+
+void quantizeWeights(const double* latent, int rows, int cols, WeightQuantization type, PackedWeights& packed, std::vector<double>& dense)
+{
+    bool ternary = type == WeightQuantization::TERNARY;
+
+    packed.type = type;
+    packed.rows = rows;
+    packed.cols = cols;
+    packed.words = (cols + 63) / 64;
+    packed.positive.assign((size_t)rows * packed.words, 0);
+    packed.negative.assign(ternary ? (size_t)rows * packed.words : 0, 0);
+    packed.scales.resize(rows);
+    dense.resize((size_t)rows * cols);
+
+    for (int r = 0; r < rows; r++)
+    {
+        const double* row = latent + (size_t)r * cols;
+        double* quantized = dense.data() + (size_t)r * cols;
+        uint64_t* positive = packed.positive.data() + (size_t)r * packed.words;
+        uint64_t* negative = ternary ? packed.negative.data() + (size_t)r * packed.words : nullptr;
+
+        double meanMagnitude = 0.0;
+        for (int c = 0; c < cols; c++)
+            meanMagnitude += std::abs(row[c]);
+        meanMagnitude /= std::max(1, cols);
+
+        // Binary: every weight is kept. Ternary: only the weights above the threshold
+        double threshold = ternary ? TERNARY_THRESHOLD * meanMagnitude : -1.0;
+        double kept = 0.0;
+        int count = 0;
+        for (int c = 0; c < cols; c++)
+        {
+            if (std::abs(row[c]) > threshold)
+            {
+                kept += std::abs(row[c]);
+                count++;
+            }
+        }
+        double scale = count > 0 ? kept / count : 0.0;
+        packed.scales[r] = scale;
+
+        for (int c = 0; c < cols; c++)
+        {
+            uint64_t bit = uint64_t(1) << (c % 64);
+            if (ternary && std::abs(row[c]) <= threshold)
+                quantized[c] = 0.0;
+            else if (row[c] >= 0.0)
+            {
+                positive[c / 64] |= bit;
+                quantized[c] = scale;
+            }
+            else
+            {
+                if (ternary)
+                    negative[c / 64] |= bit;
+                quantized[c] = -scale;
+            }
+        }
+    }
+}
+
+
+/**
+ * Adds (or subtracts) to the running sums of a block the table entries selected by the bits of
+ * a row, 4 bits (one group) per entry.
+ */
+template <int LANES, bool SUBTRACT>
+static inline void addSelected(const double* table, const uint64_t* bits, int words, double* sums)
+{
+    // Two sets of partial sums, so consecutive additions do not wait for each other
+    double even[LANES] = {}, odd[LANES] = {};
+
+    for (int w = 0; w < words; w++)
+    {
+        uint64_t word = bits[w];
+        const double* groups = table + (size_t)w * GROUPS_PER_WORD * SUBSETS * LANES;
+
+        for (int g = 0; g < GROUPS_PER_WORD; g += 2)
+        {
+            const double* a = groups + ((size_t)g * SUBSETS + ((word >> (g * GROUP_SIZE)) & (SUBSETS - 1))) * LANES;
+            const double* b = groups + ((size_t)(g + 1) * SUBSETS + ((word >> ((g + 1) * GROUP_SIZE)) & (SUBSETS - 1))) * LANES;
+            for (int s = 0; s < LANES; s++)
+            {
+                even[s] += a[s];
+                odd[s] += b[s];
+            }
+        }
+    }
+
+    for (int s = 0; s < LANES; s++)
+        sums[s] += SUBTRACT ? -(even[s] + odd[s]) : even[s] + odd[s];
+}
+
+
+/**
+ * Computes the outputs of the samples of a block, the inputs of sample s being X[s x cols].
+ *
+ * The tables of the block are interleaved (the SUBSETS x LANES entries of a group are contiguous)
+ * and built one tile of words at a time, small enough to stay in the L1 cache while every row
+ * adds its entries to its running sums.
+ */
+template <int LANES>
+static void packedBlock(const PackedWeights& W, const double* X, int samples, double* Y, std::vector<double>& table, std::vector<double>& sums)
+{
+    bool ternary = W.type == WeightQuantization::TERNARY;
+    table.resize((size_t)WORDS_PER_TILE * GROUPS_PER_WORD * SUBSETS * LANES);
+    sums.assign((size_t)W.rows * LANES, 0.0);
+
+    // Sum of the inputs, for the binary rows: Σ₋ = Σ - Σ₊
+    double totals[LANES] = {};
+
+    for (int firstWord = 0; firstWord < W.words; firstWord += WORDS_PER_TILE)
+    {
+        int words = std::min(WORDS_PER_TILE, W.words - firstWord);
+
+        for (int g = 0; g < words * GROUPS_PER_WORD; g++)
+        {
+            // The inputs of the group, one lane per sample, 0 past the last input or the last sample
+            double inputs[GROUP_SIZE][LANES] = {};
+            for (int k = 0; k < GROUP_SIZE; k++)
+            {
+                int c = (firstWord * GROUPS_PER_WORD + g) * GROUP_SIZE + k;
+                if (c >= W.cols)
+                    break;
+                for (int s = 0; s < samples; s++)
+                {
+                    inputs[k][s] = X[(size_t)s * W.cols + c];
+                    totals[s] += inputs[k][s];
+                }
+            }
+
+            double* entries = table.data() + (size_t)g * SUBSETS * LANES;
+            std::fill(entries, entries + LANES, 0.0);
+            for (int v = 1; v < SUBSETS; v++)
+            {
+                const double* smaller = entries + (size_t)(v & (v - 1)) * LANES;
+                const double* input = inputs[LOWEST_BIT[v]];
+                for (int s = 0; s < LANES; s++)
+                    entries[(size_t)v * LANES + s] = smaller[s] + input[s];
+            }
+        }
+
+        for (int r = 0; r < W.rows; r++)
+        {
+            double* sum = sums.data() + (size_t)r * LANES;
+            addSelected<LANES, false>(table.data(), W.positive.data() + (size_t)r * W.words + firstWord, words, sum);
+            if (ternary)
+                addSelected<LANES, true>(table.data(), W.negative.data() + (size_t)r * W.words + firstWord, words, sum);
+        }
+    }
+
+    for (int r = 0; r < W.rows; r++)
+    {
+        const double* sum = sums.data() + (size_t)r * LANES;
+        for (int s = 0; s < samples; s++)
+            Y[(size_t)s * W.rows + r] = W.scales[r] * (ternary ? sum[s] : 2.0 * sum[s] - totals[s]);
+    }
+}
+
+
+void packedGemm(const PackedWeights& W, const double* X, int batchSize, double* Y)
+{
+    thread_local std::vector<double> table;
+    thread_local std::vector<double> sums;
+
+    if (batchSize == 1)
+    {
+        packedBlock<1>(W, X, 1, Y, table, sums);
+        return;
+    }
+
+    for (int first = 0; first < batchSize; first += SAMPLE_BLOCK)
+    {
+        int samples = std::min(SAMPLE_BLOCK, batchSize - first);
+        packedBlock<SAMPLE_BLOCK>(W, X + (size_t)first * W.cols, samples, Y + (size_t)first * W.rows, table, sums);
+    }
+}
+
+
+std::string WeightQuantizationToString(WeightQuantization type)
+{
+    switch (type)
+    {
+        case WeightQuantization::NONE:
+            return "None (fp64)";
+
+        case WeightQuantization::BINARY:
+            return "Binary";
+
+        case WeightQuantization::TERNARY:
+            return "Ternary";
+
+        default:
+            return "None";
+    }
+}
+
+
+WeightQuantization stringToWeightQuantization(const std::string& name)
+{
+    std::string lower = name;
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+
+    if (lower == "binary") return WeightQuantization::BINARY;
+    if (lower == "ternary") return WeightQuantization::TERNARY;
+
+    return WeightQuantization::INVALID;
+}
@@ -0,0 +1,167 @@
+#include "sparse.hpp"
+
+#include <algorithm>
+
+
+// Number of samples multiplied by every non-zero value at once
+static constexpr int SAMPLE_BLOCK = 8;
+
+
+SparseMatrix denseToSparse(const double* dense, int rows, int cols)
+{
+    SparseMatrix sparse;
+    denseToSparse(dense, rows, cols, sparse);
+    return sparse;
+}
+
+
+void denseToSparse(const double* dense, int rows, int cols, SparseMatrix& sparse)
+{
+    sparse.rows = rows;
+    sparse.cols = cols;
+    sparse.rowStart.clear();
+    sparse.columns.clear();
+    sparse.values.clear();
+    sparse.rowStart.reserve((size_t)rows + 1);
+    sparse.rowStart.push_back(0);
+
+    for (int r = 0; r < rows; r++)
+    {
+        const double* row = dense + (size_t)r * cols;
+        for (int c = 0; c < cols; c++)
+        {
+            if (row[c] != 0.0)
+            {
+                sparse.columns.push_back(c);
+                sparse.values.push_back(row[c]);
+            }
+        }
+        sparse.rowStart.push_back((int)sparse.values.size());
+    }
+}
+
+
+void applySparsityPattern(SparseMatrix& sparse, double* dense)
+{
+    for (int r = 0; r < sparse.rows; r++)
+    {
+        double* row = dense + (size_t)r * sparse.cols;
+        int next = 0;
+
+        for (int k = sparse.rowStart[r]; k < sparse.rowStart[r + 1]; k++)
+        {
+            int c = sparse.columns[k];
+            std::fill(row + next, row + c, 0.0);
+            sparse.values[k] = row[c];
+            next = c + 1;
+        }
+
+        std::fill(row + next, row + sparse.cols, 0.0);
+    }
+}
+
+
+void spmv(const SparseMatrix& A, const double* x, double* y)
+{
+    const int* columns = A.columns.data();
+    const double* values = A.values.data();
+
+    for (int r = 0; r < A.rows; r++)
+    {
+        double sum = 0.0;
+        for (int k = A.rowStart[r]; k < A.rowStart[r + 1]; k++)
+            sum += values[k] * x[columns[k]];
+        y[r] = sum;
+    }
+}
+
+
+void spmm(const SparseMatrix& A, const double* X, int batchSize, double* Y)
+{
+    if (batchSize == 1)
+    {
+        spmv(A, X, Y);
+        return;
+    }
+
+    // Block of samples stored column by column: block[c x SAMPLE_BLOCK + s] = X[s][c]
+    thread_local std::vector<double> block;
+    block.resize((size_t)A.cols * SAMPLE_BLOCK);
+
+    const int* columns = A.columns.data();
+    const double* values = A.values.data();
+
+    for (int first = 0; first < batchSize; first += SAMPLE_BLOCK)
+    {
+        int samples = std::min(SAMPLE_BLOCK, batchSize - first);
+
+        // The missing samples of the last block are zeros, their sums are dropped
+        for (int c = 0; c < A.cols; c++)
+        {
+            double* lane = block.data() + (size_t)c * SAMPLE_BLOCK;
+            for (int s = 0; s < samples; s++)
+                lane[s] = X[(size_t)(first + s) * A.cols + c];
+            for (int s = samples; s < SAMPLE_BLOCK; s++)
+                lane[s] = 0.0;
+        }
+
+        for (int r = 0; r < A.rows; r++)
+        {
+            double sums[SAMPLE_BLOCK] = {};
+
+            for (int k = A.rowStart[r]; k < A.rowStart[r + 1]; k++)
+            {
+                const double value = values[k];
+                const double* lane = block.data() + (size_t)columns[k] * SAMPLE_BLOCK;
+                for (int s = 0; s < SAMPLE_BLOCK; s++)
+                    sums[s] += value * lane[s];
+            }
+
+            for (int s = 0; s < samples; s++)
+                Y[(size_t)(first + s) * A.rows + r] = sums[s];
+        }
+    }
+}
+
+
+void gatherRows(const SparseMatrix& X, const double* B, int cols, double* Y)
+{
+    const int* columns = X.columns.data();
+    const double* values = X.values.data();
+
+    for (int r = 0; r < X.rows; r++)
+    {
+        double* y = Y + (size_t)r * cols;
+        std::fill(y, y + cols, 0.0);
+
+        for (int k = X.rowStart[r]; k < X.rowStart[r + 1]; k++)
+        {
+            const double value = values[k];
+            const double* row = B + (size_t)columns[k] * cols;
+            for (int j = 0; j < cols; j++)
+                y[j] += value * row[j];
+        }
+    }
+}
+
+
+void scatterRows(const SparseMatrix& X, const double* E, int cols, double* Y)
+{
+    const int* columns = X.columns.data();
+    const double* values = X.values.data();
+
+    std::fill(Y, Y + (size_t)X.cols * cols, 0.0);
+
+    for (int r = 0; r < X.rows; r++)
+    {
+        const double* e = E + (size_t)r * cols;
+
+        for (int k = X.rowStart[r]; k < X.rowStart[r + 1]; k++)
+        {
+            const double value = values[k];
+            double* row = Y + (size_t)columns[k] * cols;
+            for (int j = 0; j < cols; j++)
+                row[j] += value * e[j];
+        }
+    }
+}
@@ -0,0 +1,137 @@
+#include "prune.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "test.hpp"
+#include "saveToJson.hpp"
+#include "benchmark.hpp"
+
+
+/**
+ * Results of the network at one pruning level.
+ */
+struct PruningLevelResult
+{
+    double level = 0.0;
+    std::string layout;
+    size_t parameters = 0;
+    double accuracy = 0.0;
+    double loss = 0.0;
+    double sampleUs = 0.0;
+    double batchUs = 0.0;
+    std::string checkpoint;
+};
+
+
+int networkPruneNeurons(Network &net, Arguments &inputParams)
+{
+    std::vector<size_t> hidden = net.hiddenLayers();
+    if (hidden.empty())
+    {
+        printf("[ERROR]: The network has no hidden layer whose neurons can be removed.\n");
+        return 1;
+    }
+
+    Dataset dataset;
+    if (!loadDataset(dataset, inputParams.TestDatasetImages))
+        return 1;
+
+    // The first testing images time the networks
+    int samples = std::min(dataset.size(), CALIBRATION_SAMPLES);
+    std::vector<uint32_t> indices(samples);
+    std::iota(indices.begin(), indices.end(), 0);
+    std::vector<double> timing;
+    fillBatch(dataset, indices.data(), samples, timing);
+
+    // The neurons are ranked on training images, the testing images are only used to report the levels
+    Dataset calibrationSet;
+    std::vector<double> calibration;
+    int calibrationSamples = 0;
+    if (inputParams.neuronRanking == NeuronRanking::ACTIVATION)
+    {
+        size_t count = std::min(inputParams.TrainDatasetImages.size(), CALIBRATION_SAMPLES);
+        std::vector<std::string> calibrationImages(inputParams.TrainDatasetImages.begin(), inputParams.TrainDatasetImages.begin() + count);
+        if (!loadDataset(calibrationSet, calibrationImages))
+            return 1;
+
+        calibrationSamples = calibrationSet.size();
+        indices.resize(calibrationSamples);
+        std::iota(indices.begin(), indices.end(), 0);
+        fillBatch(calibrationSet, indices.data(), calibrationSamples, calibration);
+    }
+
+    std::vector<int> originalSizes;
+    for (size_t layer : hidden)
+        originalSizes.push_back(net.Layers[layer]->outputSize);
+
+    // The unpruned network is the reference, the levels only remove more and more neurons
+    std::vector<double> levels = inputParams.pruneNeuronLevels;
+    levels.push_back(0.0);
+    std::sort(levels.begin(), levels.end());
+    levels.erase(std::unique(levels.begin(), levels.end()), levels.end());
+
+    std::vector<PruningLevelResult> results;
+    for (double level : levels)
+    {
+        std::vector<int> sizes;
+        for (int size : originalSizes)
+            sizes.push_back(std::max(1, (int)std::lround((1.0 - level) * size)));
+
+        if (!shrinkHiddenLayers(net, sizes, inputParams.neuronRanking, calibration, calibrationSamples))
+        {
+            printf("[ERROR]: Could not remove %.1f%% of the hidden neurons.\n", 100.0 * level);
+            return 1;
+        }
+
+        PruningLevelResult result;
+        result.level = level;
+        result.layout = networkLayout(net);
+
+        for (const std::shared_ptr<Layer>& layer : net.Layers)
+            result.parameters += layer->weights.size() + layer->biases.size();
+
+        std::vector<TestResult> tested = evaluateDataset(net, dataset);
+        for (const TestResult& sample : tested)
+        {
+            result.accuracy += sample.trueValue == sample.predictedValue;
+            result.loss += sample.loss;
+        }
+        result.accuracy = 100.0 * result.accuracy / std::max<size_t>(tested.size(), 1);
+        result.loss /= std::max<size_t>(tested.size(), 1);
+
+        result.sampleUs = forwardLatencyUs(net, timing, samples, 1);
+        result.batchUs = forwardLatencyUs(net, timing, samples, TEST_BATCH_SIZE);
+
+        if (level > 0.0)
+            result.checkpoint = WeightsBiasesToJSON(net);
+
+        results.push_back(result);
+    }
+
+    printf("\n");
+    printCentered(" STRUCTURED PRUNING ", '*');
+    printf("\n");
+    std::cout << "- Ranking:                     " << NeuronRankingToString(inputParams.neuronRanking);
+    if (calibrationSamples > 0)
+        std::cout << " (on " << calibrationSamples << " training images)";
+    std::cout << std::endl;
+    std::cout << "- Testing images:              " << dataset.size() << " (" << samples << " to time)" << "\n" << std::endl;
+
+    std::string batchHeader = "us/image (" + std::to_string(TEST_BATCH_SIZE) + ")";
+    printf("%8s  %-14s %10s %9s %9s %12s %12s %8s  %s\n", "Removed", "Layers", "Params", "Accuracy", "Loss",
+           "us/image (1)", batchHeader.c_str(), "Speedup", "Checkpoint");
+
+    for (const PruningLevelResult& result : results)
+    {
+        printf("%7.1f%%  %-14s %10zu %8.2f%% %9.5f %12.3f %12.3f %7.2fx  %s\n", 100.0 * result.level, result.layout.c_str(), result.parameters,
+               result.accuracy, result.loss, result.sampleUs, result.batchUs,
+               result.sampleUs > 0.0 ? results[0].sampleUs / result.sampleUs : 0.0, result.checkpoint.empty() ? "-" : result.checkpoint.c_str());
+    }
+
+    printf("\n");
+    printHorizontalLine('*');
+
+    return 0;
+}
@@ -0,0 +1,142 @@
+#include "scheduler.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+
+LearningRateScheduler::LearningRateScheduler(const ScheduleSettings& settings, double baseLearningRate, int epochs)
+{
+    this->settings = settings;
+    this->baseLearningRate = baseLearningRate;
+    this->epochs = epochs;
+}
+
+
+double LearningRateScheduler::learningRate(int epoch, int batch, int batchesPerEpoch) const
+{
+    double rate = baseLearningRate;
+
+    switch (settings.schedule)
+    {
+        case LearningRateSchedule::STEP:
+            if (settings.stepSize > 0)
+                rate *= std::pow(settings.gamma, epoch / settings.stepSize);
+            break;
+
+        case LearningRateSchedule::COSINE:
+        {
+            // The cosine starts after the warmup and reaches zero at the end of the last epoch
+            int decayEpochs = std::max(1, epochs - settings.warmupEpochs);
+            double progress = (epoch - settings.warmupEpochs + (double)batch / std::max(1, batchesPerEpoch)) / decayEpochs;
+            progress = std::min(1.0, std::max(0.0, progress));
+            rate *= 0.5 * (1.0 + std::cos(M_PI * progress));
+            break;
+        }
+
+        case LearningRateSchedule::PLATEAU:
+            rate *= plateauScale;
+            break;
+
+        default:
+            break;
+    }
+
+    if (settings.warmupEpochs > 0 && epoch < settings.warmupEpochs)
+    {
+        long warmupBatches = (long)settings.warmupEpochs * std::max(1, batchesPerEpoch);
+        long currentBatch = (long)epoch * std::max(1, batchesPerEpoch) + batch + 1;
+        rate *= (double)currentBatch / warmupBatches;
+    }
+
+    return rate;
+}
+
+
+void LearningRateScheduler::endOfEpoch(double monitoredLoss)
+{
+    if (settings.schedule != LearningRateSchedule::PLATEAU)
+        return;
+
+    if (monitoredLoss < bestLoss)
+    {
+        bestLoss = monitoredLoss;
+        epochsWithoutImprovement = 0;
+        return;
+    }
+
+    epochsWithoutImprovement++;
+    if (epochsWithoutImprovement >= settings.plateauPatience)
+    {
+        plateauScale *= settings.gamma;
+        epochsWithoutImprovement = 0;
+        printf(">> Loss on a plateau, learning rate reduced to %g\n\n", baseLearningRate * plateauScale);
+    }
+}
+
+
+EarlyStopping::EarlyStopping(int patience)
+{
+    this->patience = patience;
+}
+
+
+bool EarlyStopping::update(double monitoredLoss)
+{
+    if (monitoredLoss < best)
+    {
+        best = monitoredLoss;
+        epochsWithoutImprovement = 0;
+        return true;
+    }
+
+    epochsWithoutImprovement++;
+    return false;
+}
+
+
+bool EarlyStopping::shouldStop() const
+{
+    return patience > 0 && epochsWithoutImprovement >= patience;
+}
+
+
+double EarlyStopping::bestLoss() const
+{
+    return best;
+}
+
+
+std::string LearningRateScheduleToString(LearningRateSchedule schedule)
+{
+    switch (schedule)
+    {
+        case LearningRateSchedule::CONSTANT:
+            return "Constant";
+
+        case LearningRateSchedule::STEP:
+            return "Step Decay";
+
+        case LearningRateSchedule::COSINE:
+            return "Cosine Annealing";
+
+        case LearningRateSchedule::PLATEAU:
+            return "Reduce on Plateau";
+
+        default:
+            return "None";
+    }
+}
+
+
+LearningRateSchedule stringToLearningRateSchedule(const std::string& name)
+{
+    std::string lower = name;
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+
+    if (lower == "constant") return LearningRateSchedule::CONSTANT;
+    if (lower == "step") return LearningRateSchedule::STEP;
+    if (lower == "cosine") return LearningRateSchedule::COSINE;
+    if (lower == "plateau") return LearningRateSchedule::PLATEAU;
+
+    return LearningRateSchedule::INVALID;
+}
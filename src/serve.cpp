@@ -0,0 +1,507 @@
+#include "serve.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+
+// Milliseconds between two checks of the stop flag by the waiting threads
+static constexpr int SERVE_POLL_MS = 200;
+
+// Seconds a response may block on a client that does not read before the client is dropped
+static constexpr int SERVE_SEND_TIMEOUT_SECONDS = 1;
+
+// Set by SIGINT/SIGTERM
+static volatile sig_atomic_t stopRequested = 0;
+
+
+static void requestStop(int)
+{
+    stopRequested = 1;
+}
+
+
+/**
+ * A client of the server. It is shared by its reading thread and by its queued requests, so its
+ * descriptors stay open until its last response is written.
+ */
+struct ServeClient
+{
+    int inputFd = -1;
+    int outputFd = -1;
+    bool ownsDescriptors = false;
+    std::atomic<bool> broken{false};
+
+    ~ServeClient()
+    {
+        if (ownsDescriptors)
+            close(inputFd);
+    }
+};
+
+
+/**
+ * A decoded request, waiting for its batch. `pixels` is empty if the payload could not be decoded.
+ */
+struct ServeRequest
+{
+    std::shared_ptr<ServeClient> client;
+    std::vector<uint8_t> pixels;
+    std::chrono::steady_clock::time_point arrival;
+};
+
+
+/**
+ * The latencies, in microseconds, of the requests answered between `start` and `end`.
+ */
+struct LatencyWindow
+{
+    std::vector<double> latencies;
+    size_t batches = 0;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point end;
+};
+
+
+/**
+ * The state shared by the threads of the server.
+ */
+struct ServerState
+{
+    int inputSize = 0;
+    FILE* log = stdout;
+
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<ServeRequest> queue;
+    int activeReaders = 0;
+};
+
+
+/**
+ * Waits until `fd` can be read, checking the stop flag. Returns false if the server is stopping.
+ */
+static bool waitReadable(int fd)
+{
+    while (!stopRequested)
+    {
+        pollfd descriptor = { fd, POLLIN, 0 };
+        int ready = poll(&descriptor, 1, SERVE_POLL_MS);
+
+        if (ready > 0)
+            return true;
+        if (ready < 0 && errno != EINTR)
+            return false;
+    }
+
+    return false;
+}
+
+
+/**
+ * Reads exactly `size` bytes. Returns false at the end of the stream, on error or if the server is stopping.
+ */
+static bool readFully(int fd, void* buffer, size_t size)
+{
+    uint8_t* bytes = static_cast<uint8_t*>(buffer);
+
+    while (size > 0)
+    {
+        if (!waitReadable(fd))
+            return false;
+
+        ssize_t count = read(fd, bytes, size);
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count <= 0)
+            return false;
+
+        bytes += count;
+        size -= count;
+    }
+
+    return true;
+}
+
+
+/**
+ * Writes exactly `size` bytes. Returns false if the client is gone or does not read its responses.
+ */
+static bool writeFully(int fd, const void* buffer, size_t size)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(buffer);
+
+    while (size > 0)
+    {
+        ssize_t count = write(fd, bytes, size);
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count <= 0)
+            return false;
+
+        bytes += count;
+        size -= count;
+    }
+
+    return true;
+}
+
+
+/**
+ * Turns a payload into the 8-bit pixels of one input. Raw pixels are moved, not copied.
+ */
+static bool decodeRequest(std::vector<uint8_t>& payload, int inputSize, std::vector<uint8_t>& pixels)
+{
+    if ((int)payload.size() == inputSize)
+    {
+        pixels.swap(payload);
+        return true;
+    }
+
+    cv::Mat image = cv::imdecode(payload, cv::IMREAD_GRAYSCALE);
+    if (image.empty() || (int)image.total() != inputSize)
+        return false;
+
+    pixels.resize(inputSize);
+    for (int r = 0; r < image.rows; r++)
+        std::copy(image.ptr<uint8_t>(r), image.ptr<uint8_t>(r) + image.cols, pixels.data() + (size_t)r * image.cols);
+
+    return true;
+}
+
+
+/**
+ * Reads the requests of a client until it disconnects, decodes them and queues them for the batching thread.
+ */
+static void readRequests(ServerState& state, std::shared_ptr<ServeClient> client)
+{
+    std::vector<uint8_t> payload;
+    uint32_t length;
+
+    while (readFully(client->inputFd, &length, sizeof(length)))
+    {
+        if (length > SERVE_MAX_REQUEST_BYTES)
+        {
+            fprintf(state.log, "[SERVE] Error: Request of %u bytes refused, the client is disconnected.\n", length);
+            break;
+        }
+
+        payload.resize(length);
+        if (!readFully(client->inputFd, payload.data(), length))
+            break;
+
+        ServeRequest request;
+        request.client = client;
+        request.arrival = std::chrono::steady_clock::now();
+        if (!decodeRequest(payload, state.inputSize, request.pixels))
+            request.pixels.clear();
+
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            state.queue.push_back(std::move(request));
+        }
+        state.ready.notify_one();
+    }
+
+    // Notified under the lock: the server may be destroyed as soon as the last reader is done
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.activeReaders--;
+    state.ready.notify_one();
+}
+
+
+/**
+ * Starts the reading thread of a client.
+ */
+static void startReader(ServerState& state, std::shared_ptr<ServeClient> client)
+{
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.activeReaders++;
+    }
+
+    std::thread(readRequests, std::ref(state), std::move(client)).detach();
+}
+
+
+/**
+ * Creates the listening Unix domain socket. A stale socket of a previous run is replaced.
+ */
+static int openServerSocket(const std::string& path, FILE* log)
+{
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        fprintf(log, "[SERVE] Error: The socket path is too long: %s\n", path.c_str());
+        return -1;
+    }
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    struct stat info;
+    if (stat(path.c_str(), &info) == 0 && S_ISSOCK(info.st_mode))
+        unlink(path.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0)
+    {
+        fprintf(log, "[SERVE] Error: Could not listen on %s: %s\n", path.c_str(), strerror(errno));
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+
+/**
+ * Accepts the clients of the socket until the server is stopped.
+ */
+static void acceptClients(ServerState& state, int serverFd)
+{
+    while (waitReadable(serverFd))
+    {
+        int clientFd = accept(serverFd, nullptr, nullptr);
+        if (clientFd < 0)
+            continue;
+
+        // A client that stops reading its responses must not block the batches of the others
+        timeval timeout = { SERVE_SEND_TIMEOUT_SECONDS, 0 };
+        setsockopt(clientFd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        std::shared_ptr<ServeClient> client = std::make_shared<ServeClient>();
+        client->inputFd = clientFd;
+        client->outputFd = clientFd;
+        client->ownsDescriptors = true;
+
+        startReader(state, std::move(client));
+    }
+}
+
+
+/**
+ * Returns the value below which `rank` of the sorted values are (nearest rank).
+ */
+static double percentile(const std::vector<double>& sorted, double rank)
+{
+    size_t index = (size_t)std::ceil(rank * sorted.size());
+    return sorted[std::min(sorted.size(), std::max<size_t>(index, 1)) - 1];
+}
+
+
+static void reportLatencies(FILE* log, const char* title, const LatencyWindow& window)
+{
+    if (window.latencies.empty())
+        return;
+
+    std::vector<double> sorted = window.latencies;
+    std::sort(sorted.begin(), sorted.end());
+
+    double seconds = std::chrono::duration<double>(window.end - window.start).count();
+    double throughput = seconds > 0.0 ? sorted.size() / seconds : 0.0;
+
+    fprintf(log, "[SERVE] %s: %zu requests in %zu batches (%.1f per batch)   p50: %.1f us   p99: %.1f us   max: %.1f us   %.1f requests/s\n",
+            title, sorted.size(), window.batches, (double)sorted.size() / window.batches,
+            percentile(sorted, 0.50), percentile(sorted, 0.99), sorted.back(), throughput);
+    fflush(log);
+}
+
+
+/**
+ * Runs a micro-batch through the network and writes the response of every request.
+ */
+static void runBatch(Network& net, ServerState& state, std::vector<ServeRequest>& batch, BatchWorkspace& workspace,
+                     std::vector<uint8_t>& response, LatencyWindow& window, LatencyWindow& total)
+{
+    // Only the decoded requests go through the network
+    size_t valid = 0;
+    workspace.inputs.resize(batch.size() * (size_t)state.inputSize);
+    for (const ServeRequest& request : batch)
+    {
+        if (!request.pixels.empty())
+            normalizePixels(request.pixels.data(), state.inputSize, workspace.inputs.data() + valid++ * state.inputSize);
+    }
+
+    const double* outputs = nullptr;
+    uint32_t outputSize = 0;
+    if (valid > 0)
+    {
+        workspace.batchSize = valid;
+        workspace.inputs.resize(valid * (size_t)state.inputSize);
+        const std::vector<double>& outputBatch = net.forwardPropagationBatch(workspace);
+        outputs = outputBatch.data();
+        outputSize = outputBatch.size() / valid;
+    }
+
+    size_t row = 0;
+    for (ServeRequest& request : batch)
+    {
+        int32_t predicted = -1;
+        uint32_t count = 0;
+        const double* output = nullptr;
+
+        if (!request.pixels.empty())
+        {
+            output = outputs + row++ * outputSize;
+            predicted = std::distance(output, std::max_element(output, output + outputSize));
+            count = outputSize;
+        }
+
+        response.resize(sizeof(predicted) + sizeof(count) + count * sizeof(double));
+        memcpy(response.data(), &predicted, sizeof(predicted));
+        memcpy(response.data() + sizeof(predicted), &count, sizeof(count));
+        if (count > 0)
+            memcpy(response.data() + sizeof(predicted) + sizeof(count), output, count * sizeof(double));
+
+        ServeClient& client = *request.client;
+        if (!client.broken && !writeFully(client.outputFd, response.data(), response.size()))
+        {
+            // Its next responses are dropped, its reader stops at the end of its stream
+            client.broken = true;
+            continue;
+        }
+
+        auto answered = std::chrono::steady_clock::now();
+        double latency = std::chrono::duration<double, std::micro>(answered - request.arrival).count();
+        window.latencies.push_back(latency);
+        total.latencies.push_back(latency);
+        window.end = total.end = answered;
+    }
+
+    window.batches++;
+    total.batches++;
+}
+
+
+int networkServe(Network &net, Arguments &inputParams)
+{
+    bool standardStreams = inputParams.servePath == "-";
+
+    ServerState state;
+    state.log = standardStreams ? stderr : stdout;
+
+    state.inputSize = net.inputSize();
+
+    size_t maxBatch = std::max(1, inputParams.serveBatch);
+    std::chrono::microseconds maxWait(std::max(0, inputParams.serveWaitUs));
+
+    // Stop cleanly on Ctrl-C, and survive the clients that disconnect before their response
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = requestStop;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    // Before any request: the first batch must not wait for the GEMM tuning, nor have its message in the responses
+    loadGemmTiling(state.log);
+
+    int serverFd = -1;
+    std::thread acceptor;
+
+    if (standardStreams)
+    {
+        std::shared_ptr<ServeClient> client = std::make_shared<ServeClient>();
+        client->inputFd = STDIN_FILENO;
+        client->outputFd = STDOUT_FILENO;
+        startReader(state, std::move(client));
+    }
+    else
+    {
+        serverFd = openServerSocket(inputParams.servePath, state.log);
+        if (serverFd < 0)
+            return 1;
+        acceptor = std::thread(acceptClients, std::ref(state), serverFd);
+    }
+
+    fprintf(state.log, "[SERVE] Listening on %s (input: %d values, batches of up to %zu requests, waiting at most %lld us)\n",
+            standardStreams ? "the standard input" : inputParams.servePath.c_str(), state.inputSize, maxBatch, (long long)maxWait.count());
+    fflush(state.log);
+
+    BatchWorkspace workspace;
+    std::vector<ServeRequest> batch;
+    std::vector<uint8_t> response;
+    LatencyWindow window, total;
+    auto lastReport = std::chrono::steady_clock::now();
+    window.start = total.start = lastReport;
+    bool started = false;
+
+    while (true)
+    {
+        std::unique_lock<std::mutex> lock(state.mutex);
+        state.ready.wait_for(lock, std::chrono::milliseconds(SERVE_POLL_MS), [&]() {
+            return !state.queue.empty() || (state.activeReaders == 0 && (stopRequested || standardStreams));
+        });
+
+        if (state.queue.empty())
+        {
+            // Nothing left to answer and nobody left to ask
+            if (state.activeReaders == 0 && (stopRequested || standardStreams))
+                break;
+            continue;
+        }
+
+        // The throughput counts from the first request, not from the start of the server
+        if (!started)
+        {
+            window.start = total.start = state.queue.front().arrival;
+            started = true;
+        }
+
+        // Wait for a full batch, at most until the oldest request has waited maxWait
+        auto deadline = state.queue.front().arrival + maxWait;
+        while (state.queue.size() < maxBatch && !stopRequested && state.activeReaders > 0)
+        {
+            if (state.ready.wait_until(lock, deadline) == std::cv_status::timeout)
+                break;
+        }
+
+        size_t count = std::min(maxBatch, state.queue.size());
+        batch.clear();
+        std::move(state.queue.begin(), state.queue.begin() + count, std::back_inserter(batch));
+        state.queue.erase(state.queue.begin(), state.queue.begin() + count);
+        lock.unlock();
+
+        runBatch(net, state, batch, workspace, response, window, total);
+        batch.clear(); // Releases the clients of the batch
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastReport >= std::chrono::seconds(SERVE_REPORT_SECONDS))
+        {
+            reportLatencies(state.log, "Last interval", window);
+            window = LatencyWindow();
+            window.start = lastReport = now;
+        }
+    }
+
+    if (acceptor.joinable())
+        acceptor.join();
+    if (serverFd >= 0)
+    {
+        close(serverFd);
+        unlink(inputParams.servePath.c_str());
+    }
+
+    reportLatencies(state.log, "Total", total);
+    fprintf(state.log, "[SERVE] Stopped.\n");
+
+    return 0;
+}
@@ -1,32 +1,27 @@
 #include "test.hpp"
 
+#include <numeric>
+
 
 int networkTest(Network &net, Arguments &inputParams)
 {
     if (!inputParams.Test)
         return 0;
     
+    ClassificationMetrics metrics;
+    std::vector<TestResult> results = evaluateImages(net, inputParams.TestDatasetImages, &metrics);
+    if (results.size() != inputParams.TestDatasetImages.size())
+        return 1;
+
     int correct = 0;
     double averageLoss = 0.0;
 
-    for (size_t i = 0; i < inputParams.TestDatasetImages.size(); i++)
+    for (size_t i = 0; i < results.size(); i++)
     {
-        VectorLabel vecLabel;
-        imageToVectorAndLabel(vecLabel, inputParams.TestDatasetImages[i]);
-
-        std::vector<double> outputOput = net.forwardPropagation(vecLabel.imagePixelVector);
-        double lossValue = net.loss(vecLabel.labelVector, outputOput);;
-        averageLoss += lossValue;
-
-        auto max_element_iter = std::max_element(outputOput.begin(), outputOput.end());
-
-        int predictedLabel = 0;
-        if (max_element_iter != outputOput.end())
-            predictedLabel = std::distance(outputOput.begin(), max_element_iter);
-        
-        correct += (vecLabel.label == predictedLabel);
+        averageLoss += results[i].loss;
+        correct += (results[i].trueValue == results[i].predictedValue);
         
-        printSampleTestResults(inputParams.print, i, correct, inputParams.TestDatasetImages.size(), vecLabel.label, lossValue, predictedLabel);
+        printSampleTestResults(inputParams.print, i, correct, inputParams.TestDatasetImages.size(), results[i].trueValue, results[i].loss, results[i].predictedValue);
     }
 
     averageLoss /= inputParams.TestDatasetImages.size();
@@ -38,6 +33,8 @@ int networkTest(Network &net, Arguments &inputParams)
     if (!inputParams.print)
         finalResultPrinter(acc, averageLoss, correct, inputParams.TestDatasetImages.size(), title);
 
+    confusionMatrixPrinter(metrics);
+
     if (acc >= inputParams.bestAccuracy)
     {
         inputParams.bestAccuracy = acc;
@@ -49,6 +46,75 @@ int networkTest(Network &net, Arguments &inputParams)
 }
 
 
+std::vector<TestResult> evaluateImages(Network &net, const std::vector<std::string>& images, ClassificationMetrics* metrics)
+{
+    Dataset dataset;
+    if (!loadDataset(dataset, images))
+        return {};
+
+    std::vector<TestResult> results = evaluateDataset(net, dataset, metrics);
+    for (size_t i = 0; i < results.size(); i++)
+        results[i].imagePath = images[i];
+
+    return results;
+}
+
+
+std::vector<TestResult> evaluateDataset(Network &net, const Dataset& dataset, ClassificationMetrics* metrics)
+{
+    std::vector<TestResult> results(dataset.size());
+    int classes = net.outputSize();
+
+    // Every thread accumulates its own metrics, merged at the end
+    ThreadPool& pool = threadPool();
+    std::vector<ClassificationMetrics> threadMetrics(pool.size());
+    for (ClassificationMetrics& m : threadMetrics)
+        m.reset(classes, metrics != nullptr);
+
+    // The samples are split over the thread pool, each chunk runs in batches of its own
+    pool.parallelFor(0, results.size(), TEST_BATCH_SIZE, [&](size_t begin, size_t end)
+    {
+        BatchWorkspace workspace;
+        std::vector<uint32_t> indices(TEST_BATCH_SIZE);
+        std::vector<int> predictions(TEST_BATCH_SIZE);
+        workspace.losses.resize(TEST_BATCH_SIZE);
+        ClassificationMetrics& chunkMetrics = threadMetrics[pool.currentSlot()];
+
+        for (size_t first = begin; first < end; first += TEST_BATCH_SIZE)
+        {
+            size_t last = std::min(first + TEST_BATCH_SIZE, end);
+            std::iota(indices.begin(), indices.begin() + (last - first), (uint32_t)first);
+
+            workspace.batchSize = last - first;
+            fillBatch(dataset, indices.data(), last - first, workspace.inputs);
+
+            const std::vector<double>& outputBatch = net.forwardPropagationBatch(workspace);
+            size_t outputSize = outputBatch.size() / (last - first);
+
+            // Loss, prediction and confusion matrix in one pass, without any gradient work
+            evaluateBatch(net.lossFunction, outputBatch.data(), dataset.labels.data() + first, last - first, outputSize,
+                          chunkMetrics, workspace.losses.data(), predictions.data(), nullptr);
+
+            for (size_t n = first; n < last; n++)
+            {
+                results[n].trueValue = dataset.labels[n];
+                results[n].predictedValue = predictions[n - first];
+                results[n].loss = workspace.losses[n - first];
+            }
+        }
+    });
+
+    if (metrics != nullptr)
+    {
+        metrics->reset(classes, true);
+        for (const ClassificationMetrics& m : threadMetrics)
+            metrics->merge(m);
+    }
+
+    return results;
+}
+
+
 void weightsNetworkTest(Network &net, Arguments &inputParams, std::vector<std::string> jsonFiles)
 {
     for (size_t i = 0; i < jsonFiles.size(); i++)
@@ -57,9 +123,8 @@ void weightsNetworkTest(Network &net, Arguments &inputParams, std::vector<std::s
         infoPrinter(inputParams, net);
 
         inputParams.hasWeightsBiases = true;
-        std::vector<BiasesWeights> importedWeightsAndBiases;
-        weightsBiasExtractor(inputParams, importedWeightsAndBiases);
-        net.importWeightsBiases(importedWeightsAndBiases);
+        if (!net.importCheckpoint(inputParams.WeightsBiasesPath))
+            continue;
 
         printf(">> Testing model %zu/%ld\n", i+1, jsonFiles.size());
         printf("Prev Accuracy: %.2f%%\n", inputParams.bestAccuracy);
@@ -1,95 +1,228 @@
 #include "train.hpp"
 
-int networkTrain(Network &net, Arguments &inputParams)
+
+/**
+ * Sums the gradients and the statistics of a batch over all the training processes.
+ */
+static bool reduceBatch(Network &net, BatchWorkspace& workspace, TrainingStats& stats, std::vector<double>& buffer)
 {
-    if (!inputParams.Train)
+    buffer.clear();
+    for (const LayerGradients& gradients : workspace.gradients)
+    {
+        buffer.insert(buffer.end(), gradients.weights.begin(), gradients.weights.end());
+        buffer.insert(buffer.end(), gradients.biases.begin(), gradients.biases.end());
+    }
+
+    double logLoss = stats.samples > 0 ? stats.samples * std::log(stats.geometricMeanLoss) : 0.0;
+    buffer.insert(buffer.end(), { (double)stats.samples, stats.lossSum, logLoss, (double)stats.correct });
+
+    if (!processGroup().allReduce(buffer))
+        return false;
+
+    size_t offset = 0;
+    for (size_t l = 0; l < net.Layers.size(); l++)
+    {
+        LayerGradients& gradients = workspace.gradients[l];
+        std::copy(buffer.begin() + offset, buffer.begin() + offset + gradients.weights.size(), gradients.weights.begin());
+        offset += gradients.weights.size();
+        std::copy(buffer.begin() + offset, buffer.begin() + offset + gradients.biases.size(), gradients.biases.begin());
+        offset += gradients.biases.size();
+    }
+
+    stats.samples = (int)buffer[offset];
+    stats.lossSum = buffer[offset + 1];
+    stats.geometricMeanLoss = std::exp(buffer[offset + 2] / stats.samples);
+    stats.correct = (int)buffer[offset + 3];
+
+    // The update averages the gradients over the samples of all the processes
+    workspace.batchSize = stats.samples;
+
+    return true;
+}
+
+
+int startTrainingProcesses(Network &net, Arguments &inputParams, int argc, char **argv)
+{
+    if (!inputParams.Train || inputParams.processes <= 1)
         return 0;
 
-    // Shuffle the training data
-    auto rng = std::default_random_engine {};
-    
-    int totCorrect = 0;
-    double totalLoss = 0.0;
+    size_t parameters = 0;
+    for (const std::shared_ptr<Layer>& layer : net.Layers)
+        parameters += layer->weights.size() + layer->biases.size();
 
-    for (int i = 0; i < inputParams.epochs; i++)
+    ProcessGroup& group = processGroup();
+    if (!group.start(inputParams.processes, inputParams.rank, inputParams.processGroupName, parameters + REDUCED_STATS, argc, argv))
+        return 1;
+
+    // Every process starts from the seed and the weights of process 0
+    std::vector<double> values = { (double)inputParams.seed };
+    if (!group.broadcast(values))
+        return 1;
+
+    inputParams.seed = (unsigned int)values[0];
+    setGlobalSeed(inputParams.seed);
+
+    values.clear();
+    for (const std::shared_ptr<Layer>& layer : net.Layers)
     {
-        std::shuffle(inputParams.TrainDatasetImages.begin(), inputParams.TrainDatasetImages.end(), rng);
-        std::vector<std::vector<std::string>> batches = splitIntoBatches(inputParams.TrainDatasetImages, inputParams.batchSize);
+        values.insert(values.end(), layer->weights.begin(), layer->weights.end());
+        values.insert(values.end(), layer->biases.begin(), layer->biases.end());
+    }
 
-        double epochLossSum = 0.0;
-        int epochCorrectImagesCount = 0;
+    if (!group.broadcast(values))
+        return 1;
 
-        for(size_t m = 0; m < batches.size(); m++)
-        {
-            double batchLossSum = 0.0;
-            int batchCorrectImagesCount = 0;
+    size_t offset = 0;
+    for (const std::shared_ptr<Layer>& layer : net.Layers)
+    {
+        std::copy(values.begin() + offset, values.begin() + offset + layer->weights.size(), layer->weights.begin());
+        offset += layer->weights.size();
+        std::copy(values.begin() + offset, values.begin() + offset + layer->biases.size(), layer->biases.begin());
+        offset += layer->biases.size();
+
+        // The sparsity mask follows the weights of process 0
+        if (layer->isSparse())
+            layer->compressWeights();
+        if (layer->isQuantized())
+            layer->quantize(layer->packedWeights.type);
+        layer->transposeWeights();
+    }
+
+    return 0;
+}
 
-            double geometricMeanLoss = 1.0;
 
-            std::vector<std::vector<BiasesWeights>> accumulatedGrad;
-            
-            for (size_t n = 0; n < batches[m].size(); n++)
-            {
-                VectorLabel vecLabel;
-                imageToVectorAndLabel(vecLabel, batches[m][n]);
+int networkTrain(Network &net, Arguments &inputParams)
+{
+    if (!inputParams.Train)
+        return 0;
 
-                std::vector<double> outputOput = net.forwardPropagation(vecLabel.imagePixelVector);
+    ProcessGroup& group = processGroup();
+    bool mainProcess = group.rank() == 0;
 
-                // calculate loss
-                double lossValue = net.loss(vecLabel.labelVector, outputOput);
-                batchLossSum += lossValue;
-                geometricMeanLoss *= lossValue; // Multiply the losses
+    // The seed is final here (broadcast by process 0), so every process holds out the same images
+    splitValidationSet(inputParams);
 
-                // backward pass
-                std::vector<BiasesWeights> gradWeightsBiases = net.backwardPropagation(net.lossPrimeValue);
-                accumulatedGrad.push_back(gradWeightsBiases);
+    // Each process trains on its own shard of the images
+    std::vector<std::string> shardImages;
+    for (size_t n = group.rank(); n < inputParams.TrainDatasetImages.size(); n += group.size())
+        shardImages.push_back(inputParams.TrainDatasetImages[n]);
 
-                auto max_element_iter = std::max_element(outputOput.begin(), outputOput.end());
+    if (shardImages.empty())
+    {
+        printf("Error: The training dataset has fewer images than training processes\n");
+        return 1;
+    }
 
-                int predictedLabel = 0;
-                if (max_element_iter != outputOput.end())
-                    predictedLabel = std::distance(outputOput.begin(), max_element_iter);
+    // Decode the images once, the epochs work on a permutation of their indices
+    Dataset trainSet, validationSet;
+    if (!loadDataset(trainSet, shardImages) || (mainProcess && !loadDataset(validationSet, inputParams.ValidationDatasetImages)))
+        return 1;
 
-                batchCorrectImagesCount += (vecLabel.label == predictedLabel);
+    std::vector<uint32_t> permutation(trainSet.size());
+    std::iota(permutation.begin(), permutation.end(), 0);
 
-                // std::ostringstream ossAcc;
-                // ossAcc << std::fixed << std::setprecision(2) << 100.0 * ((double)batchCorrectImagesCount / batches[m].size());
+    // Shuffle the training data, every process with its own stream
+    std::mt19937_64 rng = rngStream(SHUFFLE_STREAM + group.rank());
 
-                // std::cout << ">>>> Epoch: " << i+1 << "/" << inputParams.epochs;
-                // std::cout << "     Batch: " << m+1 << "/" << batches.size();
-                // std::cout << "     Sample: " << n+1 << "/" << batches[m].size();
-                // std::cout << "     Loss: " << lossValue;
-                // std::cout << "     Batch Accuracy: " << ossAcc.str();
-                // std::cout << "%     Predicted: " << predictedLabel;
-                // std::cout << "     True: " << vecLabel.label << "\n" << std::endl;
-            }
+    // The processes run the same number of batches, sized on the largest shard
+    size_t largestShard = (inputParams.TrainDatasetImages.size() + group.size() - 1) / group.size();
+    std::vector<double> reduceBuffer;
 
-            epochLossSum += batchLossSum;
-            epochCorrectImagesCount += batchCorrectImagesCount;
+    int totCorrect = 0;
+    double totalLoss = 0.0;
+    int epochsRun = 0;
 
-            // calculate average loss
-            // double averageLoss = batchLossSum / batches[m].size();
-            double batchAccuracy = 100.0 * ((double)batchCorrectImagesCount / batches[m].size());
-            geometricMeanLoss = std::pow(geometricMeanLoss, 1.0 / batches[m].size());
+    // Reused by every batch
+    BatchWorkspace workspace;
 
-            std::ostringstream ossAcc;
-            ossAcc << std::fixed << std::setprecision(2) << batchAccuracy;
+    // Allocated before any Hogwild worker can update the layers
+    net.prepareOptimizer();
 
-            std::cout << ">>> Epoch: " << i+1 << "/" << inputParams.epochs;
-            std::cout << "     Batch: " << m+1 << "/" << batches.size();
-            std::cout << "     Average Loss: " << geometricMeanLoss;
-            std::cout << "     Batch Accuracy: " << ossAcc.str();
-            std::cout << "%     Predicted Correctly: " << batchCorrectImagesCount << "/" << batches[m].size() << "\n" << std::endl;
+    LearningRateScheduler scheduler(inputParams.schedule, inputParams.learningRate, inputParams.epochs);
+    EarlyStopping earlyStopping(inputParams.patience);
+    std::vector<BiasesWeights> bestWeightsBiases;
 
-            // update weights and biases
-            net.updateWeightsBiases(accumulatedGrad, inputParams.learningRate);
+    for (int i = 0; i < inputParams.epochs; i++)
+    {
+        std::shuffle(permutation.begin(), permutation.end(), rng);
+        size_t batchCount = (largestShard + inputParams.batchSize - 1) / inputParams.batchSize;
+
+        double epochLossSum = 0.0;
+        int epochCorrectImagesCount = 0;
+
+        if (inputParams.asyncWorkers > 0)
+        {
+            // Hogwild: the workers update the weights as they go, save them once per epoch
+            TrainingStats epochStats = trainEpochHogwild(net, inputParams, trainSet, permutation, i, scheduler);
+            epochLossSum = epochStats.lossSum;
+            epochCorrectImagesCount = epochStats.correct;
 
             std::string jsonPath = WeightsBiasesToJSON(net);
-            // printf(">> Weights and biases saved to: %s\n\n", jsonPath.c_str());
+        }
+        else
+        {
+            for(size_t m = 0; m < batchCount; m++)
+            {
+                // The batch is a slice of the permutation
+                size_t first = m * inputParams.batchSize;
+                size_t count = first < permutation.size() ? std::min((size_t)inputParams.batchSize, permutation.size() - first) : 0;
+
+                TrainingStats batchStats;
+                if (count > 0)
+                {
+                    batchStats = trainBatch(net, trainSet, permutation.data() + first, count, workspace);
+                }
+                else
+                {
+                    // A smaller shard ran out of samples, it only takes part in the reduction
+                    for (LayerGradients& gradients : workspace.gradients)
+                    {
+                        std::fill(gradients.weights.begin(), gradients.weights.end(), 0.0);
+                        std::fill(gradients.biases.begin(), gradients.biases.end(), 0.0);
+                    }
+                }
+
+                if (group.size() > 1)
+                {
+                    if (!reduceBatch(net, workspace, batchStats, reduceBuffer))
+                    {
+                        printf("Error: Could not exchange the gradients with the other training processes\n");
+                        return 1;
+                    }
+                    count = batchStats.samples;
+                }
+
+                epochLossSum += batchStats.lossSum;
+                epochCorrectImagesCount += batchStats.correct;
+
+                // calculate average loss
+                // double averageLoss = batchStats.lossSum / count;
+                double batchAccuracy = 100.0 * ((double)batchStats.correct / count);
+                double learningRate = scheduler.learningRate(i, m, batchCount);
+
+                std::ostringstream ossAcc;
+                ossAcc << std::fixed << std::setprecision(2) << batchAccuracy;
+
+                std::cout << ">>> Epoch: " << i+1 << "/" << inputParams.epochs;
+                std::cout << "     Batch: " << m+1 << "/" << batchCount;
+                std::cout << "     Average Loss: " << batchStats.geometricMeanLoss;
+                std::cout << "     Batch Accuracy: " << ossAcc.str();
+                std::cout << "%     Predicted Correctly: " << batchStats.correct << "/" << count;
+                std::cout << "     LR: " << learningRate << "\n" << std::endl;
+
+                // update weights and biases
+                net.updateWeightsBiases(workspace, learningRate);
+
+                if (mainProcess)
+                    std::string jsonPath = WeightsBiasesToJSON(net);
+                // printf(">> Weights and biases saved to: %s\n\n", jsonPath.c_str());
+            }
         }
 
         totalLoss += epochLossSum;
         totCorrect += epochCorrectImagesCount;
+        epochsRun++;
 
         double averageLoss = epochLossSum / inputParams.TrainDatasetImages.size();
         double batchAccuracy = 100.0 * ((double)epochCorrectImagesCount / inputParams.TrainDatasetImages.size());
@@ -100,33 +233,256 @@ int networkTrain(Network &net, Arguments &inputParams)
         std::cout << ">> Epoch: " << i+1 << "/" << inputParams.epochs;
         std::cout << "     Average Loss: " << averageLoss;
         std::cout << "     Accuracy: " << ossAcc.str();
-        std::cout << "%     Predicted Correctly: " << epochCorrectImagesCount << "/" << inputParams.TrainDatasetImages.size() << "\n" << std::endl;
+        std::cout << "%     Predicted Correctly: " << epochCorrectImagesCount << "/" << inputParams.TrainDatasetImages.size();
+
+        // Without a validation split the training loss drives the schedule and the early stopping
+        double monitoredLoss = averageLoss;
+
+        if (mainProcess && validationSet.size() > 0)
+        {
+            TrainingStats validationStats = validateNetwork(net, validationSet);
+            monitoredLoss = validationStats.lossSum / validationStats.samples;
+
+            std::ostringstream ossValAcc;
+            ossValAcc << std::fixed << std::setprecision(2) << 100.0 * ((double)validationStats.correct / validationStats.samples);
+
+            std::cout << "     Validation Loss: " << monitoredLoss;
+            std::cout << "     Validation Accuracy: " << ossValAcc.str() << "%";
+        }
+        std::cout << "\n" << std::endl;
+
+        // The schedule and the early stopping of every process follow the loss seen by process 0
+        std::vector<double> loss = { monitoredLoss };
+        if (!group.broadcast(loss))
+        {
+            printf("Error: Could not exchange the loss with the other training processes\n");
+            return 1;
+        }
+        monitoredLoss = loss[0];
+
+        scheduler.endOfEpoch(monitoredLoss);
+
+        if (earlyStopping.update(monitoredLoss))
+        {
+            if (inputParams.patience > 0)
+                bestWeightsBiases = net.saveWeightsBiases();
+        }
+        else if (earlyStopping.shouldStop())
+        {
+            printf(">> No improvement for %d epochs, stopping early. Restoring the weights of the best epoch (loss %g).\n\n", inputParams.patience, earlyStopping.bestLoss());
+
+            net.importWeightsBiases(bestWeightsBiases);
+            if (mainProcess)
+                WeightsBiasesToJSON(net);
+            break;
+        }
     }
 
     std::string title = " TRAINING RESULTS ";
-    double lossToPrint = (totalLoss / inputParams.TrainDatasetImages.size()*inputParams.epochs);
-    double acc = 100.0 * ((double)totCorrect / (inputParams.TrainDatasetImages.size()*inputParams.epochs));
+    double lossToPrint = totalLoss / (inputParams.TrainDatasetImages.size() * epochsRun);
+    double acc = 100.0 * ((double)totCorrect / (inputParams.TrainDatasetImages.size()*epochsRun));
+
+    finalResultPrinter(acc, lossToPrint, totCorrect, inputParams.TrainDatasetImages.size()*epochsRun, title);
 
-    finalResultPrinter(acc, lossToPrint, totCorrect, inputParams.TrainDatasetImages.size()*inputParams.epochs, title);
+    // Wait for the other training processes to exit
+    group.finish();
 
     return 0;
 }
 
 
-std::vector<std::vector<std::string>> splitIntoBatches(const std::vector<std::string>& inputVec, int batchSize)
+TrainingStats validateNetwork(Network &net, const Dataset& dataset)
+{
+    std::vector<TestResult> results = evaluateDataset(net, dataset);
+
+    TrainingStats stats;
+    stats.samples = results.size();
+
+    for (const TestResult& result : results)
+    {
+        stats.lossSum += result.loss;
+        stats.correct += (result.trueValue == result.predictedValue);
+    }
+
+    return stats;
+}
+
+
+/**
+ * Runs the forward and backward pass of some samples of the dataset in a single thread.
+ */
+static TrainingStats trainShard(Network &net, const Dataset& dataset, const uint32_t* indices, size_t samples, BatchWorkspace& workspace)
+{
+    TrainingStats stats;
+    stats.samples = samples;
+    stats.batches = 1;
+
+    // Copy the samples, one image per row
+    workspace.batchSize = samples;
+    fillBatch(dataset, indices, samples, workspace.inputs);
+
+    workspace.labels.resize(samples);
+    for (size_t n = 0; n < samples; n++)
+        workspace.labels[n] = dataset.labels[indices[n]];
+
+    const std::vector<double>& outputBatch = net.forwardPropagationBatch(workspace);
+    size_t outputSize = outputBatch.size() / samples;
+    workspace.lossPrime.resize(outputBatch.size());
+    workspace.losses.resize(samples);
+
+    // Loss, derivative and accuracy in a single pass over the outputs
+    ClassificationMetrics metrics;
+    metrics.reset(outputSize, false);
+    evaluateBatch(net.lossFunction, outputBatch.data(), workspace.labels.data(), samples, outputSize,
+                  metrics, workspace.losses.data(), nullptr, workspace.lossPrime.data());
+
+    stats.lossSum = metrics.lossSum;
+    stats.correct = metrics.correct;
+
+    for (size_t n = 0; n < samples; n++)
+        stats.geometricMeanLoss *= workspace.losses[n]; // Multiply the losses
+
+    stats.geometricMeanLoss = std::pow(stats.geometricMeanLoss, 1.0 / samples);
+
+    // backward pass
+    net.backwardPropagationBatch(workspace);
+
+    return stats;
+}
+
+
+TrainingStats trainBatch(Network &net, const Dataset& dataset, const uint32_t* indices, size_t count, BatchWorkspace& workspace)
+{
+    ThreadPool& pool = threadPool();
+    size_t shardCount = std::min((size_t)pool.size(), count / MIN_SHARD_SAMPLES);
+
+    if (shardCount <= 1)
+        return trainShard(net, dataset, indices, count, workspace);
+
+    // Split the batch in shards of about the same size
+    workspace.shards.resize(shardCount);
+    std::vector<TrainingStats> shardStats(shardCount);
+    TaskGroup group;
+
+    for (size_t s = 0; s < shardCount; s++)
+    {
+        size_t first = count * s / shardCount;
+        size_t last = count * (s + 1) / shardCount;
+
+        // Shard s always goes to the same thread, whose buffers stay on its NUMA node
+        pool.submit(group, [&, s, first, last]()
+        {
+            shardStats[s] = trainShard(net, dataset, indices + first, last - first, workspace.shards[s]);
+        }, s);
+    }
+    pool.wait(group);
+
+    // Sum the gradients of the shards, always in the same order
+    workspace.batchSize = count;
+    workspace.gradients.resize(net.Layers.size());
+
+    for (size_t l = 0; l < net.Layers.size(); l++)
+    {
+        LayerGradients& total = workspace.gradients[l];
+        total.weights.resize(workspace.shards[0].gradients[l].weights.size());
+        total.biases.resize(workspace.shards[0].gradients[l].biases.size());
+
+        pool.parallelFor(0, total.weights.size(), 4096, [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                double sum = 0.0;
+                for (size_t s = 0; s < shardCount; s++)
+                    sum += workspace.shards[s].gradients[l].weights[i];
+                total.weights[i] = sum;
+            }
+        });
+
+        for (size_t i = 0; i < total.biases.size(); i++)
+        {
+            double sum = 0.0;
+            for (size_t s = 0; s < shardCount; s++)
+                sum += workspace.shards[s].gradients[l].biases[i];
+            total.biases[i] = sum;
+        }
+    }
+
+    TrainingStats stats;
+    double logLossSum = 0.0;
+
+    for (size_t s = 0; s < shardCount; s++)
+    {
+        stats.lossSum += shardStats[s].lossSum;
+        stats.correct += shardStats[s].correct;
+        stats.samples += shardStats[s].samples;
+        logLossSum += shardStats[s].samples * std::log(shardStats[s].geometricMeanLoss);
+    }
+
+    stats.batches = 1;
+    stats.geometricMeanLoss = std::exp(logLossSum / stats.samples);
+
+    return stats;
+}
+
+
+TrainingStats trainEpochHogwild(Network &net, Arguments &inputParams, const Dataset& dataset, const std::vector<uint32_t>& permutation, int epoch, const LearningRateScheduler& scheduler)
 {
-    std::vector<std::vector<std::string>> batches;
-    int totalSize = inputVec.size();
+    int workers = inputParams.asyncWorkers;
+    size_t batchSize = inputParams.batchSize;
+    size_t batchCount = (permutation.size() + batchSize - 1) / batchSize;
+    std::atomic<size_t> nextBatch(0);
+    std::vector<TrainingStats> workerStats(workers);
+    ThreadPool& pool = threadPool();
+    TaskGroup group;
+
+    for (int w = 0; w < workers; w++)
+    {
+        pool.submit(group, [&, w]()
+        {
+            BatchWorkspace workspace;
+
+            // Each worker draws the next batch and applies its update straight away.
+            // The races on the shared weights are intentional (Hogwild).
+            for (size_t m = nextBatch++; m < batchCount; m = nextBatch++)
+            {
+                size_t count = std::min(batchSize, permutation.size() - m * batchSize);
 
-    for (int i = 0; i < totalSize; i += batchSize)
+                TrainingStats batchStats = trainShard(net, dataset, permutation.data() + m * batchSize, count, workspace);
+
+                // The step comes from the batch, the shared optimiser state is only read and written in place
+                long step = (long)epoch * batchCount + m + 1;
+                net.updateWeightsBiases(workspace, scheduler.learningRate(epoch, m, batchCount), step);
+
+                workerStats[w].lossSum += batchStats.lossSum;
+                workerStats[w].correct += batchStats.correct;
+                workerStats[w].samples += batchStats.samples;
+                workerStats[w].batches++;
+            }
+        });
+    }
+
+    pool.wait(group);
+
+    TrainingStats epochStats;
+    for (int w = 0; w < workers; w++)
     {
-        // Define the end iterator, making sure not to go past the end of the input vector
-        int end = std::min(i + batchSize, totalSize);
-        // Create a new batch from the current position (i) to the end
-        std::vector<std::string> batch(inputVec.begin() + i, inputVec.begin() + end);
-        // Add the batch to the list of batches
-        batches.push_back(batch);
+        double workerAccuracy = workerStats[w].samples > 0 ? 100.0 * ((double)workerStats[w].correct / workerStats[w].samples) : 0.0;
+
+        std::ostringstream ossAcc;
+        ossAcc << std::fixed << std::setprecision(2) << workerAccuracy;
+
+        std::cout << ">>> Epoch: " << epoch+1 << "/" << inputParams.epochs;
+        std::cout << "     Worker: " << w+1 << "/" << workers;
+        std::cout << "     Batches: " << workerStats[w].batches;
+        std::cout << "     Average Loss: " << (workerStats[w].samples > 0 ? workerStats[w].lossSum / workerStats[w].samples : 0.0);
+        std::cout << "     Accuracy: " << ossAcc.str();
+        std::cout << "%     Predicted Correctly: " << workerStats[w].correct << "/" << workerStats[w].samples << "\n" << std::endl;
+
+        epochStats.lossSum += workerStats[w].lossSum;
+        epochStats.correct += workerStats[w].correct;
+        epochStats.samples += workerStats[w].samples;
+        epochStats.batches += workerStats[w].batches;
     }
 
-    return batches;
-}
\ No newline at end of file
+    return epochStats;
+}
@@ -0,0 +1,190 @@
+#include "benchmark.hpp"
+
+#include "test.hpp"
+#include "dataset.hpp"
+
+
+int inferenceBenchmark(Network &net, Arguments &inputParams)
+{
+    if (!inputParams.benchmark)
+        return 0;
+
+    // The weights take ~800KB, too much for the stack
+    std::unique_ptr<DeployedNetwork> fixedNet = std::make_unique<DeployedNetwork>();
+    if (!fixedNet->importFromNetwork(net))
+    {
+        printf("[ERROR]: The network does not match the compile-time topology. Benchmark skipped.\n");
+        return 1;
+    }
+
+    std::vector<VectorLabel> samples(inputParams.TestDatasetImages.size());
+    for (size_t i = 0; i < samples.size(); i++)
+    {
+        if (!imageToVectorAndLabel(samples[i], inputParams.TestDatasetImages[i]))
+            return 1;
+    }
+
+    int runs = std::max(1, inputParams.benchmarkRuns);
+    double checksum = 0.0;
+    double maxDifference = 0.0;
+    int mismatchedPredictions = 0;
+
+    // Warm up both paths and compare their outputs
+    for (size_t i = 0; i < samples.size(); i++)
+    {
+        std::vector<double> runtimeOutput = net.forwardPropagation(samples[i].imagePixelVector);
+        std::array<double, DeployedNetwork::outputSize> fixedOutput = fixedNet->forwardPropagation(samples[i].imagePixelVector.data());
+
+        for (int j = 0; j < DeployedNetwork::outputSize; j++)
+            maxDifference = std::max(maxDifference, std::abs(runtimeOutput[j] - fixedOutput[j]));
+
+        mismatchedPredictions += std::distance(runtimeOutput.begin(), std::max_element(runtimeOutput.begin(), runtimeOutput.end())) !=
+                                 std::distance(fixedOutput.begin(), std::max_element(fixedOutput.begin(), fixedOutput.end()));
+    }
+
+    auto runtimeStart = std::chrono::steady_clock::now();
+    for (int r = 0; r < runs; r++)
+    {
+        for (size_t i = 0; i < samples.size(); i++)
+            checksum += net.forwardPropagation(samples[i].imagePixelVector)[0];
+    }
+    auto runtimeEnd = std::chrono::steady_clock::now();
+
+    std::array<double, DeployedNetwork::outputSize> fixedOutput;
+    for (int r = 0; r < runs; r++)
+    {
+        for (size_t i = 0; i < samples.size(); i++)
+        {
+            fixedNet->forwardPropagation(samples[i].imagePixelVector.data(), fixedOutput.data());
+            checksum += fixedOutput[0];
+        }
+    }
+    auto fixedEnd = std::chrono::steady_clock::now();
+
+    double totalImages = static_cast<double>(runs) * samples.size();
+    double runtimeUs = std::chrono::duration<double, std::micro>(runtimeEnd - runtimeStart).count() / totalImages;
+    double fixedUs = std::chrono::duration<double, std::micro>(fixedEnd - runtimeEnd).count() / totalImages;
+
+    printf("\n");
+    printCentered(" INFERENCE BENCHMARK ", '*');
+    printf("\n");
+    std::cout << "- Images x runs:               " << samples.size() << " x " << runs << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "- Runtime Network:             " << runtimeUs << " us/image   " << 1e6 / runtimeUs << " images/s" << std::endl;
+    std::cout << "- Fixed Network:               " << fixedUs << " us/image   " << 1e6 / fixedUs << " images/s" << std::endl;
+    std::cout << "- Speedup:                     " << runtimeUs / fixedUs << "x" << std::endl;
+    std::cout << std::scientific << std::setprecision(3);
+    std::cout << "- Max output difference:       " << maxDifference << std::endl;
+    std::cout << std::defaultfloat;
+    std::cout << "- Mismatched predictions:      " << mismatchedPredictions << "/" << samples.size() << std::endl;
+    std::cout << "- Checksum:                    " << checksum << "\n" << std::endl;
+    printHorizontalLine('*');
+
+    return 0;
+}
+
+
+std::string networkLayout(const Network& net)
+{
+    std::string layout = std::to_string(net.inputSize());
+    for (const std::shared_ptr<Layer>& layer : net.Layers)
+    {
+        if (layer->getType() == LayerType::StandardLayer)
+            layout += "-" + std::to_string(layer->outputSize);
+    }
+    return layout;
+}
+
+
+double forwardLatencyUs(const Network& net, const std::vector<double>& inputs, int samples, int batchSize)
+{
+    BatchWorkspace workspace;
+    std::vector<double> outputs((size_t)batchSize * net.outputSize());
+    int inputSize = net.inputSize();
+    int usedSamples = samples - samples % batchSize;
+    if (usedSamples == 0)
+        return 0.0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < LATENCY_RUNS; r++)
+    {
+        for (int first = 0; first < usedSamples; first += batchSize)
+            net.forwardPropagationBatch(inputs.data() + (size_t)first * inputSize, batchSize, outputs.data(), workspace);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::micro>(end - start).count() / ((double)LATENCY_RUNS * usedSamples);
+}
+
+
+int quantizationReport(Network &net, Arguments &inputParams)
+{
+    if (inputParams.quantization == WeightQuantization::NONE)
+        return 0;
+
+    Dataset dataset;
+    if (!loadDataset(dataset, inputParams.TestDatasetImages))
+        return 1;
+
+    int samples = dataset.size();
+    std::vector<uint32_t> indices(samples);
+    for (int i = 0; i < samples; i++)
+        indices[i] = i;
+    std::vector<double> inputs;
+    fillBatch(dataset, indices.data(), samples, inputs);
+
+    printf("\n");
+    printCentered(" QUANTIZATION ", '*');
+    printf("\n");
+    std::string batchHeader = "images/s (" + std::to_string(TEST_BATCH_SIZE) + ")";
+    printf("%-12s %9s %9s %12s %12s %14s %14s %11s\n", "Weights", "Accuracy", "Loss", "us/image (1)", "images/s (1)",
+           batchHeader.c_str(), "Speedup (1/64)", "Storage");
+
+    double referenceSampleUs = 0.0, referenceBatchUs = 0.0;
+    for (WeightQuantization type : { WeightQuantization::NONE, inputParams.quantization })
+    {
+        net.quantize(type);
+
+        std::vector<TestResult> tested = evaluateDataset(net, dataset);
+        double accuracy = 0.0, loss = 0.0;
+        for (const TestResult& sample : tested)
+        {
+            accuracy += sample.trueValue == sample.predictedValue;
+            loss += sample.loss;
+        }
+        accuracy = 100.0 * accuracy / std::max<size_t>(tested.size(), 1);
+        loss /= std::max<size_t>(tested.size(), 1);
+
+        size_t storage = 0;
+        for (const std::shared_ptr<Layer>& layer : net.Layers)
+        {
+            if (layer->getType() == LayerType::StandardLayer)
+                storage += layer->isQuantized() ? layer->packedWeights.storageBytes() : layer->weights.size() * sizeof(double);
+        }
+
+        double sampleUs = forwardLatencyUs(net, inputs, samples, 1);
+        double batchUs = forwardLatencyUs(net, inputs, samples, TEST_BATCH_SIZE);
+        if (type == WeightQuantization::NONE)
+        {
+            referenceSampleUs = sampleUs;
+            referenceBatchUs = batchUs;
+        }
+
+        std::string speedup = "-";
+        if (type != WeightQuantization::NONE && sampleUs > 0.0 && batchUs > 0.0)
+        {
+            char buffer[32];
+            snprintf(buffer, sizeof(buffer), "%.1fx / %.1fx", referenceSampleUs / sampleUs, referenceBatchUs / batchUs);
+            speedup = buffer;
+        }
+
+        std::string name = type == WeightQuantization::NONE ? "fp64" : WeightQuantizationToString(type);
+        printf("%-12s %8.2f%% %9.5f %12.3f %12.0f %14.0f %14s %8.1f KB\n", name.c_str(), accuracy, loss, sampleUs,
+               sampleUs > 0.0 ? 1e6 / sampleUs : 0.0, batchUs > 0.0 ? 1e6 / batchUs : 0.0, speedup.c_str(), storage / 1024.0);
+    }
+
+    printf("\n");
+    printHorizontalLine('*');
+
+    return 0;
+}
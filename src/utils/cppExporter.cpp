@@ -0,0 +1,275 @@
+#include "cppExporter.hpp"
+
+#include <cctype>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+
+// Number of values per line of the generated arrays
+static constexpr int VALUES_PER_LINE = 8;
+
+
+/**
+ * Turns the name of a file into a valid C++ identifier.
+ */
+static std::string identifierFromPath(const std::string& path)
+{
+    std::string stem = std::filesystem::path(path).stem().string();
+    std::string identifier;
+
+    for (char c : stem)
+        identifier += std::isalnum(static_cast<unsigned char>(c)) ? c : '_';
+
+    if (identifier.empty() || std::isdigit(static_cast<unsigned char>(identifier[0])))
+        identifier = "model_" + identifier;
+
+    return identifier;
+}
+
+
+/**
+ * Writes an array of parameters with enough digits to read back the exact same doubles.
+ */
+static bool writeArray(std::ostream& out, const std::string& name, const std::vector<double>& values)
+{
+    out << "alignas(64) static constexpr double " << name << "[" << values.size() << "] = {";
+
+    char number[32];
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        if (!std::isfinite(values[i]))
+        {
+            printf("Error: %s holds a value that is not finite, the network cannot be exported.\n", name.c_str());
+            return false;
+        }
+
+        snprintf(number, sizeof(number), "%.17g", values[i]);
+        out << (i % VALUES_PER_LINE == 0 ? "\n    " : " ") << number << ",";
+    }
+
+    out << "\n};\n\n";
+    return true;
+}
+
+
+/**
+ * Writes the in-place activation of `size` values of the buffer `x`.
+ */
+static bool writeActivation(std::ostream& out, ActivationType activation, const std::string& x, int size)
+{
+    std::string loop = "    for (int o = 0; o < " + std::to_string(size) + "; o++)\n";
+
+    switch (activation)
+    {
+        case ActivationType::RELU:
+            out << "    // ReLU\n" << loop << "        " << x << "[o] = std::max(0.0, " << x << "[o]);\n\n";
+            return true;
+
+        case ActivationType::SIGMOID:
+            out << "    // Sigmoid\n" << loop << "        " << x << "[o] = 1.0 / (1.0 + std::exp(-" << x << "[o]));\n\n";
+            return true;
+
+        case ActivationType::TANH:
+            out << "    // Tanh\n" << loop << "        " << x << "[o] = std::tanh(" << x << "[o]);\n\n";
+            return true;
+
+        case ActivationType::SOFTMAX:
+            out << "    // Softmax, shifted by the largest value for stability\n"
+                << "    {\n"
+                << "        double max = *std::max_element(" << x << ", " << x << " + " << size << ");\n"
+                << "        double sum = 0.0;\n"
+                << "    " << loop
+                << "        {\n"
+                << "            " << x << "[o] = std::exp(" << x << "[o] - max);\n"
+                << "            sum += " << x << "[o];\n"
+                << "        }\n"
+                << "    " << loop
+                << "            " << x << "[o] /= sum;\n"
+                << "    }\n\n";
+            return true;
+
+        default:
+            printf("Error: The activation %s cannot be exported.\n", ActivationTypeToString(activation).c_str());
+            return false;
+    }
+}
+
+
+/**
+ * Writes the parameters and the inference functions of the network.
+ */
+static bool writeSource(std::ostream& out, Network& net, const std::string& name, const std::string& header)
+{
+    std::ostringstream body;
+    std::string current = "input";
+    int currentSize = net.inputSize();
+    int standardIndex = 0;
+    int buffers = 0;
+
+    // The last standard layer writes straight into the output
+    size_t lastStandard = 0;
+    for (size_t i = 0; i < net.Layers.size(); i++)
+    {
+        if (net.Layers[i]->getType() == LayerType::StandardLayer)
+            lastStandard = i;
+    }
+
+    out << "#include \"" << header << "\"\n\n"
+        << "#include <algorithm>\n"
+        << "#include <cmath>\n\n\n"
+        << "namespace " << name << " {\n\n";
+
+    for (size_t i = 0; i < net.Layers.size(); i++)
+    {
+        const Layer& layer = *net.Layers[i];
+
+        if (layer.getType() == LayerType::StandardLayer)
+        {
+            std::string prefix = "fc" + std::to_string(++standardIndex);
+            std::string target = i == lastStandard ? "output" : "layer" + std::to_string(++buffers);
+
+            if (!writeArray(out, prefix + "_weight", layer.weights) || !writeArray(out, prefix + "_bias", layer.biases))
+                return false;
+
+            if (target != "output")
+                body << "    alignas(64) double " << target << "[" << layer.outputSize << "];\n";
+
+            body << "    // " << prefix << ": " << layer.inputSize << " -> " << layer.outputSize << "\n"
+                 << "    for (int o = 0; o < " << layer.outputSize << "; o++)\n"
+                 << "    {\n"
+                 << "        const double* row = " << prefix << "_weight + o * " << layer.inputSize << ";\n"
+                 << "        double sum = 0.0;\n"
+                 << "        for (int i = 0; i < " << layer.inputSize << "; i++)\n"
+                 << "            sum += row[i] * " << current << "[i];\n"
+                 << "        " << target << "[o] = sum + " << prefix << "_bias[o];\n"
+                 << "    }\n\n";
+
+            current = target;
+            currentSize = layer.outputSize;
+        }
+        else if (layer.getType() == LayerType::ActivationLayer)
+        {
+            // The input is read-only: an activation in front of the first layer works on a copy
+            if (current == "input")
+            {
+                current = "layer" + std::to_string(++buffers);
+                body << "    alignas(64) double " << current << "[" << currentSize << "];\n"
+                     << "    std::copy(input, input + " << currentSize << ", " << current << ");\n\n";
+            }
+
+            const ActivationLayer& activationLayer = static_cast<const ActivationLayer&>(layer);
+            if (!writeActivation(body, activationLayer.activationFunction, current, currentSize))
+                return false;
+        }
+        else
+        {
+            printf("Error: Only standard and activation layers can be exported, layer %zu is not one.\n", i + 1);
+            return false;
+        }
+    }
+
+    // A network ending with activations after its last standard layer already wrote the output
+    if (current != "output")
+        body << "    std::copy(" << current << ", " << current << " + " << currentSize << ", output);\n";
+
+    std::string code = body.str();
+    if (code.size() >= 2 && code.compare(code.size() - 2, 2, "\n\n") == 0)
+        code.pop_back();
+
+    out << "\nvoid forward(const double* input, double* output)\n"
+        << "{\n"
+        << code
+        << "}\n\n\n"
+        << "int predict(const double* input)\n"
+        << "{\n"
+        << "    double output[OUTPUT_SIZE];\n"
+        << "    forward(input, output);\n"
+        << "    return (int)(std::max_element(output, output + OUTPUT_SIZE) - output);\n"
+        << "}\n\n"
+        << "} // namespace " << name << "\n";
+
+    return true;
+}
+
+
+int exportNetworkToCpp(Network& net, const std::string& outputPath, const std::string& weightsPath)
+{
+    if (net.Layers.empty() || net.standardLayerCount == 0)
+    {
+        printf("Error: The network has no layer to export.\n");
+        return 1;
+    }
+
+    std::filesystem::path basePath = std::filesystem::path(outputPath).replace_extension();
+    std::string name = identifierFromPath(basePath.string());
+    std::string headerPath = basePath.string() + ".hpp";
+    std::string sourcePath = basePath.string() + ".cpp";
+
+    std::string guard = name;
+    for (char& c : guard)
+        c = std::toupper(static_cast<unsigned char>(c));
+    guard += "_HPP";
+
+    std::string architecture;
+    for (const std::shared_ptr<Layer>& layer : net.Layers)
+    {
+        if (layer->getType() == LayerType::StandardLayer)
+            architecture += " fc" + std::to_string(layer->outputSize);
+        else if (layer->getType() == LayerType::ActivationLayer)
+            architecture += " " + ActivationTypeToString(static_cast<const ActivationLayer&>(*layer).activationFunction);
+    }
+
+    std::string notice = "// Generated by VanillaNet-cpp -ExportCpp from " + weightsPath + ", do not edit.\n"
+                         "// Architecture: " + std::to_string(net.inputSize()) + " inputs," + architecture + "\n";
+
+    if (basePath.has_parent_path())
+        std::filesystem::create_directories(basePath.parent_path());
+
+    std::ofstream header(headerPath);
+    std::ofstream source(sourcePath);
+    if (!header.is_open() || !source.is_open())
+    {
+        printf("Error: Could not write %s and %s\n", headerPath.c_str(), sourcePath.c_str());
+        return 1;
+    }
+
+    header << notice << "\n"
+           << "#ifndef " << guard << "\n"
+           << "#define " << guard << "\n\n\n"
+           << "namespace " << name << " {\n\n"
+           << "// Number of inputs and outputs of one sample\n"
+           << "constexpr int INPUT_SIZE = " << net.inputSize() << ";\n"
+           << "constexpr int OUTPUT_SIZE = " << net.outputSize() << ";\n\n\n"
+           << "/**\n"
+           << " * @brief Runs one sample through the network.\n"
+           << " *\n"
+           << " * @param input Pointer to INPUT_SIZE values (e.g. pixels in [0, 1]).\n"
+           << " * @param output Pointer to OUTPUT_SIZE values, written by the last layer.\n"
+           << " */\n"
+           << "void forward(const double* input, double* output);\n\n\n"
+           << "/**\n"
+           << " * @brief Returns the index of the largest output of one sample.\n"
+           << " *\n"
+           << " * @param input Pointer to INPUT_SIZE values.\n"
+           << " */\n"
+           << "int predict(const double* input);\n\n"
+           << "} // namespace " << name << "\n\n"
+           << "#endif // " << guard << "\n";
+
+    source << notice << "\n";
+    if (!writeSource(source, net, name, basePath.filename().string() + ".hpp"))
+        return 1;
+
+    header.close();
+    source.close();
+    if (header.fail() || source.fail())
+    {
+        printf("Error: Could not write %s and %s\n", headerPath.c_str(), sourcePath.c_str());
+        return 1;
+    }
+
+    printf("Network exported to %s and %s\n", headerPath.c_str(), sourcePath.c_str());
+    return 0;
+}
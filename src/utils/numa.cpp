@@ -0,0 +1,197 @@
+#include "numa.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <thread>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+
+// CPU the calling thread is pinned to (-1 if it is not pinned)
+static thread_local int pinnedThreadCpu = -1;
+
+
+/**
+ * Parses a CPU list of the kernel, e.g. "0-3,8,10-11".
+ */
+static std::vector<int> parseCpuList(const std::string& list)
+{
+    std::vector<int> cpus;
+    std::stringstream stream(list);
+    std::string range;
+
+    while (std::getline(stream, range, ','))
+    {
+        if (range.empty() || !std::isdigit((unsigned char)range[0]))
+            continue;
+
+        size_t dash = range.find('-');
+        int first = std::stoi(range.substr(0, dash));
+        int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+
+        for (int cpu = first; cpu <= last; cpu++)
+            cpus.push_back(cpu);
+    }
+
+    return cpus;
+}
+
+
+/**
+ * Reads the topology and keeps the CPUs the process may run on.
+ */
+static std::vector<NumaNode> readTopology()
+{
+    std::vector<NumaNode> nodes;
+
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    bool hasMask = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+    const std::string root = "/sys/devices/system/node";
+    std::error_code error;
+
+    for (const auto& entry : std::filesystem::directory_iterator(root, error))
+    {
+        std::string name = entry.path().filename().string();
+        if (name.rfind("node", 0) != 0 || name.size() == 4 || !std::isdigit((unsigned char)name[4]))
+            continue;
+
+        std::ifstream file(entry.path() / "cpulist");
+        std::string list;
+        std::getline(file, list);
+
+        NumaNode node;
+        node.id = std::stoi(name.substr(4));
+
+        for (int cpu : parseCpuList(list))
+        {
+            if (!hasMask || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)))
+                node.cpus.push_back(cpu);
+        }
+
+        if (!node.cpus.empty())
+            nodes.push_back(node);
+    }
+
+    std::sort(nodes.begin(), nodes.end(), [](const NumaNode& a, const NumaNode& b) { return a.id < b.id; });
+#endif
+
+    if (nodes.empty())
+    {
+        NumaNode node;
+        int cpus = std::max(1u, std::thread::hardware_concurrency());
+        for (int cpu = 0; cpu < cpus; cpu++)
+            node.cpus.push_back(cpu);
+        nodes.push_back(node);
+    }
+
+    return nodes;
+}
+
+
+const std::vector<NumaNode>& numaTopology()
+{
+    static const std::vector<NumaNode> nodes = readTopology();
+    return nodes;
+}
+
+
+int pinnedCpu(int index)
+{
+    // The CPUs of every node, node after node
+    static const std::vector<int> order = []()
+    {
+        std::vector<int> cpus;
+        for (const NumaNode& node : numaTopology())
+            cpus.insert(cpus.end(), node.cpus.begin(), node.cpus.end());
+        return cpus;
+    }();
+
+    return order[index % order.size()];
+}
+
+
+int numaNodeOfCpu(int cpu)
+{
+    const std::vector<NumaNode>& nodes = numaTopology();
+
+    for (size_t n = 0; n < nodes.size(); n++)
+    {
+        if (std::find(nodes[n].cpus.begin(), nodes[n].cpus.end(), cpu) != nodes[n].cpus.end())
+            return n;
+    }
+
+    return 0;
+}
+
+
+int currentNumaNode()
+{
+    if (numaTopology().size() == 1)
+        return 0;
+
+    // The node of a pinned thread is looked up once
+    thread_local int pinnedNode = -1;
+    thread_local int pinnedNodeCpu = -1;
+
+    if (pinnedThreadCpu >= 0)
+    {
+        if (pinnedNodeCpu != pinnedThreadCpu)
+        {
+            pinnedNode = numaNodeOfCpu(pinnedThreadCpu);
+            pinnedNodeCpu = pinnedThreadCpu;
+        }
+        return pinnedNode;
+    }
+
+#ifdef __linux__
+    int cpu = sched_getcpu();
+    if (cpu >= 0)
+        return numaNodeOfCpu(cpu);
+#endif
+
+    return 0;
+}
+
+
+void setCurrentThreadCpu(int cpu)
+{
+    pinnedThreadCpu = cpu;
+}
+
+
+std::string numaTopologyToString()
+{
+    const std::vector<NumaNode>& nodes = numaTopology();
+    std::ostringstream description;
+
+    description << nodes.size() << " (";
+    for (size_t n = 0; n < nodes.size(); n++)
+    {
+        // Compress the CPU list back into ranges
+        const std::vector<int>& cpus = nodes[n].cpus;
+        description << (n > 0 ? " | " : "") << "node" << nodes[n].id << ": ";
+
+        for (size_t c = 0; c < cpus.size(); c++)
+        {
+            size_t last = c;
+            while (last + 1 < cpus.size() && cpus[last + 1] == cpus[last] + 1)
+                last++;
+
+            description << (c > 0 ? "," : "") << cpus[c];
+            if (last > c)
+                description << "-" << cpus[last];
+            c = last;
+        }
+    }
+    description << ")";
+
+    return description.str();
+}
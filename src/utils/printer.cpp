@@ -88,13 +88,16 @@ void infoPrinter(Arguments& inputParams, Network& net)
 	printf("\n");
 
 
+    // The factorisation and the neuron pruning only read the training images, nothing is trained
+    bool training = inputParams.Train && inputParams.factorizeBudget < 0.0 && inputParams.pruneNeuronLevels.empty();
+
     std::cout << "- Mode:                        ";
-    if (inputParams.Train)
+    if (training)
         std::cout << "Training";
 
     if (inputParams.Test)
     {
-        if (inputParams.Train)
+        if (training)
             std::cout << " & ";
         std::cout << "Testing";
     }
@@ -102,8 +105,12 @@ void infoPrinter(Arguments& inputParams, Network& net)
 
     if (inputParams.Train)
     {
-        std::cout << "- Training dataset size:       " << inputParams.TrainDatasetImages.size() << std::endl;
+        // The validation images are held out later, once the seed is final
+        size_t validationSize = validationSetSize(inputParams);
+        std::cout << "- Training dataset size:       " << inputParams.TrainDatasetImages.size() - validationSize << std::endl;
         std::cout << "- Training dataset:            " << inputParams.TrainDatasetPath << std::endl;
+        if (validationSize > 0)
+            std::cout << "- Validation dataset size:     " << validationSize << std::endl;
     }
     
     if (inputParams.Test)
@@ -118,8 +125,14 @@ void infoPrinter(Arguments& inputParams, Network& net)
         std::cout << "- Weights and biases path:     " << inputParams.WeightsBiasesPath << std::endl;
     }
 
-    std::cout << "\n- Network Type:                Fully Connected (FC)" << std::endl;
-    std::cout << "- Number of layers:            " << net.standardLayerCount << std::endl;
+    std::cout << "\n- Compute backend:             " << gemmBackendName() << std::endl;
+    std::cout << "- Threads:                     " << threadPool().size() << (inputParams.pinThreads ? " (pinned)" : "") << std::endl;
+    std::cout << "- NUMA Nodes:                  " << numaTopologyToString() << std::endl;
+    if (inputParams.processes > 1)
+        std::cout << "- Training Processes:          " << inputParams.processes << " (shared-memory all-reduce)" << std::endl;
+
+    std::cout << "\n- Network Type:                " << NetworkArchitectureToString(inputParams.architecture) << std::endl;
+    std::cout << "- Number of layers:            " << net.standardLayerCount + net.convolutionLayerCount + net.poolingLayerCount << std::endl;
     std::cout << "- Type of layers:";
 
     int j = 1;
@@ -131,6 +144,20 @@ void infoPrinter(Arguments& inputParams, Network& net)
             std::cout << std::endl << "                               " << j << ") F.C. input: " << net.Layers[i]->inputSize << " neurons: " << net.Layers[i]->outputSize;
             j++;
         }
+        else if (net.Layers[i]->getType() == LayerType::ConvolutionLayer)
+        {
+            const Conv2DLayer& conv = static_cast<const Conv2DLayer&>(*net.Layers[i]);
+            std::cout << std::endl << "                               " << j << ") Conv. input: " << conv.inputShape.channels << "x" << conv.inputShape.height << "x" << conv.inputShape.width
+                      << " filters: " << conv.outputSize << " (" << conv.kernelSize << "x" << conv.kernelSize << ")";
+            j++;
+        }
+        else if (net.Layers[i]->getType() == LayerType::PoolingLayer)
+        {
+            const MaxPool2DLayer& pool = static_cast<const MaxPool2DLayer&>(*net.Layers[i]);
+            std::cout << std::endl << "                               " << j << ") Max Pool " << pool.poolSize << "x" << pool.poolSize << " output: "
+                      << pool.outputShape.channels << "x" << pool.outputShape.height << "x" << pool.outputShape.width;
+            j++;
+        }
         else if (net.Layers[i]->getType() == LayerType::ActivationLayer)
         {
             // Use dynamic_cast to access the ActivationLayer
@@ -143,13 +170,37 @@ void infoPrinter(Arguments& inputParams, Network& net)
     }
     std::cout << "\n" << std::endl;
     std::cout << "- Loss:                        " << lossFunctionTypeToString(net.lossFunction)[0] << std::endl;
+    if (!inputParams.pruneNeuronLevels.empty())
+    {
+        std::cout << "- Neuron Pruning:              ";
+        for (size_t i = 0; i < inputParams.pruneNeuronLevels.size(); i++)
+            std::cout << (i > 0 ? ", " : "") << 100.0 * inputParams.pruneNeuronLevels[i] << "%";
+        std::cout << " of the hidden neurons (" << NeuronRankingToString(inputParams.neuronRanking) << ")" << std::endl;
+    }
+    if (inputParams.factorizeBudget >= 0.0)
+        std::cout << "- Factorisation:               " << "low rank, at most " << inputParams.factorizeBudget << " percentage points of validation accuracy lost" << std::endl;
+    if (inputParams.quantization != WeightQuantization::NONE)
+        std::cout << "- Weights:                     " << WeightQuantizationToString(inputParams.quantization) << " (packed bit-planes)" << std::endl;
+    if (inputParams.pruneSparsity > 0.0)
+        std::cout << "- Pruning:                     " << 100.0 * inputParams.pruneSparsity << "% of the weights of every layer (magnitude)" << std::endl;
     
-    if (inputParams.Train)
+    if (training)
     {
-        std::cout << "- Optimizer:                   (SGD) Stochastic Gradient Descent" << std::endl;
+        std::cout << "- Optimizer:                   " << OptimizerTypeToString(net.optimizer.type) << std::endl;
+        if (!inputParams.hasWeightsBiases)
+            std::cout << "- Initialization:              " << InitializationTypeToString(inputParams.initialization) << std::endl;
+        if (inputParams.asyncWorkers > 0)
+            std::cout << "- Asynchronous (Hogwild):      " << inputParams.asyncWorkers << " workers" << std::endl;
         std::cout << "\n- Epochs:                      " << inputParams.epochs << std::endl;
         std::cout << "- Batch Size:                  " << inputParams.batchSize << std::endl;
+        std::cout << "- Seed:                        " << inputParams.seed << (inputParams.deterministic ? " (reproducible)" : "") << std::endl;
         std::cout << "- Learning Rate:               " << inputParams.learningRate << std::endl;
+        std::cout << "- Learning Rate Schedule:      " << LearningRateScheduleToString(inputParams.schedule.schedule);
+        if (inputParams.schedule.warmupEpochs > 0)
+            std::cout << " (warmup: " << inputParams.schedule.warmupEpochs << " epochs)";
+        std::cout << std::endl;
+        if (inputParams.patience > 0)
+            std::cout << "- Early Stopping Patience:     " << inputParams.patience << " epochs" << std::endl;
     }
 
     printf("\n");
@@ -180,3 +231,88 @@ void finalResultPrinter(double accuracy, double loss, int corrects, int total, s
     std::cout << std::setw(rightPadding + avgLossStr.length()) << std::right << avgLossStr << "\n" << std::endl;
     printHorizontalLine('*');
 }
+
+
+void confusionMatrixPrinter(const ClassificationMetrics& metrics)
+{
+    if (metrics.confusion.empty() || metrics.classes > MAX_CONFUSION_CLASSES)
+        return;
+
+    // Wide enough for the largest count and the headers
+    int width = std::max(4, (int)std::to_string(metrics.samples).length() + 1);
+
+    printf("\nConfusion matrix (rows: true class, columns: predicted class)\n\n");
+    std::cout << std::setw(width) << " ";
+    for (int c = 0; c < metrics.classes; c++)
+        std::cout << std::setw(width) << c;
+    std::cout << "   Accuracy\n";
+
+    for (int t = 0; t < metrics.classes; t++)
+    {
+        std::cout << std::setw(width) << t;
+        for (int c = 0; c < metrics.classes; c++)
+            std::cout << std::setw(width) << metrics.confusion[(size_t)t * metrics.classes + c];
+
+        std::ostringstream ossAcc;
+        ossAcc << std::fixed << std::setprecision(2) << metrics.classAccuracy(t) << "%";
+        std::cout << std::setw(11) << ossAcc.str() << "\n";
+    }
+
+    std::cout << std::endl;
+    printHorizontalLine('*');
+}
+
+
+void sparsityPrinter(const Network& net)
+{
+    size_t keptBytes = 0, denseBytes = 0;
+
+    printf("\nPruned layers (CSR storage of the weights)\n\n");
+    for (size_t i = 0; i < net.Layers.size(); i++)
+    {
+        const Layer& layer = *net.Layers[i];
+        if (!layer.isSparse())
+            continue;
+
+        size_t dense = layer.weights.size() * sizeof(double);
+        keptBytes += layer.sparseWeights.storageBytes();
+        denseBytes += dense;
+
+        printf("- %-6s %6.2f%% sparse, %zu/%zu weights kept, %.1f KB instead of %.1f KB\n",
+               net.parameterName(i).c_str(), 100.0 * layer.sparsity(), layer.sparseWeights.nonZeros(), layer.weights.size(),
+               layer.sparseWeights.storageBytes() / 1024.0, dense / 1024.0);
+    }
+
+    if (denseBytes > 0)
+        printf("\nWeights: %.1f KB instead of %.1f KB (%.1fx smaller)\n\n", keptBytes / 1024.0, denseBytes / 1024.0, (double)denseBytes / std::max<size_t>(keptBytes, 1));
+
+    printHorizontalLine('*');
+}
+
+
+void quantizationPrinter(const Network& net)
+{
+    size_t packedBytes = 0, denseBytes = 0;
+
+    printf("\nQuantized layers (bit-planes of the weights)\n\n");
+    for (size_t i = 0; i < net.Layers.size(); i++)
+    {
+        const Layer& layer = *net.Layers[i];
+        if (!layer.isQuantized())
+            continue;
+
+        size_t dense = layer.weights.size() * sizeof(double);
+        size_t zeros = std::count(layer.quantizedWeights.begin(), layer.quantizedWeights.end(), 0.0);
+        packedBytes += layer.packedWeights.storageBytes();
+        denseBytes += dense;
+
+        printf("- %-6s %s, %6.2f%% zeros, %.1f KB instead of %.1f KB\n",
+               net.parameterName(i).c_str(), WeightQuantizationToString(layer.packedWeights.type).c_str(),
+               100.0 * zeros / std::max<size_t>(layer.quantizedWeights.size(), 1), layer.packedWeights.storageBytes() / 1024.0, dense / 1024.0);
+    }
+
+    if (denseBytes > 0)
+        printf("\nWeights: %.1f KB instead of %.1f KB (%.1fx smaller)\n\n", packedBytes / 1024.0, denseBytes / 1024.0, (double)denseBytes / std::max<size_t>(packedBytes, 1));
+
+    printHorizontalLine('*');
+}
@@ -0,0 +1,334 @@
+#include "processGroup.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <chrono>
+
+#include <fcntl.h>
+#include <spawn.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+#include "threadPool.hpp"
+
+extern char** environ;
+
+
+// Busy-wait iterations of a barrier before yielding, then before sleeping
+static constexpr long SPIN_ITERATIONS = 2000;
+static constexpr long YIELD_ITERATIONS = 20000;
+
+// Minimum number of values reduced by a task
+static constexpr size_t REDUCE_GRAIN = 4096;
+
+
+/**
+ * The start of the shared-memory segment. The counters are lock-free atomics, which also work
+ * between processes. The slots and the result area follow, aligned on a cache line.
+ */
+struct alignas(64) ProcessGroup::SharedHeader
+{
+    std::atomic<uint32_t> arrived;
+    std::atomic<uint32_t> generation;
+    std::atomic<uint32_t> aborted;
+    uint32_t processes;
+    uint64_t capacity;
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "The barrier of the process group needs lock-free atomics");
+
+
+ProcessGroup::~ProcessGroup()
+{
+    finish();
+
+    if (header != nullptr)
+        munmap(header, mappedSize);
+}
+
+
+bool ProcessGroup::start(int processes, int rank, const std::string& name, size_t capacity, int argc, char** argv)
+{
+    if (processes <= 1)
+        return true;
+
+    this->processes = processes;
+    this->processRank = rank;
+    this->capacity = capacity;
+    this->mappedSize = sizeof(SharedHeader) + (processes + 1) * capacity * sizeof(double);
+
+    int fd = -1;
+
+    if (rank == 0)
+    {
+        segmentName = "/vanillanet-" + std::to_string(getpid());
+        fd = shm_open(segmentName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+
+        if (fd < 0 || ftruncate(fd, mappedSize) != 0)
+        {
+            printf("Error: Could not create the shared memory %s: %s\n", segmentName.c_str(), strerror(errno));
+            if (fd >= 0)
+            {
+                close(fd);
+                shm_unlink(segmentName.c_str());
+            }
+            return false;
+        }
+    }
+    else
+    {
+#ifdef __linux__
+        // Do not outlive process 0
+        prctl(PR_SET_PDEATHSIG, SIGTERM);
+#endif
+        segmentName = name;
+        fd = shm_open(segmentName.c_str(), O_RDWR, 0600);
+
+        struct stat info;
+        if (fd < 0 || fstat(fd, &info) != 0 || (size_t)info.st_size != mappedSize)
+        {
+            printf("Error: Could not join the shared memory %s\n", segmentName.c_str());
+            if (fd >= 0)
+                close(fd);
+            return false;
+        }
+    }
+
+    void* memory = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (memory == MAP_FAILED)
+    {
+        printf("Error: Could not map the shared memory %s: %s\n", segmentName.c_str(), strerror(errno));
+        if (rank == 0)
+            shm_unlink(segmentName.c_str());
+        return false;
+    }
+
+    header = static_cast<SharedHeader*>(memory);
+    slots = reinterpret_cast<double*>(header + 1);
+    result = slots + processes * capacity;
+
+    if (rank == 0)
+    {
+        // ftruncate zero-fills the segment, the header only needs its sizes
+        header->processes = processes;
+        header->capacity = capacity;
+
+        // Run the executable again with the same arguments, plus the rank and the segment
+        char executable[4096];
+        ssize_t length = readlink("/proc/self/exe", executable, sizeof(executable) - 1);
+        executable[length > 0 ? length : 0] = '\0';
+        if (length <= 0)
+            strncpy(executable, argv[0], sizeof(executable) - 1);
+
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+
+        for (int r = 1; r < processes; r++)
+        {
+            std::vector<std::string> arguments(argv, argv + argc);
+            arguments.insert(arguments.end(), { "-Rank", std::to_string(r), "-Group", segmentName });
+
+            std::vector<char*> childArgv;
+            for (std::string& argument : arguments)
+                childArgv.push_back(argument.data());
+            childArgv.push_back(nullptr);
+
+            pid_t pid;
+            if (posix_spawn(&pid, executable, &actions, nullptr, childArgv.data(), environ) != 0)
+            {
+                printf("Error: Could not launch training process %d\n", r);
+                abort();
+                break;
+            }
+            children.push_back(pid);
+        }
+
+        posix_spawn_file_actions_destroy(&actions);
+    }
+    else if (header->processes != (uint32_t)processes || header->capacity != capacity)
+    {
+        printf("Error: The shared memory %s belongs to another group\n", segmentName.c_str());
+        abort();
+        return false;
+    }
+
+    bool joined = barrier();
+
+    // Every process has mapped the segment, its name is no longer needed
+    if (rank == 0)
+        shm_unlink(segmentName.c_str());
+
+    return joined;
+}
+
+
+int ProcessGroup::size() const
+{
+    return processes;
+}
+
+
+int ProcessGroup::rank() const
+{
+    return processRank;
+}
+
+
+bool ProcessGroup::allReduce(std::vector<double>& values)
+{
+    if (processes <= 1)
+        return true;
+
+    size_t length = values.size();
+    if (length > capacity)
+    {
+        printf("Error: %zu values exceed the capacity of the process group (%zu)\n", length, capacity);
+        abort();
+        return false;
+    }
+
+    std::copy(values.begin(), values.end(), slots + processRank * capacity);
+
+    if (!barrier())
+        return false;
+
+    // Reduce-scatter: this process sums its own chunk over the slots of all the processes
+    size_t chunkBegin = length * processRank / processes;
+    size_t chunkEnd = length * (processRank + 1) / processes;
+
+    threadPool().parallelFor(chunkBegin, chunkEnd, REDUCE_GRAIN, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            double sum = 0.0;
+            for (int p = 0; p < processes; p++)
+                sum += slots[p * capacity + i];
+            result[i] = sum;
+        }
+    });
+
+    if (!barrier())
+        return false;
+
+    // All-gather: every chunk is now in the result area
+    std::copy(result, result + length, values.begin());
+
+    return true;
+}
+
+
+bool ProcessGroup::broadcast(std::vector<double>& values)
+{
+    if (processes <= 1)
+        return true;
+
+    if (values.size() > capacity)
+    {
+        printf("Error: %zu values exceed the capacity of the process group (%zu)\n", values.size(), capacity);
+        abort();
+        return false;
+    }
+
+    if (processRank == 0)
+        std::copy(values.begin(), values.end(), result);
+
+    if (!barrier())
+        return false;
+
+    if (processRank != 0)
+        std::copy(result, result + values.size(), values.begin());
+
+    // Nobody writes the result area again before everyone has read it
+    return barrier();
+}
+
+
+bool ProcessGroup::barrier()
+{
+    if (processes <= 1)
+        return true;
+
+    uint32_t generation = header->generation.load(std::memory_order_acquire);
+
+    if (header->arrived.fetch_add(1, std::memory_order_acq_rel) + 1 == (uint32_t)processes)
+    {
+        // The last process to arrive releases the others
+        header->arrived.store(0, std::memory_order_relaxed);
+        header->generation.fetch_add(1, std::memory_order_release);
+        return header->aborted.load() == 0;
+    }
+
+    for (long spins = 0; header->generation.load(std::memory_order_acquire) == generation; spins++)
+    {
+        if (header->aborted.load() != 0)
+            return false;
+
+        if (spins < SPIN_ITERATIONS)
+            continue;
+
+        if (spins < YIELD_ITERATIONS)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // A long wait (e.g. process 0 validating): sleep and check that the others are alive
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        if (spins % 1000 == 0 && !childrenAlive())
+        {
+            printf("Error: A training process exited unexpectedly\n");
+            abort();
+            return false;
+        }
+    }
+
+    return header->aborted.load() == 0;
+}
+
+
+void ProcessGroup::finish()
+{
+    for (pid_t child : children)
+    {
+        int status;
+        waitpid(child, &status, 0);
+    }
+    children.clear();
+}
+
+
+bool ProcessGroup::childrenAlive()
+{
+    for (pid_t child : children)
+    {
+        int status;
+        if (waitpid(child, &status, WNOHANG) != 0)
+            return false;
+    }
+
+    return true;
+}
+
+
+void ProcessGroup::abort()
+{
+    if (header != nullptr)
+        header->aborted.store(1);
+}
+
+
+ProcessGroup& processGroup()
+{
+    static ProcessGroup group;
+    return group;
+}
@@ -0,0 +1,30 @@
+#include "random.hpp"
+
+static uint64_t seedValue = 0;
+
+
+uint64_t splitMix64(uint64_t value)
+{
+    value += 0x9E3779B97F4A7C15ull;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+    return value ^ (value >> 31);
+}
+
+
+void setGlobalSeed(uint64_t seed)
+{
+    seedValue = seed;
+}
+
+
+uint64_t globalSeed()
+{
+    return seedValue;
+}
+
+
+std::mt19937_64 rngStream(uint64_t stream)
+{
+    return std::mt19937_64(splitMix64(seedValue ^ splitMix64(stream)));
+}
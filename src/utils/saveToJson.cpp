@@ -23,7 +23,15 @@ std::string WeightsBiasesToJSON(Network& net)
         // Identify the type of layer using the polymorphic method getType
         if (net.Layers[i]->getType() == LayerType::StandardLayer)
         {
-            fileName = fileName + "fc" + std::to_string(net.Layers[i]->neurons.size()) + "_";
+            fileName = fileName + "fc" + std::to_string(net.Layers[i]->outputSize) + "_";
+        }
+        else if (net.Layers[i]->getType() == LayerType::ConvolutionLayer)
+        {
+            fileName = fileName + "conv" + std::to_string(net.Layers[i]->outputSize) + "_";
+        }
+        else if (net.Layers[i]->getType() == LayerType::PoolingLayer)
+        {
+            fileName = fileName + "maxpool" + std::to_string(static_cast<const MaxPool2DLayer&>(*net.Layers[i]).poolSize) + "_";
         }
         else if (net.Layers[i]->getType() == LayerType::ActivationLayer)
         {
@@ -0,0 +1,260 @@
+#include "threadPool.hpp"
+
+#include <algorithm>
+
+#include "numa.hpp"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+
+// Index of the calling thread in the pool it works for (-1 outside of any pool)
+static thread_local int workerIndex = -1;
+static thread_local const ThreadPool* workerPool = nullptr;
+
+static int configuredThreads = 0;
+static bool configuredPinning = false;
+static int configuredFirstCore = 0;
+
+
+static void pinCurrentThread(int core)
+{
+#ifdef __linux__
+    // Fill a NUMA node before moving to the next one
+    int cpu = pinnedCpu(core);
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+        printf("[WARNING]: Could not pin a thread to core %d.\n", cpu);
+    else
+        setCurrentThreadCpu(cpu);
+#else
+    (void)core;
+#endif
+}
+
+
+ThreadPool::ThreadPool(int threads, bool pinThreads, int firstCore)
+{
+    if (threads < 1)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    threadCount = threads;
+    this->firstCore = firstCore;
+    this->pinned = pinThreads;
+
+    // The last queue belongs to the thread outside the pool
+    for (int i = 0; i < threadCount; i++)
+        queues.push_back(std::make_unique<WorkerQueue>());
+
+    if (pinThreads)
+        pinCurrentThread(firstCore);
+
+    for (int i = 0; i < threadCount - 1; i++)
+        workers.emplace_back(&ThreadPool::workerLoop, this, i, pinThreads);
+}
+
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+
+int ThreadPool::size() const
+{
+    return threadCount;
+}
+
+
+int ThreadPool::currentSlot() const
+{
+    return workerPool == this ? workerIndex : threadCount - 1;
+}
+
+
+int ThreadPool::slotCpu(int slot) const
+{
+    if (!pinned)
+        return -1;
+
+    // The thread outside the pool takes the first core, worker i the core i + 1
+    return pinnedCpu(firstCore + (slot == threadCount - 1 ? 0 : slot + 1));
+}
+
+
+void ThreadPool::submit(TaskGroup& group, std::function<void()> task)
+{
+    // Workers keep their own tasks, the other threads spread them over the deques
+    int index = currentSlot();
+    if (workerPool != this)
+        index = nextQueue++ % threadCount;
+
+    submit(group, std::move(task), index);
+}
+
+
+void ThreadPool::submit(TaskGroup& group, std::function<void()> task, int slot)
+{
+    group.pending++;
+    int index = slot % threadCount;
+
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->tasks.push_back({std::move(task), &group});
+    }
+    queuedTasks++;
+
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wakeUp.notify_one();
+}
+
+
+void ThreadPool::wait(TaskGroup& group)
+{
+    while (group.pending.load() > 0)
+    {
+        if (!runOneTask())
+            std::this_thread::yield();
+    }
+}
+
+
+void ThreadPool::parallelFor(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& body)
+{
+    if (end <= begin)
+        return;
+
+    size_t count = end - begin;
+    grain = std::max<size_t>(1, grain);
+
+    size_t chunks = std::min((count + grain - 1) / grain, (size_t)threadCount * 4);
+    if (chunks <= 1)
+    {
+        body(begin, end);
+        return;
+    }
+
+    size_t chunkSize = (count + chunks - 1) / chunks;
+    TaskGroup group;
+
+    // The caller runs the first chunk itself
+    for (size_t first = begin + chunkSize; first < end; first += chunkSize)
+    {
+        size_t last = std::min(first + chunkSize, end);
+        submit(group, [&body, first, last]() { body(first, last); });
+    }
+
+    body(begin, std::min(begin + chunkSize, end));
+    wait(group);
+}
+
+
+void ThreadPool::workerLoop(int index, bool pinThread)
+{
+    workerIndex = index;
+    workerPool = this;
+
+    if (pinThread)
+        pinCurrentThread(firstCore + index + 1);
+
+    while (true)
+    {
+        Task task;
+        if (popTask(index, task) || stealTask(index, task))
+        {
+            runTask(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wakeUp.wait(lock, [this]() { return stopping || queuedTasks.load() > 0; });
+
+        if (stopping && queuedTasks.load() <= 0)
+            return;
+    }
+}
+
+
+bool ThreadPool::popTask(int index, Task& task)
+{
+    std::lock_guard<std::mutex> lock(queues[index]->mutex);
+    if (queues[index]->tasks.empty())
+        return false;
+
+    task = std::move(queues[index]->tasks.back());
+    queues[index]->tasks.pop_back();
+    queuedTasks--;
+    return true;
+}
+
+
+bool ThreadPool::stealTask(int thief, Task& task)
+{
+    for (int i = 1; i < threadCount; i++)
+    {
+        int victim = (thief + i) % threadCount;
+
+        std::lock_guard<std::mutex> lock(queues[victim]->mutex);
+        if (queues[victim]->tasks.empty())
+            continue;
+
+        task = std::move(queues[victim]->tasks.front());
+        queues[victim]->tasks.pop_front();
+        queuedTasks--;
+        return true;
+    }
+
+    return false;
+}
+
+
+bool ThreadPool::runOneTask()
+{
+    int index = currentSlot();
+
+    Task task;
+    if (popTask(index, task) || stealTask(index, task))
+    {
+        runTask(task);
+        return true;
+    }
+
+    return false;
+}
+
+
+void ThreadPool::runTask(Task& task)
+{
+    task.function();
+    task.group->pending--;
+}
+
+
+void configureThreadPool(int threads, bool pinThreads, int firstCore)
+{
+    configuredThreads = threads;
+    configuredPinning = pinThreads;
+    configuredFirstCore = firstCore;
+}
+
+
+ThreadPool& threadPool()
+{
+    static ThreadPool pool(configuredThreads, configuredPinning, configuredFirstCore);
+    return pool;
+}
@@ -1,4 +1,11 @@
 #include "toolkit.hpp"
+#include "dataset.hpp"
+#include "random.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <random>
 
 
 std::string makeFolder(const std::string& basePath, const std::string& folderName)
@@ -21,15 +28,6 @@ int labelExtractor(const std::string& imagePath)
 }
 
 
-std::vector<double> trueLabel(int label)
-{
-    std::vector<double> labelVector(10, 0.0);
-    labelVector[label] = 1.0;
-
-    return labelVector;
-}
-
-
 std::vector<std::string> datasetImagesVector(const std::string& datasetPath)
 {
     size_t idx = datasetPath.find_last_of(".");
@@ -51,6 +49,8 @@ std::vector<std::string> datasetImagesVector(const std::string& datasetPath)
 
 int parser(Arguments& inputParams, int argc, char** inputToParse)
 {
+    std::string csvPath = "";
+
     for (int i = 0; i < argc; i++)
     {
         if (strcmp(inputToParse[i], "-Train") == 0 || strcmp(inputToParse[i], "-Tr") == 0)
@@ -67,14 +67,7 @@ int parser(Arguments& inputParams, int argc, char** inputToParse)
         } 
         else if (strcmp(inputToParse[i], "-csv") == 0)
         {
-            if (inputParams.Train || inputParams.Test)
-            {
-                std::cout << "One operation at time. Now extract the datasets. At the next call you can use -Train and/or -Test." << std::endl;
-            }
-            printf("Dataset path: %s\n", inputToParse[i + 1]);
-            // datasetExtractor("./Resources/Dataset/csv");
-            datasetExtractor(inputToParse[i + 1]);
-            return 1;
+            csvPath = inputToParse[i + 1];
         }
         else if (strcmp(inputToParse[i], "-WeightsBiases") == 0 || strcmp(inputToParse[i], "-wb") == 0)
         {
@@ -97,6 +90,192 @@ int parser(Arguments& inputParams, int argc, char** inputToParse)
         {
             inputParams.print = true;
         } 
+        else if (strcmp(inputToParse[i], "-Benchmark") == 0 || strcmp(inputToParse[i], "-Bench") == 0)
+        {
+            inputParams.benchmark = true;
+            inputParams.benchmarkRuns = std::stoi(inputToParse[i + 1]);
+        }
+        else if (strcmp(inputToParse[i], "-Async") == 0)
+        {
+            inputParams.asyncWorkers = std::stoi(inputToParse[i + 1]);
+        }
+        else if (strcmp(inputToParse[i], "-Processes") == 0)
+        {
+            inputParams.processes = std::stoi(inputToParse[i + 1]);
+        }
+        else if (strcmp(inputToParse[i], "-Rank") == 0)
+        {
+            inputParams.rank = std::stoi(inputToParse[i + 1]);
+        }
+        else if (strcmp(inputToParse[i], "-Group") == 0)
+        {
+            inputParams.processGroupName = inputToParse[i + 1];
+        }
+        else if (strcmp(inputToParse[i], "-Threads") == 0)
+        {
+            inputParams.threads = std::stoi(inputToParse[i + 1]);
+        }
+        else if (strcmp(inputToParse[i], "-Pin") == 0)
+        {
+            inputParams.pinThreads = true;
+        }
+        else if (strcmp(inputToParse[i], "-Optimizer") == 0 || strcmp(inputToParse[i], "-Opt") == 0)
+        {
+            inputParams.optimizer = stringToOptimizerType(inputToParse[i + 1]);
+            if (inputParams.optimizer == OptimizerType::INVALID)
+            {
+                std::cout << "Invalid optimizer: " << inputToParse[i + 1] << ". Use one of: SGD, Momentum, Nesterov, Adam, AdamW." << std::endl;
+                return -1;
+            }
+        }
+        else if (strcmp(inputToParse[i], "-Init") == 0)
+        {
+            inputParams.initialization = stringToInitializationType(inputToParse[i + 1]);
+            if (inputParams.initialization == InitializationType::INVALID)
+            {
+                std::cout << "Invalid initialization: " << inputToParse[i + 1] << ". Use one of: Glorot, He, LeCun." << std::endl;
+                return -1;
+            }
+        }
+        else if (strcmp(inputToParse[i], "-Architecture") == 0 || strcmp(inputToParse[i], "-Arch") == 0)
+        {
+            inputParams.architecture = stringToNetworkArchitecture(inputToParse[i + 1]);
+            if (inputParams.architecture == NetworkArchitecture::INVALID)
+            {
+                std::cout << "Invalid architecture: " << inputToParse[i + 1] << ". Use one of: MLP, CNN." << std::endl;
+                return -1;
+            }
+        }
+        else if (strcmp(inputToParse[i], "-Validation") == 0 || strcmp(inputToParse[i], "-Val") == 0)
+        {
+            inputParams.validationSplit = std::stod(inputToParse[i + 1]);
+        }
+        else if (strcmp(inputToParse[i], "-Schedule") == 0)
+        {
+            inputParams.schedule.schedule = stringToLearningRateSchedule(inputToParse[i + 1]);
+            if (inputParams.schedule.schedule == LearningRateSchedule::INVALID)
+            {
+                std::cout << "Invalid schedule: " << inputToParse[i + 1] << ". Use one of: Constant, Step, Cosine, Plateau." << std::endl;
+                return -1;
+            }
+        }
+        else if (strcmp(inputToParse[i], "-Warmup") == 0)
+        {
+            inputParams.schedule.warmupEpochs = std::stoi(inputToParse[i + 1]);
+        }
+        else if (strcmp(inputToParse[i], "-StepSize") == 0)
+        {
+            inputParams.schedule.stepSize = std::stoi(inputToParse[i + 1]);
+        }
+        else if (strcmp(inputToParse[i], "-Gamma") == 0)
+        {
+            inputParams.schedule.gamma = std::stod(inputToParse[i + 1]);
+        }
+        else if (strcmp(inputToParse[i], "-Patience") == 0)
+        {
+            inputParams.patience = std::stoi(inputToParse[i + 1]);
+        }
+        else if (strcmp(inputToParse[i], "-Seed") == 0)
+        {
+            // std::stoull wraps negative numbers around, so the sign is checked on the text
+            unsigned long long seed = inputToParse[i + 1][0] == '-' ? ULLONG_MAX : std::stoull(inputToParse[i + 1]);
+            if (seed > UINT32_MAX)
+            {
+                std::cout << "Invalid seed: " << inputToParse[i + 1] << ". Give a number between 0 and " << UINT32_MAX << "." << std::endl;
+                return -1;
+            }
+            inputParams.seed = static_cast<unsigned int>(seed);
+            inputParams.deterministic = true;
+        }
+        else if (strcmp(inputToParse[i], "-Serve") == 0)
+        {
+            inputParams.serve = true;
+            inputParams.servePath = inputToParse[i + 1];
+        }
+        else if (strcmp(inputToParse[i], "-ServeBatch") == 0)
+        {
+            inputParams.serveBatch = std::stoi(inputToParse[i + 1]);
+        }
+        else if (strcmp(inputToParse[i], "-ServeWait") == 0)
+        {
+            inputParams.serveWaitUs = std::stoi(inputToParse[i + 1]);
+        }
+        else if (strcmp(inputToParse[i], "-ExportCpp") == 0)
+        {
+            inputParams.exportCppPath = inputToParse[i + 1];
+        }
+        else if (strcmp(inputToParse[i], "-Hidden") == 0)
+        {
+            inputParams.hiddenSize = std::stoi(inputToParse[i + 1]);
+        }
+        else if (strcmp(inputToParse[i], "-PruneNeurons") == 0)
+        {
+            // A comma separated list of fractions, e.g. 0.25,0.5,0.625
+            std::stringstream levels(inputToParse[i + 1]);
+            std::string level;
+            while (std::getline(levels, level, ','))
+            {
+                double fraction = std::stod(level);
+                if (fraction < 0.0 || fraction >= 1.0)
+                {
+                    std::cout << "Invalid neuron pruning level: " << level << ". Give the fractions of the hidden neurons to remove, between 0 and 1." << std::endl;
+                    return -1;
+                }
+                inputParams.pruneNeuronLevels.push_back(fraction);
+            }
+        }
+        else if (strcmp(inputToParse[i], "-NeuronRank") == 0)
+        {
+            inputParams.neuronRanking = stringToNeuronRanking(inputToParse[i + 1]);
+            if (inputParams.neuronRanking == NeuronRanking::INVALID)
+            {
+                std::cout << "Invalid neuron ranking: " << inputToParse[i + 1] << ". Use one of: Norm, Activation." << std::endl;
+                return -1;
+            }
+        }
+        else if (strcmp(inputToParse[i], "-Factorize") == 0)
+        {
+            inputParams.factorizeBudget = std::stod(inputToParse[i + 1]);
+            if (inputParams.factorizeBudget < 0.0 || inputParams.factorizeBudget >= 100.0)
+            {
+                std::cout << "Invalid factorisation budget: " << inputToParse[i + 1] << ". Give the largest accepted drop of accuracy in percentage points, e.g. 1." << std::endl;
+                return -1;
+            }
+        }
+        else if (strcmp(inputToParse[i], "-Ranks") == 0)
+        {
+            // A comma separated list of ranks, one per fully connected layer, e.g. 32,0
+            std::stringstream ranks(inputToParse[i + 1]);
+            std::string rank;
+            while (std::getline(ranks, rank, ','))
+            {
+                int value = std::stoi(rank);
+                if (value < 0)
+                {
+                    std::cout << "Invalid rank: " << rank << ". Give one rank per fully connected layer, 0 for a layer that is not factorised." << std::endl;
+                    return -1;
+                }
+                inputParams.layerRanks.push_back(value);
+            }
+        }
+        else if (strcmp(inputToParse[i], "-Quantize") == 0)
+        {
+            inputParams.quantization = stringToWeightQuantization(inputToParse[i + 1]);
+            if (inputParams.quantization == WeightQuantization::INVALID)
+            {
+                std::cout << "Invalid quantization: " << inputToParse[i + 1] << ". Use one of: Binary, Ternary." << std::endl;
+                return -1;
+            }
+        }
+        else if (strcmp(inputToParse[i], "-Prune") == 0)
+        {
+            inputParams.pruneSparsity = std::stod(inputToParse[i + 1]);
+            if (inputParams.pruneSparsity <= 0.0 || inputParams.pruneSparsity >= 1.0)
+            {
+                std::cout << "Invalid pruning: " << inputToParse[i + 1] << ". Give the fraction of the weights to prune, between 0 and 1." << std::endl;
+                return -1;
+            }
+        }
         else if (strcmp(inputToParse[i], "-help") == 0 || strcmp(inputToParse[i], "-h") == 0)
         {
             // TODO
@@ -110,6 +289,123 @@ int parser(Arguments& inputParams, int argc, char** inputToParse)
         // }
     }
 
+    // The training processes share the cores of the machine, each one on its own range
+    if (inputParams.processes > 1 && inputParams.threads < 1)
+        inputParams.threads = std::max(1u, std::thread::hardware_concurrency() / inputParams.processes);
+
+    // Every parallel path uses the same thread pool, sized before its first use
+    configureThreadPool(inputParams.threads, inputParams.pinThreads, inputParams.rank * std::max(0, inputParams.threads));
+
+    if (strcmp(csvPath.c_str(), "") != 0)
+    {
+        if (inputParams.Train || inputParams.Test)
+        {
+            std::cout << "One operation at time. Now extract the datasets. At the next call you can use -Train and/or -Test." << std::endl;
+        }
+        printf("Dataset path: %s\n", csvPath.c_str());
+        // datasetExtractor("./Resources/Dataset/csv");
+        datasetExtractor(csvPath);
+        return 1;
+    }
+
+    if (inputParams.hiddenSize < 1)
+    {
+        std::cout << "The hidden layer needs at least one neuron." << std::endl;
+        return -1;
+    }
+
+    size_t fullyConnectedLayers = inputParams.architecture == NetworkArchitecture::CNN ? 1 : 2;
+    if (inputParams.layerRanks.size() > fullyConnectedLayers)
+    {
+        std::cout << "Too many ranks: the network has " << fullyConnectedLayers << " fully connected layers." << std::endl;
+        return -1;
+    }
+
+    if (inputParams.Train && (inputParams.validationSplit < 0.0 || inputParams.validationSplit >= 1.0))
+    {
+        std::cout << "The validation split must be a fraction of the training dataset between 0 and 1." << std::endl;
+        return -1;
+    }
+
+    if (inputParams.quantization != WeightQuantization::NONE &&
+        (inputParams.asyncWorkers > 0 || inputParams.pruneSparsity > 0.0 || !inputParams.pruneNeuronLevels.empty() ||
+         inputParams.factorizeBudget >= 0.0 || !inputParams.exportCppPath.empty()))
+    {
+        std::cout << "The binary and ternary weights cannot be combined with -Async, -Prune, -PruneNeurons, -Factorize or -ExportCpp." << std::endl;
+        return -1;
+    }
+
+    if (inputParams.factorizeBudget >= 0.0)
+    {
+        if (inputParams.serve || !inputParams.exportCppPath.empty() || inputParams.processes > 1 ||
+            inputParams.pruneSparsity > 0.0 || !inputParams.pruneNeuronLevels.empty() || !inputParams.layerRanks.empty())
+        {
+            std::cout << "The factorisation cannot be combined with -Serve, -ExportCpp, -Processes, -Prune, -PruneNeurons or -Ranks." << std::endl;
+            return -1;
+        }
+        if (!inputParams.hasWeightsBiases || !inputParams.Train || inputParams.validationSplit <= 0.0 || !inputParams.Test)
+        {
+            std::cout << "Factorisation selected. Please provide the weights to factorise with -wb, the images to choose the ranks on with -Tr and -Validation, and a testing dataset with -Te." << std::endl;
+            return -1;
+        }
+        return 0;
+    }
+
+    if (!inputParams.pruneNeuronLevels.empty())
+    {
+        if (inputParams.serve || !inputParams.exportCppPath.empty() || inputParams.processes > 1)
+        {
+            std::cout << "The neuron pruning cannot be combined with -Serve, -ExportCpp or -Processes." << std::endl;
+            return -1;
+        }
+        if (!inputParams.hasWeightsBiases || !inputParams.Test)
+        {
+            std::cout << "Neuron pruning selected. Please provide the weights to prune with -wb and a testing dataset with -Te." << std::endl;
+            return -1;
+        }
+        if (inputParams.neuronRanking == NeuronRanking::ACTIVATION && !inputParams.Train)
+        {
+            std::cout << "The neurons are ranked by activation on training images. Please provide a training dataset with -Tr." << std::endl;
+            return -1;
+        }
+        return 0;
+    }
+
+    if (!inputParams.exportCppPath.empty())
+    {
+        if (inputParams.Train || inputParams.Test || inputParams.serve || inputParams.processes > 1)
+        {
+            std::cout << "The export to C++ cannot be combined with -Train, -Test, -Serve or -Processes." << std::endl;
+            return -1;
+        }
+        if (!inputParams.hasWeightsBiases)
+        {
+            std::cout << "Export selected. Please provide the weights to compile with -wb." << std::endl;
+            return -1;
+        }
+        return 0;
+    }
+
+    if (inputParams.serve)
+    {
+        if (inputParams.Train || inputParams.Test || inputParams.processes > 1)
+        {
+            std::cout << "The server mode cannot be combined with -Train, -Test or -Processes." << std::endl;
+            return -1;
+        }
+        if (!inputParams.hasWeightsBiases || inputParams.servePath.empty())
+        {
+            std::cout << "Server mode selected. Please provide the weights with -wb and a socket path (or - for the standard input)." << std::endl;
+            return -1;
+        }
+        if (inputParams.serveBatch < 1 || inputParams.serveWaitUs < 0)
+        {
+            std::cout << "The batch size of the server must be at least 1 and its waiting time cannot be negative." << std::endl;
+            return -1;
+        }
+        return 0;
+    }
+
     if (!inputParams.Train && !inputParams.Test)
     {
         std::cout << "Please select a mode: -Train or -Test. Or use -csv for extract the datasets." << std::endl;
@@ -126,32 +422,63 @@ int parser(Arguments& inputParams, int argc, char** inputToParse)
         std::cout << "Training mode selected. Please provide the number of epochs, learning rate, and batch size." << std::endl;
         return -1;
     }
+    if (inputParams.Train && inputParams.asyncWorkers > threadPool().size())
+    {
+        std::cout << "[WARNING]: Only " << threadPool().size() << " threads in the pool, -Async is lowered from " << inputParams.asyncWorkers << " to " << threadPool().size() << " workers." << std::endl;
+        inputParams.asyncWorkers = threadPool().size();
+    }
+    if (inputParams.Train && inputParams.deterministic && inputParams.asyncWorkers > 0)
+    {
+        std::cout << "[WARNING]: The Hogwild workers update the weights without synchronisation, the training is not reproducible with -Async." << std::endl;
+    }
+    if (inputParams.processes < 1 || (inputParams.processes > 1 && (!inputParams.Train || inputParams.asyncWorkers > 0)))
+    {
+        std::cout << "Multi-process training needs -Train and cannot be combined with -Async." << std::endl;
+        return -1;
+    }
     if (inputParams.Test && strcmp(inputParams.TestDatasetPath.c_str(), "") == 0)
     {
         std::cout << "Testing mode selected. Please provide a testing dataset path." << std::endl;
         return -1;
     }
+    if (inputParams.benchmark && !inputParams.Test)
+    {
+        std::cout << "Benchmark selected. Please provide a testing dataset path with -Test." << std::endl;
+        return -1;
+    }
 
     return 0;
 }
 
 
-void imageToVectorAndLabel(VectorLabel& vecLabel, std::string imagePath)
+size_t validationSetSize(const Arguments& inputParams)
+{
+    return (size_t)(inputParams.TrainDatasetImages.size() * inputParams.validationSplit);
+}
+
+
+void splitValidationSet(Arguments& inputParams)
+{
+    if (inputParams.validationSplit <= 0.0 || !inputParams.ValidationDatasetImages.empty())
+        return;
+
+    // Sorted first, so the split does not depend on the order the directory is listed in
+    std::sort(inputParams.TrainDatasetImages.begin(), inputParams.TrainDatasetImages.end());
+    std::mt19937_64 rng = rngStream(VALIDATION_STREAM);
+    std::shuffle(inputParams.TrainDatasetImages.begin(), inputParams.TrainDatasetImages.end(), rng);
+
+    size_t validationSize = validationSetSize(inputParams);
+    auto validationBegin = inputParams.TrainDatasetImages.end() - validationSize;
+
+    inputParams.ValidationDatasetImages.assign(validationBegin, inputParams.TrainDatasetImages.end());
+    inputParams.TrainDatasetImages.erase(validationBegin, inputParams.TrainDatasetImages.end());
+}
+
+
+bool imageToVectorAndLabel(VectorLabel& vecLabel, const std::string& imagePath)
 {
     // std::string imagePath = "./Resources/Dataset/mnist_train/image_0_1.png";
-    cv::Mat inputImage = cv::imread(imagePath, cv::IMREAD_GRAYSCALE);
-
-    // Convert the image to CV_64F (double precision) and normalize to [0, 1]
-    cv::Mat fImage; 
-    inputImage.convertTo(fImage, CV_64F, 1.0 / 255.0); // Normalize to [0, 1]
-    
-    // Create a vector from the image data
-    std::vector<double> imagePixelVector(fImage.begin<double>(), fImage.end<double>());
-    vecLabel.imagePixelVector = imagePixelVector;
-    // printf("Image size: %ld\n", imagePixelVector.size());
-
-    vecLabel.label = labelExtractor(imagePath);
-    vecLabel.labelVector = trueLabel(vecLabel.label);
+    return loadSample(imagePath, vecLabel.imagePixelVector, vecLabel.label);
 }
 
 
@@ -0,0 +1,328 @@
+#include "vanillanet.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+
+#include "network.hpp"
+#include "weightsBiasExtractor.hpp"
+#include "ptExtractor.hpp"
+#include "threadPool.hpp"
+
+
+/**
+ * The buffers of one evaluation. A model keeps the buffers of its finished evaluations, so a
+ * thread calling it again reuses them instead of allocating.
+ */
+struct ModelWorkspace
+{
+    BatchWorkspace batch;
+    std::vector<double> outputs;
+};
+
+
+struct vn_model
+{
+    Network net;
+    size_t logitsLayers = 0;
+
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ModelWorkspace>> idleWorkspaces;
+};
+
+
+/**
+ * Borrows a workspace of a model for the duration of one call.
+ */
+class WorkspaceLease
+{
+    public:
+
+        explicit WorkspaceLease(vn_model& model) : model(model)
+        {
+            std::lock_guard<std::mutex> lock(model.mutex);
+            if (!model.idleWorkspaces.empty())
+            {
+                workspace = std::move(model.idleWorkspaces.back());
+                model.idleWorkspaces.pop_back();
+            }
+        }
+
+        ~WorkspaceLease()
+        {
+            std::lock_guard<std::mutex> lock(model.mutex);
+            model.idleWorkspaces.push_back(std::move(workspace));
+        }
+
+        ModelWorkspace& get()
+        {
+            if (!workspace)
+                workspace = std::make_unique<ModelWorkspace>();
+            return *workspace;
+        }
+
+    private:
+
+        vn_model& model;
+        std::unique_ptr<ModelWorkspace> workspace;
+};
+
+
+/**
+ * Checks that the layers of a checkpoint chain into a fully connected network: every weight
+ * matrix is rectangular, matches its biases and takes the output of the previous layer as input.
+ */
+static bool validCheckpoint(const std::vector<BiasesWeights>& layers)
+{
+    if (layers.empty())
+        return false;
+
+    size_t previousOutputs = 0;
+    for (const BiasesWeights& layer : layers)
+    {
+        // A convolution needs the shape of its input, which the checkpoint does not record
+        if (layer.WeightsName.compare(0, 2, "fc") != 0 || layer.weights.empty() || layer.weights.size() != layer.biases.size())
+            return false;
+
+        size_t inputs = layer.weights[0].size();
+        for (const std::vector<double>& row : layer.weights)
+        {
+            if (row.size() != inputs || inputs == 0)
+                return false;
+        }
+
+        if (previousOutputs != 0 && inputs != previousOutputs)
+            return false;
+        previousOutputs = layer.weights.size();
+    }
+
+    return true;
+}
+
+
+/**
+ * Reads the shape (inputs, outputs) of the layers fc1, fc2, ... of a state_dict, checking that
+ * they chain into a network.
+ */
+static bool stateDictShapes(const PtStateDict& stateDict, std::vector<std::pair<int, int>>& shapes)
+{
+    if (stateDict.find("conv1.weight") != nullptr)
+        return false;
+
+    for (int k = 1; ; k++)
+    {
+        const PtTensor* weights = stateDict.find("fc" + std::to_string(k) + ".weight");
+        if (weights == nullptr)
+            break;
+
+        if (weights->shape.size() != 2 || weights->shape[0] <= 0 || weights->shape[1] <= 0 ||
+            weights->shape[0] > INT32_MAX || weights->shape[1] > INT32_MAX)
+            return false;
+
+        int inputs = (int)weights->shape[1];
+        if (!shapes.empty() && shapes.back().second != inputs)
+            return false;
+        shapes.emplace_back(inputs, (int)weights->shape[0]);
+    }
+
+    return !shapes.empty();
+}
+
+
+static bool toActivationType(vn_activation activation, ActivationType& type)
+{
+    switch (activation)
+    {
+        case VN_ACTIVATION_SOFTMAX: type = ActivationType::SOFTMAX; return true;
+        case VN_ACTIVATION_SIGMOID: type = ActivationType::SIGMOID; return true;
+        case VN_ACTIVATION_TANH:    type = ActivationType::TANH; return true;
+        case VN_ACTIVATION_RELU:    type = ActivationType::RELU; return true;
+        case VN_ACTIVATION_NONE:    type = ActivationType::INVALID; return true;
+    }
+
+    return false;
+}
+
+
+extern "C" {
+
+
+vn_status vn_model_create(const char* checkpoint_path, vn_activation output_activation, vn_model** model)
+{
+    if (model == nullptr)
+        return VN_ERROR_INVALID_ARGUMENT;
+    *model = nullptr;
+
+    ActivationType outputType;
+    if (checkpoint_path == nullptr || !toActivationType(output_activation, outputType))
+        return VN_ERROR_INVALID_ARGUMENT;
+
+    // No exception may cross the C boundary (the JSON parser throws on a malformed file)
+    try
+    {
+        // The loaders hand their errors back instead of printing them, the library stays silent
+        std::string error;
+        std::unique_ptr<PtStateDict> stateDict;
+        std::vector<BiasesWeights> layers;
+        std::vector<std::pair<int, int>> shapes;
+
+        if (isPtCheckpoint(checkpoint_path))
+        {
+            stateDict = std::make_unique<PtStateDict>();
+            if (!stateDict->load(checkpoint_path, &error) || !stateDictShapes(*stateDict, shapes))
+                return VN_ERROR_CHECKPOINT;
+        }
+        else
+        {
+            layers = parseJSON(checkpoint_path, &error);
+            if (!validCheckpoint(layers))
+                return VN_ERROR_CHECKPOINT;
+
+            for (const BiasesWeights& layer : layers)
+                shapes.emplace_back(layer.weights[0].size(), layer.weights.size());
+        }
+
+        std::unique_ptr<vn_model> created = std::make_unique<vn_model>();
+        Network& net = created->net;
+
+        for (size_t i = 0; i < shapes.size(); i++)
+        {
+            net.addLayer(Layer(shapes[i].first, shapes[i].second, InitializationType::GLOROT, i));
+            if (i + 1 < shapes.size())
+                net.addLayer(ActivationLayer(ActivationType::RELU));
+        }
+
+        created->logitsLayers = net.Layers.size();
+        if (outputType != ActivationType::INVALID)
+            net.addLayer(ActivationLayer(outputType));
+
+        if (stateDict)
+        {
+            if (!net.importStateDict(*stateDict, &error))
+                return VN_ERROR_CHECKPOINT;
+        }
+        else
+            net.importWeightsBiases(layers);
+
+        *model = created.release();
+        return VN_OK;
+    }
+    catch (const std::bad_alloc&)
+    {
+        return VN_ERROR_INTERNAL;
+    }
+    catch (...)
+    {
+        return VN_ERROR_CHECKPOINT;
+    }
+}
+
+
+void vn_model_destroy(vn_model* model)
+{
+    delete model;
+}
+
+
+int vn_model_input_size(const vn_model* model)
+{
+    return model != nullptr ? model->net.inputSize() : 0;
+}
+
+
+int vn_model_output_size(const vn_model* model)
+{
+    return model != nullptr ? model->net.outputSize() : 0;
+}
+
+
+/**
+ * Runs the first `layers` layers of a model on a batch owned by the caller.
+ */
+static vn_status runLayers(vn_model* model, const double* inputs, size_t batch_size, double* outputs, size_t layers)
+{
+    if (model == nullptr || inputs == nullptr || outputs == nullptr || batch_size == 0 || batch_size > INT32_MAX)
+        return VN_ERROR_INVALID_ARGUMENT;
+
+    try
+    {
+        WorkspaceLease lease(*model);
+        model->net.forwardPropagationBatch(inputs, (int)batch_size, outputs, lease.get().batch, layers);
+        return VN_OK;
+    }
+    catch (...)
+    {
+        return VN_ERROR_INTERNAL;
+    }
+}
+
+
+vn_status vn_model_forward(vn_model* model, const double* inputs, size_t batch_size, double* outputs)
+{
+    return runLayers(model, inputs, batch_size, outputs, SIZE_MAX);
+}
+
+
+vn_status vn_model_logits(vn_model* model, const double* inputs, size_t batch_size, double* logits)
+{
+    return runLayers(model, inputs, batch_size, logits, model != nullptr ? model->logitsLayers : 0);
+}
+
+
+vn_status vn_model_predict(vn_model* model, const double* inputs, size_t batch_size, int* labels)
+{
+    if (model == nullptr || inputs == nullptr || labels == nullptr || batch_size == 0 || batch_size > INT32_MAX)
+        return VN_ERROR_INVALID_ARGUMENT;
+
+    try
+    {
+        WorkspaceLease lease(*model);
+        ModelWorkspace& workspace = lease.get();
+
+        size_t outputSize = model->net.outputSize();
+        workspace.outputs.resize(batch_size * outputSize);
+        model->net.forwardPropagationBatch(inputs, (int)batch_size, workspace.outputs.data(), workspace.batch);
+
+        for (size_t n = 0; n < batch_size; n++)
+        {
+            const double* output = workspace.outputs.data() + n * outputSize;
+            labels[n] = std::distance(output, std::max_element(output, output + outputSize));
+        }
+
+        return VN_OK;
+    }
+    catch (...)
+    {
+        return VN_ERROR_INTERNAL;
+    }
+}
+
+
+vn_status vn_configure_threads(int threads)
+{
+    if (threads < 0)
+        return VN_ERROR_INVALID_ARGUMENT;
+
+    configureThreadPool(threads, false);
+    return VN_OK;
+}
+
+
+const char* vn_status_string(vn_status status)
+{
+    switch (status)
+    {
+        case VN_OK:                     return "success";
+        case VN_ERROR_INVALID_ARGUMENT: return "invalid argument";
+        case VN_ERROR_CHECKPOINT:       return "invalid or unreadable checkpoint";
+        case VN_ERROR_INTERNAL:         return "internal error";
+    }
+
+    return "unknown status";
+}
+
+
+} // extern "C"